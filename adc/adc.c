@@ -11,8 +11,47 @@
 #include "adc.h"
 
 volatile uint8_t g_bEOC = 0;
-float g_yRef = 3.3f;
-int g_xRef = 1023; // 10-bit ADC
+
+#define ADC_CAL_IDENTITY    { 1 << ADC_CAL_SHIFT, 0 }
+
+static ADC_Cal _cal[ADC_CAL_CHANNELS] = {  // One entry per ADC_CAL_CHANNELS
+  ADC_CAL_IDENTITY, ADC_CAL_IDENTITY, ADC_CAL_IDENTITY, ADC_CAL_IDENTITY, ADC_CAL_IDENTITY
+};
+static const ADC_Cal _calIdentity = ADC_CAL_IDENTITY;
+static const ADC_Cal *_curCal = &_calIdentity;  // Calibration of the selected channel
+static uint8_t _ch = ADC1_CHANNEL_2;
+static uint16_t _calRaw[2], _calIdeal[2];
+static uint8_t _calValid = 0;   // Bit n set: point n captured
+
+/**
+ * @brief Apply a calibration to a raw reading
+ * @param c Calibration
+ * @param raw Raw ADC value
+ * @return Corrected value, clamped to 0-1023
+ */
+static uint16_t AY_ADC_Apply(const ADC_Cal *c, uint16_t raw)
+{
+    int16_t v = (int16_t)(((uint32_t)raw * c->gain + (1UL << (ADC_CAL_SHIFT - 1))) >> ADC_CAL_SHIFT)
+                + c->offset;
+
+    if (v < 0)
+        return 0;
+    if (v > 1023)
+        return 1023;
+    return (uint16_t)v;
+}
+
+/**
+ * @brief Get the calibration of a channel
+ * @param ch ADC channel number
+ * @return Calibration (identity for uncalibrated channels)
+ */
+static const ADC_Cal *AY_ADC_ChannelCal(uint8_t ch)
+{
+    if (ch < ADC_CAL_FIRST_CH || ch >= ADC_CAL_FIRST_CH + ADC_CAL_CHANNELS)
+        return &_calIdentity;
+    return &_cal[ch - ADC_CAL_FIRST_CH];
+}
 
 /**
  * @brief Initialize ADC IO pin
@@ -42,10 +81,36 @@ void AY_ADC_Init_Single(void)
               ADC1_SCHMITTTRIG_ALL,
               DISABLE);
     
+    _ch = ADC1_CHANNEL_2;
+    _curCal = AY_ADC_ChannelCal(_ch);
+    _calValid = 0;
+    
     // Enable ADC
     ADC1_Cmd(ENABLE);
 }
 
+/**
+ * @brief Select the channel for subsequent conversions
+ * @param ch ADC channel number (ADC1_CHANNEL_x)
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_SelectChannel(uint8_t ch)
+{
+    if (ch > ADC1_CHANNEL_6) {
+        return ADC_RESULT_INVALID_CHANNEL;
+    }
+
+    ADC1_ConversionConfig(ADC1_CONVERSIONMODE_SINGLE, (ADC1_Channel_TypeDef)ch, ADC1_ALIGN_RIGHT);
+
+    // Captured points belong to the previous channel
+    if (ch != _ch)
+        _calValid = 0;
+    _ch = ch;
+    _curCal = AY_ADC_ChannelCal(ch);
+
+    return ADC_RESULT_OK;
+}
+
 /**
  * @brief Start ADC conversion
  */
@@ -55,14 +120,34 @@ void AY_ADC_Start(void)
 }
 
 /**
- * @brief Get ADC conversion result
+ * @brief Get calibrated ADC conversion result
  * @return ADC conversion result (0-1023 for 10-bit ADC)
  */
 uint16_t AY_ADC_Result(void)
+{
+    return AY_ADC_Apply(_curCal, ADC1_GetConversionValue());
+}
+
+/**
+ * @brief Get uncorrected ADC conversion result
+ * @return ADC conversion result (0-1023 for 10-bit ADC)
+ */
+uint16_t AY_ADC_ResultRaw(void)
 {
     return ADC1_GetConversionValue();
 }
 
+/**
+ * @brief Apply a channel's calibration to a raw reading
+ * @param ch ADC channel number
+ * @param raw Raw ADC value
+ * @return Corrected value, clamped to 0-1023
+ */
+uint16_t AY_ADC_Correct(uint8_t ch, uint16_t raw)
+{
+    return AY_ADC_Apply(AY_ADC_ChannelCal(ch), raw);
+}
+
 /**
  * @brief Perform a single ADC conversion
  * @return ADC conversion result (0-1023 for 10-bit ADC)
@@ -77,6 +162,7 @@ int AY_ADC_ConvertS(void)
     {
         // Consider adding a timeout mechanism here
     }
+    ADC1_ClearFlag(ADC1_FLAG_EOC);
     
     return AY_ADC_Result();
 }
@@ -99,14 +185,120 @@ int AY_ADC_Convert(void)
 }
 
 /**
- * @brief Calibrate ADC reference values
- * @note This function currently sets default values. Implement actual calibration if needed.
+ * @brief Capture a calibration point on the selected channel
+ * @param point Calibration point (0 or 1)
+ * @param ideal Expected code for the applied input (0-1023)
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_CalCapture(uint8_t point, uint16_t ideal)
+{
+    uint32_t totRes = 0;
+
+    if (point > 1 || ideal > 1023) {
+        return ADC_RESULT_INVALID_PARAM;
+    }
+
+    // Average 16 raw conversions
+    for (uint8_t i = 0; i < 16; ++i)
+    {
+        AY_ADC_Start();
+        while (!ADC1_GetFlagStatus(ADC1_FLAG_EOC));
+        ADC1_ClearFlag(ADC1_FLAG_EOC);
+        totRes += AY_ADC_ResultRaw();
+    }
+
+    _calRaw[point] = (uint16_t)((totRes + 8) >> 4);
+    _calIdeal[point] = ideal;
+    _calValid |= (uint8_t)(1 << point);
+
+    return ADC_RESULT_OK;
+}
+
+/**
+ * @brief Compute gain/offset for the selected channel from the captured points
+ *
+ * The result is only kept in RAM; read it with AY_ADC_CalGet to store it.
+ *
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_Calibrate(void)
+{
+    int32_t dRaw, dIdeal, gain;
+    ADC_Cal *c;
+
+    if (_ch < ADC_CAL_FIRST_CH || _ch >= ADC_CAL_FIRST_CH + ADC_CAL_CHANNELS) {
+        return ADC_RESULT_INVALID_CHANNEL;
+    }
+    if (_calValid != 0x03) {
+        return ADC_RESULT_NO_DATA;
+    }
+
+    dRaw = (int32_t)_calRaw[1] - _calRaw[0];
+    dIdeal = (int32_t)_calIdeal[1] - _calIdeal[0];
+    if (dRaw == 0 || dIdeal == 0 || (dRaw < 0) != (dIdeal < 0)) {
+        return ADC_RESULT_INVALID_PARAM;
+    }
+
+    // Slope between the two points, rounded
+    gain = ((dIdeal << ADC_CAL_SHIFT) + dRaw / 2) / dRaw;
+    if (gain <= 0 || gain > 0xFFFF) {
+        return ADC_RESULT_INVALID_PARAM;
+    }
+
+    c = &_cal[_ch - ADC_CAL_FIRST_CH];
+    c->gain = (uint16_t)gain;
+    c->offset = (int16_t)((int32_t)_calIdeal[0] -
+                (int32_t)(((uint32_t)_calRaw[0] * c->gain + (1UL << (ADC_CAL_SHIFT - 1))) >> ADC_CAL_SHIFT));
+    _calValid = 0;
+
+    return ADC_RESULT_OK;
+}
+
+/**
+ * @brief Get the calibration of a channel
+ * @param ch ADC channel number (ADC_CAL_FIRST_CH...)
+ * @param cal Receives the gain and offset
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_CalGet(uint8_t ch, ADC_Cal *cal)
+{
+    if (ch < ADC_CAL_FIRST_CH || ch >= ADC_CAL_FIRST_CH + ADC_CAL_CHANNELS) {
+        return ADC_RESULT_INVALID_CHANNEL;
+    }
+    if (cal == NULL) {
+        return ADC_RESULT_INVALID_PARAM;
+    }
+
+    *cal = _cal[ch - ADC_CAL_FIRST_CH];
+    return ADC_RESULT_OK;
+}
+
+/**
+ * @brief Set the calibration of a channel, e.g. as restored from storage
+ * @param ch ADC channel number (ADC_CAL_FIRST_CH...)
+ * @param cal Gain and offset
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_CalSet(uint8_t ch, const ADC_Cal *cal)
+{
+    if (ch < ADC_CAL_FIRST_CH || ch >= ADC_CAL_FIRST_CH + ADC_CAL_CHANNELS) {
+        return ADC_RESULT_INVALID_CHANNEL;
+    }
+    if (cal == NULL || cal->gain == 0 || cal->offset < -1023 || cal->offset > 1023) {
+        return ADC_RESULT_INVALID_PARAM;
+    }
+
+    _cal[ch - ADC_CAL_FIRST_CH] = *cal;
+    return ADC_RESULT_OK;
+}
+
+/**
+ * @brief Reset all channels to identity calibration
  */
-void AY_ADC_Calibrate(void)
+void AY_ADC_CalReset(void)
 {
-    // TODO: Implement actual calibration logic if needed
-    g_xRef = 1023;  // Default for 10-bit ADC
-    g_yRef = 3.3f;  // Default reference voltage
+    for (uint8_t i = 0; i < ADC_CAL_CHANNELS; ++i)
+        _cal[i] = _calIdentity;
 }
 
 /**
@@ -116,5 +308,5 @@ void AY_ADC_Calibrate(void)
  */
 float AY_ADC_ToVoltage(int adcValue)
 {
-    return (g_yRef / g_xRef) * adcValue;
+    return (ADC_VREF / ADC_MAX) * adcValue;
 }
\ No newline at end of file
@@ -17,20 +17,50 @@ extern "C" {
 #include "io.h"  // For IO_IDX type
 
 /**
- * @brief ADC reference voltage
- * 
- * This value represents the voltage corresponding to the maximum ADC reading.
- * It can be adjusted through calibration.
+ * @brief First ADC channel with calibration data (AIN2)
  */
-extern float g_yRef;
+#define ADC_CAL_FIRST_CH    2
 
 /**
- * @brief ADC maximum digital value
- * 
- * This value represents the maximum digital reading of the ADC.
- * For a 10-bit ADC, this is typically 1023.
+ * @brief Number of calibrated channels (AIN2-AIN6)
  */
-extern int g_xRef;
+#define ADC_CAL_CHANNELS    5
+
+/**
+ * @brief Fractional bits of the calibration gain (1.0 == 1 << ADC_CAL_SHIFT)
+ */
+#define ADC_CAL_SHIFT       14
+
+/**
+ * @brief Per-channel calibration: corrected = ((raw * gain) >> ADC_CAL_SHIFT) + offset
+ */
+typedef struct {
+  uint16_t gain;
+  int16_t offset;
+} ADC_Cal;
+
+/**
+ * @brief Enumeration of ADC operation results
+ */
+typedef enum {
+  ADC_RESULT_OK,
+  ADC_RESULT_INVALID_CHANNEL,
+  ADC_RESULT_INVALID_PARAM,
+  ADC_RESULT_NO_DATA,
+  ADC_RESULT_ERROR
+} ADC_Result;
+
+/**
+ * @brief ADC reference voltage (voltage of the maximum reading)
+ */
+#ifndef ADC_VREF
+#define ADC_VREF            3.3f
+#endif
+
+/**
+ * @brief ADC maximum digital value (10-bit ADC)
+ */
+#define ADC_MAX             1023
 
 /**
  * @brief Initialize ADC IO pin
@@ -43,17 +73,38 @@ void AY_ADC_IOInit(IO_IDX idx);
  */
 void AY_ADC_Init_Single(void);
 
+/**
+ * @brief Select the channel for subsequent conversions
+ * @param ch ADC channel number (ADC1_CHANNEL_x)
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_SelectChannel(uint8_t ch);
+
 /**
  * @brief Start ADC conversion
  */
 void AY_ADC_Start(void);
 
 /**
- * @brief Get ADC conversion result
+ * @brief Get calibrated ADC conversion result
  * @return ADC conversion result (0-1023 for 10-bit ADC)
  */
 uint16_t AY_ADC_Result(void);
 
+/**
+ * @brief Get uncorrected ADC conversion result
+ * @return ADC conversion result (0-1023 for 10-bit ADC)
+ */
+uint16_t AY_ADC_ResultRaw(void);
+
+/**
+ * @brief Apply a channel's calibration to a raw reading
+ * @param ch ADC channel number
+ * @param raw Raw ADC value
+ * @return Corrected value, clamped to 0-1023
+ */
+uint16_t AY_ADC_Correct(uint8_t ch, uint16_t raw);
+
 /**
  * @brief Perform a single ADC conversion
  * @return ADC conversion result (0-1023 for 10-bit ADC)
@@ -67,10 +118,50 @@ int AY_ADC_ConvertS(void);
 int AY_ADC_Convert(void);
 
 /**
- * @brief Calibrate ADC reference values
- * @note This function currently sets default values. Implement actual calibration if needed.
+ * @brief Capture a calibration point on the selected channel
+ *
+ * Apply a known input level, then call this with the code an ideal ADC
+ * would return for it. Two points (0 and 1) are needed, ideally near the
+ * bottom and top of the range. Selecting another channel discards the
+ * captured points.
+ *
+ * @param point Calibration point (0 or 1)
+ * @param ideal Expected code for the applied input (0-1023)
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_CalCapture(uint8_t point, uint16_t ideal);
+
+/**
+ * @brief Compute gain/offset for the selected channel from the captured points
+ *
+ * The result is only kept in RAM. To keep it across resets, read it with
+ * AY_ADC_CalGet and store it (e.g. with DLog_SetUser), then restore it at
+ * startup with AY_ADC_CalSet.
+ *
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_Calibrate(void);
+
+/**
+ * @brief Get the calibration of a channel
+ * @param ch ADC channel number (ADC_CAL_FIRST_CH...)
+ * @param cal Receives the gain and offset
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_CalGet(uint8_t ch, ADC_Cal *cal);
+
+/**
+ * @brief Set the calibration of a channel, e.g. as restored from storage
+ * @param ch ADC channel number (ADC_CAL_FIRST_CH...)
+ * @param cal Gain and offset (gain != 0, offset within +/-1023)
+ * @return ADC_Result Result of the operation
+ */
+ADC_Result AY_ADC_CalSet(uint8_t ch, const ADC_Cal *cal);
+
+/**
+ * @brief Reset all channels to identity calibration
  */
-void AY_ADC_Calibrate(void);
+void AY_ADC_CalReset(void);
 
 /**
  * @brief Convert ADC value to voltage
@@ -0,0 +1,330 @@
+/**
+ * @file boot.c
+ * @brief UART bootloader implementation for STM8S003F3
+ *
+ * This file contains the implementation of the bootloader functions. The
+ * bootloader polls the console UART and TIM4 without interrupts, so the
+ * interrupt vectors can be forwarded to the application unconditionally.
+ *
+ * Each frame carries one whole flash block, which is programmed with a single
+ * block operation (erase and write in one go, about 6 ms) instead of 64 byte
+ * writes, and read back before the frame is acknowledged. The host waits for
+ * the reply before sending the next frame, so nothing arrives while the CPU
+ * is stalled by programming. At 115200 baud a full image takes about a
+ * second.
+ *
+ * The image descriptor is erased before the first block is written and only
+ * rewritten once the whole image has been verified, so an interrupted update
+ * leaves the target in the bootloader rather than starting a partial image.
+ */
+
+#include <string.h>
+#include "stm8s.h"
+#include "boot.h"
+#include "uart.h"
+#include "system.h"
+
+/**
+ * @brief Image descriptor marker
+ */
+#define BOOT_MAGIC      0xB007
+
+/**
+ * @brief Wait for a byte without timeout
+ */
+#define BOOT_FOREVER    0xFFFF
+
+/**
+ * @brief Block numbers relative to the start of program memory
+ */
+#define BOOT_APP_BLOCK  ((BOOT_APP_ADDR - FLASH_PROG_START_PHYSICAL_ADDRESS) / BOOT_BLOCK_SIZE)
+#define BOOT_INFO_BLOCK ((BOOT_INFO_ADDR - FLASH_PROG_START_PHYSICAL_ADDRESS) / BOOT_BLOCK_SIZE)
+
+/**
+ * @brief Image descriptor, stored at BOOT_INFO_ADDR
+ */
+typedef struct {
+  uint16_t magic;
+  uint16_t length;    // Image length in bytes from BOOT_APP_ADDR
+  uint16_t crc;       // Sys_Crc16 of the image
+  uint16_t ncrc;      // ~crc
+} BOOT_Info;
+
+#define BOOT_INFO ((const BOOT_Info *)BOOT_INFO_ADDR)
+
+typedef char BOOT_AppAddrCheck[(BOOT_APP_ADDR % BOOT_BLOCK_SIZE == 0 &&
+                                BOOT_APP_ADDR < BOOT_INFO_ADDR) ? 1 : -1];
+
+static uint8_t _buf[BOOT_BLOCK_SIZE + 1];   // Frame payload
+static uint8_t _erased = 0;                 // Descriptor invalidated
+
+/**
+ * @brief Run TIM4 as a polled 1 ms tick
+ */
+static void Boot_TickInit(void)
+{
+    uint32_t f = Sys_MasterClock();
+    uint8_t psc = 0;
+
+    CLK_PeripheralClockConfig(CLK_PERIPHERAL_TIMER4, ENABLE);
+
+    while (psc < 7 && (f >> psc) / 1000 > 256)
+        ++psc;
+    TIM4_TimeBaseInit((TIM4_Prescaler_TypeDef)psc, (uint8_t)((f >> psc) / 1000 - 1));
+    TIM4_ClearFlag(TIM4_FLAG_UPDATE);
+    TIM4_Cmd(ENABLE);
+}
+
+/**
+ * @brief Receive a byte
+ *
+ * @param c Receives the byte
+ * @param ms Timeout in milliseconds, BOOT_FOREVER for none
+ * @return BOOT_Result Result of the operation
+ */
+static BOOT_Result Boot_Getc(uint8_t *c, uint16_t ms)
+{
+    while (!UART_ChkRxBuff(CON_UART)) {
+        if (TIM4->SR1 & TIM4_SR1_UIF) {
+            TIM4->SR1 = (uint8_t)~TIM4_SR1_UIF;
+            if (ms != BOOT_FOREVER && ms-- == 0)
+                return BOOT_RESULT_TIMEOUT;
+        }
+    }
+
+    if (UART_Recv(CON_UART, c) != UART_RESULT_OK) {
+        return BOOT_RESULT_UART;
+    }
+    return BOOT_RESULT_OK;
+}
+
+/**
+ * @brief Discard input until the line has been idle for BOOT_BYTE_MS
+ */
+static void Boot_Drain(void)
+{
+    uint8_t c;
+
+    while (Boot_Getc(&c, BOOT_BYTE_MS) != BOOT_RESULT_TIMEOUT);
+}
+
+/**
+ * @brief Receive a frame into _buf
+ *
+ * Sync bytes received between frames are acknowledged.
+ *
+ * @param cmd Receives the command
+ * @param len Receives the payload length
+ * @return BOOT_Result Result of the operation
+ */
+static BOOT_Result Boot_RecvFrame(uint8_t *cmd, uint8_t *len)
+{
+    uint8_t c, i, hdr[2];
+    uint16_t crc;
+    BOOT_Result r;
+
+    for (;;) {
+        if (Boot_Getc(&c, BOOT_FOREVER) != BOOT_RESULT_OK)
+            continue;
+        if (c == BOOT_SOF)
+            break;
+        if (c == BOOT_SYNC_BYTE)
+            UART_Send(CON_UART, BOOT_ACK);
+    }
+
+    if ((r = Boot_Getc(&hdr[0], BOOT_BYTE_MS)) != BOOT_RESULT_OK ||
+        (r = Boot_Getc(&hdr[1], BOOT_BYTE_MS)) != BOOT_RESULT_OK) {
+        return r;
+    }
+    if (hdr[1] > sizeof(_buf)) {
+        return BOOT_RESULT_INVALID_PARAM;
+    }
+
+    for (i = 0; i < hdr[1]; ++i) {
+        if ((r = Boot_Getc(&_buf[i], BOOT_BYTE_MS)) != BOOT_RESULT_OK) {
+            return r;
+        }
+    }
+
+    if ((r = Boot_Getc(&c, BOOT_BYTE_MS)) != BOOT_RESULT_OK) {
+        return r;
+    }
+    crc = c;
+    if ((r = Boot_Getc(&c, BOOT_BYTE_MS)) != BOOT_RESULT_OK) {
+        return r;
+    }
+    crc |= (uint16_t)c << 8;
+
+    if (Sys_Crc16(Sys_Crc16(0xFFFF, hdr, 2), _buf, hdr[1]) != crc) {
+        return BOOT_RESULT_CRC;
+    }
+
+    *cmd = hdr[0];
+    *len = hdr[1];
+    return BOOT_RESULT_OK;
+}
+
+/**
+ * @brief Program and verify one flash block
+ *
+ * @param block Block number from the start of program memory
+ * @param data BOOT_BLOCK_SIZE bytes, or NULL to erase the block
+ * @return BOOT_Result Result of the operation
+ */
+static BOOT_Result Boot_Program(uint16_t block, const uint8_t *data)
+{
+    const uint8_t *dst = (const uint8_t *)(FLASH_PROG_START_PHYSICAL_ADDRESS +
+                                           block * BOOT_BLOCK_SIZE);
+    FLASH_Status_TypeDef st;
+    uint8_t i;
+
+    FLASH_Unlock(FLASH_MEMTYPE_PROG);
+    if (data)
+        FLASH_ProgramBlock(block, FLASH_MEMTYPE_PROG, FLASH_PROGRAMMODE_STANDARD,
+                           (uint8_t *)data);
+    else
+        FLASH_EraseBlock(block, FLASH_MEMTYPE_PROG);
+    st = (FLASH_Status_TypeDef)FLASH_WaitForLastOperation(FLASH_MEMTYPE_PROG);
+    FLASH_Lock(FLASH_MEMTYPE_PROG);
+
+    if (st != FLASH_STATUS_SUCCESSFUL_OPERATION) {
+        return BOOT_RESULT_FLASH;
+    }
+
+    for (i = 0; i < BOOT_BLOCK_SIZE; ++i) {
+        if (dst[i] != (data ? data[i] : 0)) {
+            return BOOT_RESULT_FLASH;
+        }
+    }
+    return BOOT_RESULT_OK;
+}
+
+/**
+ * @brief Execute a received frame
+ *
+ * @param cmd Command
+ * @param len Payload length
+ * @return BOOT_Result Result to report to the host
+ */
+static BOOT_Result Boot_Command(uint8_t cmd, uint8_t len)
+{
+    BOOT_Info *info = (BOOT_Info *)_buf;
+    uint16_t length, crc;
+    BOOT_Result r;
+
+    switch (cmd) {
+    case BOOT_CMD_SYNC:
+    case BOOT_CMD_RUN:
+        if (len != 0) {
+            return BOOT_RESULT_INVALID_PARAM;
+        }
+        return cmd == BOOT_CMD_RUN ? Boot_CheckApp() : BOOT_RESULT_OK;
+
+    case BOOT_CMD_WRITE:
+        if (len != BOOT_BLOCK_SIZE + 1 || _buf[0] >= BOOT_APP_BLOCKS) {
+            return BOOT_RESULT_INVALID_PARAM;
+        }
+        if (!_erased) {
+            if ((r = Boot_Program(BOOT_INFO_BLOCK, NULL)) != BOOT_RESULT_OK) {
+                return r;
+            }
+            _erased = 1;
+        }
+        return Boot_Program(BOOT_APP_BLOCK + _buf[0], &_buf[1]);
+
+    case BOOT_CMD_DONE:
+        if (len != 4) {
+            return BOOT_RESULT_INVALID_PARAM;
+        }
+        length = (uint16_t)(_buf[0] | ((uint16_t)_buf[1] << 8));
+        crc = (uint16_t)(_buf[2] | ((uint16_t)_buf[3] << 8));
+        if (length == 0 || length > BOOT_APP_BLOCKS * BOOT_BLOCK_SIZE) {
+            return BOOT_RESULT_INVALID_PARAM;
+        }
+        if (Sys_Crc16(0xFFFF, (const uint8_t *)BOOT_APP_ADDR, length) != crc) {
+            return BOOT_RESULT_CRC;
+        }
+
+        memset(_buf, 0, BOOT_BLOCK_SIZE);
+        info->magic = BOOT_MAGIC;
+        info->length = length;
+        info->crc = crc;
+        info->ncrc = (uint16_t)~crc;
+        if ((r = Boot_Program(BOOT_INFO_BLOCK, _buf)) != BOOT_RESULT_OK) {
+            return r;
+        }
+        _erased = 0;
+        return Boot_CheckApp();
+
+    default:
+        return BOOT_RESULT_INVALID_PARAM;
+    }
+}
+
+/**
+ * @brief Run the bootloader
+ */
+void Boot_Main(void)
+{
+    uint8_t c, cmd = 0, len;
+    BOOT_Result r;
+
+    Sys_ClockInit();
+    UART_Init(CON_UART, BOOT_BAUD);
+    Boot_TickInit();
+
+    // The host has BOOT_WAIT_MS after reset to claim the bootloader
+    r = Boot_Getc(&c, BOOT_WAIT_MS);
+    if (r == BOOT_RESULT_OK && c == BOOT_SYNC_BYTE) {
+        UART_Send(CON_UART, BOOT_ACK);
+    } else if (Boot_CheckApp() == BOOT_RESULT_OK) {
+        Boot_JumpToApp();
+    }
+
+    for (;;) {
+        r = Boot_RecvFrame(&cmd, &len);
+        if (r == BOOT_RESULT_OK)
+            r = Boot_Command(cmd, len);
+        else
+            Boot_Drain();
+
+        UART_Send(CON_UART, r == BOOT_RESULT_OK ? BOOT_ACK : BOOT_NAK);
+        UART_Send(CON_UART, (uint8_t)r);
+
+        if (r == BOOT_RESULT_OK && cmd == BOOT_CMD_RUN)
+            Boot_JumpToApp();
+    }
+}
+
+/**
+ * @brief Check the installed application image
+ *
+ * @return BOOT_Result BOOT_RESULT_OK if the descriptor and image CRC match
+ */
+BOOT_Result Boot_CheckApp(void)
+{
+    const BOOT_Info *info = BOOT_INFO;
+
+    if (info->magic != BOOT_MAGIC || info->crc != (uint16_t)~info->ncrc ||
+        info->length == 0 || info->length > BOOT_APP_BLOCKS * BOOT_BLOCK_SIZE) {
+        return BOOT_RESULT_NO_APP;
+    }
+    if (Sys_Crc16(0xFFFF, (const uint8_t *)BOOT_APP_ADDR, info->length) != info->crc) {
+        return BOOT_RESULT_CRC;
+    }
+    return BOOT_RESULT_OK;
+}
+
+/**
+ * @brief Start the application
+ */
+void Boot_JumpToApp(void)
+{
+    // Let the last reply leave, then hand over the peripherals in reset state
+    while (!(UART1->SR & UART1_SR_TC));
+    UART1_DeInit();
+    TIM4_DeInit();
+
+    // The application's reset vector is an INT (far jump) instruction
+    ((void (*)(void))(uint16_t)BOOT_APP_ADDR)();
+}
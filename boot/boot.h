@@ -0,0 +1,186 @@
+/**
+ * @file boot.h
+ * @brief UART bootloader interface for STM8S003F3
+ *
+ * This file contains the declarations of the bootloader functions, types, and
+ * definitions for receiving a firmware image over the console UART and
+ * programming it into flash on the STM8S003F3 microcontroller.
+ *
+ * Flash layout:
+ * - 0x8000 .. BOOT_APP_ADDR-1: bootloader (reset vector and interrupt
+ *   vectors; vectors 1-31 must forward to BOOT_APP_ADDR + 4 * n)
+ * - BOOT_APP_ADDR .. BOOT_INFO_ADDR-1: application, linked at BOOT_APP_ADDR
+ *   with its own vector table there
+ * - BOOT_INFO_ADDR: image descriptor (last flash block)
+ *
+ * Program memory block programming must run from RAM: build the bootloader
+ * with RAM_EXECUTION defined in stm8s.h.
+ *
+ * Bootloader build: boot.c, boot_vectors.c (in place of
+ * stm8_interrupt_vector.c), uart.c, system.c, interrupt.c and io.c plus the
+ * SPL clk, uart1, tim4, itc and flash drivers, with UART_HW_ONLY and
+ * IRQ_NO_VECTORS defined. This keeps the software UART, the timer code and
+ * the dispatch vectors out of the bootloader.
+ *
+ * Protocol (host -> target frames, one reply per frame):
+ *
+ *   SOF cmd len payload[len] crcL crcH
+ *
+ * The CRC is Sys_Crc16 (start 0xFFFF) over cmd, len and payload. The target
+ * replies BOOT_ACK or BOOT_NAK followed by a BOOT_Result byte. Commands:
+ * - BOOT_CMD_SYNC: no payload
+ * - BOOT_CMD_WRITE: block index (from BOOT_APP_ADDR) + BOOT_BLOCK_SIZE bytes;
+ *   the first write invalidates the installed image
+ * - BOOT_CMD_DONE: image length (16-bit LE) + image CRC (16-bit LE); the
+ *   flash contents are verified and the descriptor is written
+ * - BOOT_CMD_RUN: no payload, starts a valid application after the reply
+ *
+ * After reset the host has BOOT_WAIT_MS to send BOOT_SYNC_BYTE; otherwise a
+ * valid application is started. Without a valid application the bootloader
+ * waits indefinitely.
+ */
+
+#ifndef __BOOT_H
+#define __BOOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm8s.h"
+
+/**
+ * @brief Application start address (block aligned)
+ */
+#ifndef BOOT_APP_ADDR
+#define BOOT_APP_ADDR       0x8800
+#endif
+
+/**
+ * @brief Image descriptor address (last flash block)
+ */
+#define BOOT_INFO_ADDR      (FLASH_PROG_END_PHYSICAL_ADDRESS + 1 - FLASH_BLOCK_SIZE)
+
+/**
+ * @brief Flash block size and number of application blocks
+ */
+#define BOOT_BLOCK_SIZE     FLASH_BLOCK_SIZE
+#define BOOT_APP_BLOCKS     ((BOOT_INFO_ADDR - BOOT_APP_ADDR) / BOOT_BLOCK_SIZE)
+
+/**
+ * @brief Console baud rate while in the bootloader
+ */
+#ifndef BOOT_BAUD
+#define BOOT_BAUD           115200UL
+#endif
+
+/**
+ * @brief Time after reset to wait for the host, in milliseconds
+ */
+#define BOOT_WAIT_MS        500
+
+/**
+ * @brief Maximum gap between bytes of a frame, in milliseconds
+ */
+#define BOOT_BYTE_MS        100
+
+/**
+ * @brief Protocol bytes
+ */
+#define BOOT_SYNC_BYTE      0x7F
+#define BOOT_SOF            0x5A
+#define BOOT_ACK            0x79
+#define BOOT_NAK            0x1F
+
+/**
+ * @brief Commands
+ */
+#define BOOT_CMD_SYNC       0x01
+#define BOOT_CMD_WRITE      0x02
+#define BOOT_CMD_DONE       0x03
+#define BOOT_CMD_RUN        0x04
+
+/**
+ * @brief Enumeration of bootloader operation results
+ */
+typedef enum {
+  BOOT_RESULT_OK,
+  BOOT_RESULT_INVALID_PARAM,
+  BOOT_RESULT_TIMEOUT,
+  BOOT_RESULT_CRC,            // Frame or image CRC mismatch
+  BOOT_RESULT_UART,           // Overrun, noise or framing error
+  BOOT_RESULT_FLASH,          // Programming or verification failed
+  BOOT_RESULT_NO_APP,
+  BOOT_RESULT_ERROR
+} BOOT_Result;
+
+#if defined(_SDCC_) || defined(__SDCC)
+/**
+ * @brief Forwarding vectors (boot_vectors.c)
+ *
+ * SDCC places interrupt handlers in the vector table only when they are
+ * declared in the file that contains main, so include boot.h there.
+ */
+void Boot_Trap(void) __trap __naked;
+void Boot_Irq0(void) __interrupt(0) __naked;
+void Boot_Irq1(void) __interrupt(1) __naked;
+void Boot_Irq2(void) __interrupt(2) __naked;
+void Boot_Irq3(void) __interrupt(3) __naked;
+void Boot_Irq4(void) __interrupt(4) __naked;
+void Boot_Irq5(void) __interrupt(5) __naked;
+void Boot_Irq6(void) __interrupt(6) __naked;
+void Boot_Irq7(void) __interrupt(7) __naked;
+void Boot_Irq8(void) __interrupt(8) __naked;
+void Boot_Irq9(void) __interrupt(9) __naked;
+void Boot_Irq10(void) __interrupt(10) __naked;
+void Boot_Irq11(void) __interrupt(11) __naked;
+void Boot_Irq12(void) __interrupt(12) __naked;
+void Boot_Irq13(void) __interrupt(13) __naked;
+void Boot_Irq14(void) __interrupt(14) __naked;
+void Boot_Irq15(void) __interrupt(15) __naked;
+void Boot_Irq16(void) __interrupt(16) __naked;
+void Boot_Irq17(void) __interrupt(17) __naked;
+void Boot_Irq18(void) __interrupt(18) __naked;
+void Boot_Irq19(void) __interrupt(19) __naked;
+void Boot_Irq20(void) __interrupt(20) __naked;
+void Boot_Irq21(void) __interrupt(21) __naked;
+void Boot_Irq22(void) __interrupt(22) __naked;
+void Boot_Irq23(void) __interrupt(23) __naked;
+void Boot_Irq24(void) __interrupt(24) __naked;
+void Boot_Irq25(void) __interrupt(25) __naked;
+void Boot_Irq26(void) __interrupt(26) __naked;
+void Boot_Irq27(void) __interrupt(27) __naked;
+void Boot_Irq28(void) __interrupt(28) __naked;
+void Boot_Irq29(void) __interrupt(29) __naked;
+#endif
+
+/**
+ * @brief Run the bootloader
+ *
+ * Call first thing from the bootloader's main. Initializes the clock and the
+ * console UART, serves the host and finally starts the application. Does not
+ * return.
+ */
+void Boot_Main(void);
+
+/**
+ * @brief Check the installed application image
+ *
+ * @return BOOT_Result BOOT_RESULT_OK if the descriptor and image CRC match
+ */
+BOOT_Result Boot_CheckApp(void);
+
+/**
+ * @brief Start the application
+ *
+ * Resets the peripherals used by the bootloader and jumps to the
+ * application's reset vector at BOOT_APP_ADDR. Does not return.
+ */
+void Boot_JumpToApp(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BOOT_H
@@ -0,0 +1,72 @@
+/**
+ * @file boot_vectors.c
+ * @brief Bootloader interrupt vector table for STM8S003F3
+ *
+ * This file contains the bootloader's vector table. The reset vector starts
+ * the bootloader; vectors 1-31 forward to the application's table at
+ * BOOT_APP_ADDR + 4 * n, so the application's interrupts work without any
+ * help from the bootloader. It replaces stm8_interrupt_vector.c in the
+ * bootloader build, and interrupt/interrupt.c must be built with
+ * IRQ_NO_VECTORS there.
+ */
+
+#include "stm8s.h"
+#include "boot.h"
+
+/**
+ * @brief INT opcode (far jump) that starts every vector
+ */
+#define BOOT_OP_INT     0x82
+
+#if defined(_COSMIC_)
+
+typedef void @far (*BOOT_Handler)(void);
+
+/**
+ * @brief Vector table entry
+ */
+typedef struct {
+  unsigned char op;
+  BOOT_Handler handler;
+} BOOT_Vector;
+
+extern void _stext();   // Startup routine
+
+#define BOOT_FWD(n)     { BOOT_OP_INT, (BOOT_Handler)(BOOT_APP_ADDR + 4 * (n)) }
+
+// Placed at 0x8000 by the linker command file, like stm8_interrupt_vector.c
+BOOT_Vector const _vectab[] = {
+  { BOOT_OP_INT, (BOOT_Handler)_stext },  // Reset
+  BOOT_FWD(1),  BOOT_FWD(2),  BOOT_FWD(3),  BOOT_FWD(4),  BOOT_FWD(5),
+  BOOT_FWD(6),  BOOT_FWD(7),  BOOT_FWD(8),  BOOT_FWD(9),  BOOT_FWD(10),
+  BOOT_FWD(11), BOOT_FWD(12), BOOT_FWD(13), BOOT_FWD(14), BOOT_FWD(15),
+  BOOT_FWD(16), BOOT_FWD(17), BOOT_FWD(18), BOOT_FWD(19), BOOT_FWD(20),
+  BOOT_FWD(21), BOOT_FWD(22), BOOT_FWD(23), BOOT_FWD(24), BOOT_FWD(25),
+  BOOT_FWD(26), BOOT_FWD(27), BOOT_FWD(28), BOOT_FWD(29), BOOT_FWD(30),
+  BOOT_FWD(31),
+};
+
+#elif defined(_SDCC_) || defined(__SDCC)
+
+// SDCC builds the table itself; each handler is a bare far jump, so the
+// application's handler runs as if it had been entered directly. Vector n
+// is __interrupt(n - 2), vector 1 is the trap.
+#define BOOT_STR_(x)    #x
+#define BOOT_STR(x)     BOOT_STR_(x)
+#define BOOT_FWD(k, ofs) \
+void Boot_Irq##k(void) __interrupt(k) __naked { __asm__("jpf " BOOT_STR(BOOT_APP_ADDR) "+" #ofs); }
+
+void Boot_Trap(void) __trap __naked { __asm__("jpf " BOOT_STR(BOOT_APP_ADDR) "+4"); }
+
+BOOT_FWD(0, 8)    BOOT_FWD(1, 12)   BOOT_FWD(2, 16)   BOOT_FWD(3, 20)
+BOOT_FWD(4, 24)   BOOT_FWD(5, 28)   BOOT_FWD(6, 32)   BOOT_FWD(7, 36)
+BOOT_FWD(8, 40)   BOOT_FWD(9, 44)   BOOT_FWD(10, 48)  BOOT_FWD(11, 52)
+BOOT_FWD(12, 56)  BOOT_FWD(13, 60)  BOOT_FWD(14, 64)  BOOT_FWD(15, 68)
+BOOT_FWD(16, 72)  BOOT_FWD(17, 76)  BOOT_FWD(18, 80)  BOOT_FWD(19, 84)
+BOOT_FWD(20, 88)  BOOT_FWD(21, 92)  BOOT_FWD(22, 96)  BOOT_FWD(23, 100)
+BOOT_FWD(24, 104) BOOT_FWD(25, 108) BOOT_FWD(26, 112) BOOT_FWD(27, 116)
+BOOT_FWD(28, 120) BOOT_FWD(29, 124)
+
+#else
+#error "boot_vectors.c: provide a table forwarding vectors 1-31 to BOOT_APP_ADDR + 4 * n"
+#endif
@@ -0,0 +1,203 @@
+/**
+ * @file capture.c
+ * @brief Timer-triggered ADC acquisition implementation for STM8S003F3
+ *
+ * This file contains the implementation of the capture functions. TIM1's
+ * update event is routed to TRGO and starts each ADC conversion in hardware,
+ * so the sample rate does not depend on software timing. The EOC interrupt
+ * stores each result in the half of a ping-pong buffer being filled; a full
+ * half is handed to the main loop while the ISR continues in the other one.
+ *
+ * If the main loop has not released the previous half when the next one is
+ * full, that new half is discarded, refilled and counted as an overrun, so
+ * the block being processed is never modified.
+ */
+
+#include "stm8s.h"
+#include "capture.h"
+#include "adc.h"
+#include "timer.h"
+#include "uart.h"
+#include "system.h"
+#include "interrupt.h"
+
+static uint16_t _buf[2][CAP_BLOCK_SIZE];
+static uint8_t _fill = 0;             // Half being filled by the ISR
+static uint8_t _pos = 0;              // Next sample in _buf[_fill]
+static volatile uint8_t _ready = 0;   // 0: none, 1/2: half 0/1 handed to main
+static volatile uint16_t _overruns = 0;
+static uint8_t _seq = 0;
+static bool _stream = false;
+static CAP_Callback _cb = NULL;
+
+/**
+ * @brief Configure TIM1 and the ADC for triggered sampling
+ *
+ * @param ch ADC channel number (ADC1_CHANNEL_x)
+ * @param rate Sample rate in Hz (1 to 20000)
+ * @return CAP_Result Result of the operation
+ */
+CAP_Result CAP_Init(uint8_t ch, uint32_t rate)
+{
+    uint32_t ticks;
+    uint16_t prescale;
+
+    if (ch > ADC1_CHANNEL_6 || rate == 0 || rate > 20000) {
+        return CAP_RESULT_INVALID_PARAM;
+    }
+
+    // TIM1 update at the sample rate, e.g. 16 MHz / 1 / 16000 = 1 kHz
+    ticks = Sys_MasterClock() / rate;
+    prescale = (uint16_t)(ticks / 65536 + 1);
+    if (Timer_Init(TIMER_1, prescale, (uint16_t)(ticks / prescale), 1) != TIMER_RESULT_OK) {
+        return CAP_RESULT_ERROR;
+    }
+    TIM1_SelectOutputTrigger(TIM1_TRGOSOURCE_UPDATE);
+
+    // ADC converts once per TRGO
+    CLK_PeripheralClockConfig(CLK_PERIPHERAL_ADC, ENABLE);
+    ADC1_DeInit();
+    ADC1_Init(ADC1_CONVERSIONMODE_SINGLE,
+              (ADC1_Channel_TypeDef)ch,
+              ADC1_PRESSEL_FCPU_D8,
+              ADC1_EXTTRIG_TIM,
+              ENABLE,
+              ADC1_ALIGN_RIGHT,
+              (ADC1_SchmittTrigg_TypeDef)ch,
+              DISABLE);
+
+    _fill = 0;
+    _pos = 0;
+    _ready = 0;
+    _overruns = 0;
+
+    IRQ_Register(IRQ_ADC1, CAP_Isr);
+    ADC1_ClearFlag(ADC1_FLAG_EOC);
+    ADC1_ITConfig(ADC1_IT_EOCIE, ENABLE);
+    ADC1_Cmd(ENABLE);
+
+    return CAP_RESULT_OK;
+}
+
+/**
+ * @brief Start or stop sampling
+ *
+ * @param enable true to start, false to stop
+ */
+void CAP_Start(bool enable)
+{
+    Timer_Start(TIMER_1, enable);
+}
+
+/**
+ * @brief Set the block processing callback
+ *
+ * @param cb Callback, NULL for none
+ */
+void CAP_SetCallback(CAP_Callback cb)
+{
+    _cb = cb;
+}
+
+/**
+ * @brief Enable or disable streaming of blocks to the console UART
+ *
+ * @param enable true to stream
+ */
+void CAP_Stream(bool enable)
+{
+    _stream = enable;
+}
+
+/**
+ * @brief Get the filled buffer half, if any
+ *
+ * @return const uint16_t* CAP_BLOCK_SIZE samples, or NULL if none is ready
+ */
+const uint16_t *CAP_GetBlock(void)
+{
+    uint8_t r = _ready;
+
+    if (r == 0)
+        return NULL;
+
+    return _buf[r - 1];
+}
+
+/**
+ * @brief Hand the buffer half returned by CAP_GetBlock back to the ISR
+ */
+void CAP_ReleaseBlock(void)
+{
+    _ready = 0;
+}
+
+/**
+ * @brief Process and stream a ready block
+ *
+ * @return int 1 if a block was handled, 0 otherwise
+ */
+int CAP_Poll(void)
+{
+    const uint16_t *blk = CAP_GetBlock();
+    UART_IDX con;
+    uint8_t i;
+
+    if (blk == NULL)
+        return 0;
+
+    if (_cb)
+        _cb(blk, CAP_BLOCK_SIZE);
+
+    if (_stream) {
+        con = UART_GetConsole();
+        UART_Send(con, CAP_SYNC1);
+        UART_Send(con, CAP_SYNC2);
+        UART_Send(con, _seq++);
+        UART_Send(con, (uint8_t)_overruns);
+        for (i = 0; i < CAP_BLOCK_SIZE; ++i) {
+            UART_Send(con, (uint8_t)blk[i]);
+            UART_Send(con, (uint8_t)(blk[i] >> 8));
+        }
+    }
+
+    CAP_ReleaseBlock();
+    return 1;
+}
+
+/**
+ * @brief Get the number of blocks dropped because the consumer fell behind
+ *
+ * @return uint16_t Overrun count
+ */
+uint16_t CAP_Overruns(void)
+{
+    return _overruns;
+}
+
+/**
+ * @brief ADC end-of-conversion interrupt service routine
+ */
+void CAP_Isr(void)
+{
+    uint8_t lo, hi;
+
+    // Right alignment: DRL must be read before DRH
+    lo = ADC1->DRL;
+    hi = ADC1->DRH;
+    ADC1->CSR &= (uint8_t)~ADC1_CSR_EOC;
+
+    _buf[_fill][_pos] = (uint16_t)(((uint16_t)hi << 8) | lo);
+    if (++_pos < CAP_BLOCK_SIZE)
+        return;
+
+    _pos = 0;
+    if (_ready) {
+        // Consumer still owns the other half: drop this one
+        ++_overruns;
+        return;
+    }
+
+    _ready = (uint8_t)(_fill + 1);
+    _fill ^= 1;
+}
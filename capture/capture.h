@@ -0,0 +1,125 @@
+/**
+ * @file capture.h
+ * @brief Timer-triggered ADC acquisition interface for STM8S003F3
+ *
+ * This file contains the declarations of the capture functions, types, and
+ * definitions for sampling one ADC channel at a fixed rate set by TIM1,
+ * collecting the samples in ping-pong buffers and streaming them to UART on
+ * the STM8S003F3 microcontroller.
+ */
+
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Samples per buffer half
+ */
+#ifndef CAP_BLOCK_SIZE
+#define CAP_BLOCK_SIZE  32
+#endif
+
+/**
+ * @brief Block header sent before each streamed block
+ */
+#define CAP_SYNC1       0xA5
+#define CAP_SYNC2       0x5A
+
+/**
+ * @brief Enumeration of capture operation results
+ */
+typedef enum {
+  CAP_RESULT_OK,
+  CAP_RESULT_INVALID_PARAM,
+  CAP_RESULT_ERROR
+} CAP_Result;
+
+/**
+ * @brief Block processing callback, called from CAP_Poll
+ *
+ * @param samples Raw ADC samples (use AY_ADC_Correct for calibrated values)
+ * @param n Number of samples (CAP_BLOCK_SIZE)
+ */
+typedef void (*CAP_Callback)(const uint16_t *samples, uint8_t n);
+
+/**
+ * @brief Configure TIM1 and the ADC for triggered sampling
+ *
+ * @param ch ADC channel number (ADC1_CHANNEL_x)
+ * @param rate Sample rate in Hz (1 to 20000)
+ * @return CAP_Result Result of the operation
+ */
+CAP_Result CAP_Init(uint8_t ch, uint32_t rate);
+
+/**
+ * @brief Start or stop sampling
+ *
+ * @param enable true to start, false to stop
+ */
+void CAP_Start(bool enable);
+
+/**
+ * @brief Set the block processing callback
+ *
+ * @param cb Callback, NULL for none
+ */
+void CAP_SetCallback(CAP_Callback cb);
+
+/**
+ * @brief Enable or disable streaming of blocks to the console UART
+ *
+ * Each block is sent as CAP_SYNC1, CAP_SYNC2, a sequence byte, the overrun
+ * count (low byte) and CAP_BLOCK_SIZE samples, low byte first, to the UART
+ * selected with UART_SetConsole.
+ *
+ * @param enable true to stream
+ */
+void CAP_Stream(bool enable);
+
+/**
+ * @brief Get the filled buffer half, if any
+ *
+ * @return const uint16_t* CAP_BLOCK_SIZE samples, or NULL if none is ready
+ */
+const uint16_t *CAP_GetBlock(void);
+
+/**
+ * @brief Hand the buffer half returned by CAP_GetBlock back to the ISR
+ */
+void CAP_ReleaseBlock(void);
+
+/**
+ * @brief Process and stream a ready block
+ *
+ * Must be called from the main loop often enough to consume one block per
+ * CAP_BLOCK_SIZE sample periods.
+ *
+ * @return int 1 if a block was handled, 0 otherwise
+ */
+int CAP_Poll(void);
+
+/**
+ * @brief Get the number of blocks dropped because the consumer fell behind
+ *
+ * @return uint16_t Overrun count
+ */
+uint16_t CAP_Overruns(void);
+
+/**
+ * @brief ADC end-of-conversion interrupt service routine
+ *
+ * Registered with the interrupt module by CAP_Init.
+ */
+void CAP_Isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CAPTURE_H
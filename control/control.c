@@ -0,0 +1,429 @@
+/**
+ * @file control.c
+ * @brief Fixed-point PID control loop implementation for STM8S003F3
+ *
+ * This file contains the implementation of the control loop functions. The
+ * loop runs in the TIM2 update interrupt, so it is synchronous with the PWM
+ * period it drives: every n-th update it takes the ADC result converted since
+ * the previous iteration, starts the next conversion, runs the PID step and
+ * writes the compare register of the output channel. Compare preload is
+ * enabled, so the new duty applies from the next PWM period without glitches.
+ *
+ * The PID uses integer arithmetic only:
+ * - P acts on the error, D on the filtered negative change of the
+ *   measurement (no derivative kick on setpoint steps)
+ * - the integrator is kept with the gain's fractional bits, integrates
+ *   only up to the point where the output saturates in the same direction
+ *   (conditional integration), and is clamped to the output limits
+ * - the output is clamped to the limits
+ *
+ * After Sys_ClockSet the timer module keeps the PWM period constant in time,
+ * scaling the auto-reload value when the prescaler cannot absorb the change.
+ * The loop rate is therefore unchanged; the clock hook here picks up the new
+ * period in counts so the duty cycle keeps its scale.
+ */
+
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "control.h"
+#include "adc.h"
+#include "timer.h"
+#include "system.h"
+#include "interrupt.h"
+
+static volatile uint8_t *_ccr;      // CCRxH of the output channel
+static uint16_t _period;            // PWM period in TIM2 counts
+static uint8_t _n;                  // PWM periods per loop iteration
+static uint8_t _div;
+
+static int16_t _kp = 0, _ki = 0, _kd = 0;
+static uint8_t _dShift = 0;
+static int16_t _min = 0, _max = CTL_FULL_SCALE;
+static int16_t _sp = 0;
+static bool _enabled = false;
+
+static int32_t _integ;              // Integrator, Q15 << CTL_GAIN_Q
+static int16_t _dFilt;              // Filtered -d(measurement)
+static int16_t _measPrev;
+static volatile int16_t _meas = 0;
+static volatile int16_t _out = 0;
+
+static CTL_Stats _stats;
+
+/**
+ * @brief Read the TIM2 counter
+ *
+ * @return uint16_t Counts since the last update event
+ */
+static uint16_t CTL_Counter(void)
+{
+    // Reading CNTRH latches CNTRL
+    uint8_t h = TIM2->CNTRH;
+    return (uint16_t)(((uint16_t)h << 8) | TIM2->CNTRL);
+}
+
+/**
+ * @brief Mask the loop interrupt
+ *
+ * @return uint8_t Previous interrupt enable register
+ */
+static uint8_t CTL_Lock(void)
+{
+    uint8_t ier = TIM2->IER;
+    TIM2->IER = (uint8_t)(ier & ~TIM2_IER_UIE);
+    return ier;
+}
+
+/**
+ * @brief Restore the loop interrupt
+ *
+ * @param ier Value returned by CTL_Lock
+ */
+static void CTL_Unlock(uint8_t ier)
+{
+    TIM2->IER = ier;
+}
+
+/**
+ * @brief Write the output to the PWM compare register
+ *
+ * @param out Output (Q15, 0 to CTL_FULL_SCALE)
+ */
+static void CTL_Write(int16_t out)
+{
+    uint16_t ccr = (uint16_t)(((uint32_t)out * _period) >> 15);
+
+    _out = out;
+    // CCRxH first: the compare is inhibited until CCRxL is written
+    _ccr[0] = (uint8_t)(ccr >> 8);
+    _ccr[1] = (uint8_t)ccr;
+}
+
+/**
+ * @brief Clock change hook, takes over the PWM period set by the timer hook
+ *
+ * Runs after the timer module's hook, which Timer_Init registered first.
+ *
+ * @param fMaster New master clock in Hz
+ */
+static void CTL_ClockChanged(uint32_t fMaster)
+{
+    uint8_t ier = CTL_Lock();
+
+    (void)fMaster;
+    // ARR reads return the preload value
+    _period = (uint16_t)((((uint16_t)TIM2->ARRH << 8) | TIM2->ARRL) + 1);
+    CTL_Write(_out);
+    CTL_Unlock(ier);
+
+    // Times so far are in counts of the old clock
+    CTL_ResetStats();
+}
+
+/**
+ * @brief Run one PID step
+ *
+ * @param meas Measurement (Q15)
+ * @return int16_t Output (Q15), clamped to the limits
+ */
+static int16_t CTL_Step(int16_t meas)
+{
+    int16_t e = (int16_t)(_sp - meas);
+    int32_t dI = (int32_t)_ki * e;
+    int32_t integ = _integ + dI;
+    int32_t lo = (int32_t)_min << CTL_GAIN_Q;
+    int32_t hi = (int32_t)_max << CTL_GAIN_Q;
+    int32_t pd, u, edge;
+
+    // Derivative on measurement through a first-order low-pass
+    _dFilt = (int16_t)(_dFilt + (((int32_t)(_measPrev - meas) - _dFilt) >> _dShift));
+    _measPrev = meas;
+
+    pd = (((int32_t)_kp * e) >> CTL_GAIN_Q) + (((int32_t)_kd * _dFilt) >> CTL_GAIN_Q);
+
+    // Conditional integration: no windup into a saturated output, but an
+    // integrator short of the limit still moves up to it, or the output
+    // would settle just inside the limit
+    u = pd + (integ >> CTL_GAIN_Q);
+    if (u > _max && dI > 0) {
+        edge = ((int32_t)_max - pd) * CTL_GAIN_ONE;
+        integ = edge > _integ ? edge : _integ;
+    } else if (u < _min && dI < 0) {
+        edge = ((int32_t)_min - pd) * CTL_GAIN_ONE;
+        integ = edge < _integ ? edge : _integ;
+    }
+
+    if (integ > hi)
+        integ = hi;
+    else if (integ < lo)
+        integ = lo;
+    _integ = integ;
+
+    u = pd + (integ >> CTL_GAIN_Q);
+    if (u > _max)
+        return _max;
+    if (u < _min)
+        return _min;
+    return (int16_t)u;
+}
+
+/**
+ * @brief Initialize the ADC input, the TIM2 PWM output and the loop
+ *
+ * @param adcCh ADC channel number (ADC1_CHANNEL_x) of the measurement
+ * @param pwmCh TIM2 channel of the output (1-3)
+ * @param rate Loop rate in Hz (CTL_PWM_HZ / 255 to CTL_PWM_HZ)
+ * @param priority Interrupt priority (0-3)
+ * @param pPeriod Receives the PWM period in TIM2 counts, may be NULL
+ * @return CTL_Result Result of the operation
+ */
+CTL_Result CTL_Init(uint8_t adcCh, uint8_t pwmCh, uint16_t rate, uint8_t priority,
+                    uint16_t *pPeriod)
+{
+    uint32_t ticks = Sys_MasterClock() / CTL_PWM_HZ;
+    uint32_t n;
+    uint8_t e = 0;
+
+    if (adcCh > ADC1_CHANNEL_6 || pwmCh < 1 || pwmCh > 3 || priority > 3 ||
+        rate == 0 || rate > CTL_PWM_HZ) {
+        return CTL_RESULT_INVALID_PARAM;
+    }
+    n = (CTL_PWM_HZ + rate / 2) / rate;
+    if (n > 255) {
+        return CTL_RESULT_INVALID_PARAM;
+    }
+
+    _enabled = false;
+    _n = (uint8_t)n;
+    _div = _n;
+
+    // Measurement: single conversions started from the loop
+    AY_ADC_Init_Single();
+    if (AY_ADC_SelectChannel(adcCh) != ADC_RESULT_OK) {
+        return CTL_RESULT_INVALID_PARAM;
+    }
+    ADC1_ClearFlag(ADC1_FLAG_EOC);
+    AY_ADC_Start();
+
+    // PWM: TIM2 prescaler 2^e so the period fits 16 bits
+    while ((ticks >> e) > 0xFFFF)
+        ++e;
+    _period = (uint16_t)(ticks >> e);
+    if (Timer_Init(TIMER_2, (uint16_t)(e + 1), _period, 1) != TIMER_RESULT_OK ||
+        Sys_ClockRegister(CTL_ClockChanged) != 0) {
+        return CTL_RESULT_ERROR;
+    }
+    TIM2_ARRPreloadConfig(ENABLE);
+
+    switch (pwmCh) {
+    case 1:
+        TIM2_OC1Init(TIM2_OCMODE_PWM1, TIM2_OUTPUTSTATE_ENABLE, 0, TIM2_OCPOLARITY_HIGH);
+        TIM2_OC1PreloadConfig(ENABLE);
+        break;
+    case 2:
+        TIM2_OC2Init(TIM2_OCMODE_PWM1, TIM2_OUTPUTSTATE_ENABLE, 0, TIM2_OCPOLARITY_HIGH);
+        TIM2_OC2PreloadConfig(ENABLE);
+        break;
+    default:
+        TIM2_OC3Init(TIM2_OCMODE_PWM1, TIM2_OUTPUTSTATE_ENABLE, 0, TIM2_OCPOLARITY_HIGH);
+        TIM2_OC3PreloadConfig(ENABLE);
+        break;
+    }
+    // CCR1H, CCR1L, CCR2H, ... are consecutive
+    _ccr = &TIM2->CCR1H + 2 * (pwmCh - 1);
+    CTL_Write(_min);
+
+    CTL_ResetStats();
+
+    IRQ_Register(IRQ_TIM2_UPD, CTL_Isr);
+    ITC_SetSoftwarePriority(ITC_IRQ_TIM2_OVF, (ITC_PriorityLevel_TypeDef)priority);
+    TIM2_ClearITPendingBit(TIM2_IT_UPDATE);
+    TIM2_ITConfig(TIM2_IT_UPDATE, ENABLE);
+    Timer_Start(TIMER_2, true);
+
+    if (pPeriod)
+        *pPeriod = _period;
+
+    return CTL_RESULT_OK;
+}
+
+/**
+ * @brief Set the PID gains
+ *
+ * @param kp Proportional gain (Q11)
+ * @param ki Integral gain per sample (Q11)
+ * @param kd Derivative gain per sample (Q11)
+ */
+void CTL_SetGains(int16_t kp, int16_t ki, int16_t kd)
+{
+    uint8_t ier = CTL_Lock();
+
+    _kp = kp;
+    _ki = ki;
+    _kd = kd;
+    CTL_Unlock(ier);
+}
+
+/**
+ * @brief Set the derivative low-pass filter
+ *
+ * @param shift Filter shift (0: unfiltered, up to 7)
+ * @return CTL_Result Result of the operation
+ */
+CTL_Result CTL_SetDFilter(uint8_t shift)
+{
+    if (shift > 7) {
+        return CTL_RESULT_INVALID_PARAM;
+    }
+
+    _dShift = shift;
+    return CTL_RESULT_OK;
+}
+
+/**
+ * @brief Set the output limits
+ *
+ * @param min Lower output limit (Q15)
+ * @param max Upper output limit (Q15)
+ * @return CTL_Result Result of the operation
+ */
+CTL_Result CTL_SetLimits(int16_t min, int16_t max)
+{
+    uint8_t ier;
+
+    if (min < 0 || min >= max) {
+        return CTL_RESULT_INVALID_PARAM;
+    }
+
+    ier = CTL_Lock();
+    _min = min;
+    _max = max;
+    if (!_enabled)
+        CTL_Write(_min);
+    CTL_Unlock(ier);
+
+    return CTL_RESULT_OK;
+}
+
+/**
+ * @brief Set the setpoint
+ *
+ * @param sp Setpoint (Q15, 0 to CTL_FULL_SCALE)
+ */
+void CTL_SetSetpoint(int16_t sp)
+{
+    _sp = sp < 0 ? 0 : sp;
+}
+
+/**
+ * @brief Enable or disable the loop
+ *
+ * @param enable true to run the loop
+ */
+void CTL_Enable(bool enable)
+{
+    uint8_t ier = CTL_Lock();
+
+    if (enable && !_enabled) {
+        _integ = 0;
+        _dFilt = 0;
+        _measPrev = _meas;
+    } else if (!enable) {
+        CTL_Write(_min);
+    }
+    _enabled = enable;
+
+    CTL_Unlock(ier);
+}
+
+/**
+ * @brief Get the latest measurement
+ *
+ * @return int16_t Measurement (Q15)
+ */
+int16_t CTL_Measurement(void)
+{
+    return _meas;
+}
+
+/**
+ * @brief Get the latest output
+ *
+ * @return int16_t Output (Q15)
+ */
+int16_t CTL_Output(void)
+{
+    return _out;
+}
+
+/**
+ * @brief Get the PWM period
+ *
+ * @return uint16_t PWM period in TIM2 counts
+ */
+uint16_t CTL_Period(void)
+{
+    return _period;
+}
+
+/**
+ * @brief Get the loop timing statistics
+ *
+ * @param pStats Receives a consistent copy of the statistics
+ */
+void CTL_GetStats(CTL_Stats *pStats)
+{
+    uint8_t ier = CTL_Lock();
+
+    *pStats = _stats;
+    CTL_Unlock(ier);
+}
+
+/**
+ * @brief Reset the loop timing statistics
+ */
+void CTL_ResetStats(void)
+{
+    uint8_t ier = CTL_Lock();
+
+    _stats.count = 0;
+    _stats.overruns = 0;
+    _stats.maxLatency = 0;
+    _stats.lastExec = 0;
+    _stats.maxExec = 0;
+    CTL_Unlock(ier);
+}
+
+/**
+ * @brief TIM2 update interrupt service routine
+ */
+void CTL_Isr(void)
+{
+    uint16_t t0 = CTL_Counter(), t1;
+
+    TIM2->SR1 = (uint8_t)~TIM2_SR1_UIF;
+
+    if (--_div)
+        return;
+    _div = _n;
+
+    // Result of the conversion started by the previous iteration
+    if (ADC1->CSR & ADC1_CSR_EOC) {
+        _meas = (int16_t)(AY_ADC_Result() << 5);
+        ADC1->CSR &= (uint8_t)~ADC1_CSR_EOC;
+    }
+    AY_ADC_Start();
+
+    if (_enabled)
+        CTL_Write(CTL_Step(_meas));
+
+    t1 = CTL_Counter();
+    if (TIM2->SR1 & TIM2_SR1_UIF)
+        ++_stats.overruns;
+    ++_stats.count;
+    if (t0 > _stats.maxLatency)
+        _stats.maxLatency = t0;
+    _stats.lastExec = t1;
+    if (t1 > _stats.maxExec)
+        _stats.maxExec = t1;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file control.h
+ * @brief Fixed-point PID control loop interface for STM8S003F3
+ *
+ * This file contains the declarations of the control loop functions, types,
+ * and definitions for closing a loop from an ADC input to a TIM2 PWM output
+ * at a fixed rate on the STM8S003F3 microcontroller.
+ *
+ * Setpoint, measurement and output are Q15 fractions of full scale (0 to
+ * 32767). Gains are signed Q11 (CTL_GAIN_ONE == 1.0) and apply per sample:
+ * ki is Ki * T and kd is Kd / T for a loop period T.
+ */
+
+#ifndef __CONTROL_H
+#define __CONTROL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief PWM frequency in Hz; the loop runs every n-th PWM period
+ */
+#ifndef CTL_PWM_HZ
+#define CTL_PWM_HZ      10000UL
+#endif
+
+/**
+ * @brief Fractional bits of the gains
+ */
+#define CTL_GAIN_Q      11
+#define CTL_GAIN_ONE    (1 << CTL_GAIN_Q)
+
+/**
+ * @brief Full scale of setpoint, measurement and output (Q15)
+ */
+#define CTL_FULL_SCALE  32767
+
+/**
+ * @brief Enumeration of control operation results
+ */
+typedef enum {
+  CTL_RESULT_OK,
+  CTL_RESULT_INVALID_PARAM,
+  CTL_RESULT_ERROR
+} CTL_Result;
+
+/**
+ * @brief Loop timing statistics
+ *
+ * Times are in TIM2 counts from the update event, i.e. in PWM period
+ * resolution (CTL_Period returns the period in counts).
+ */
+typedef struct {
+  uint32_t count;       // Loop iterations
+  uint16_t overruns;    // Iterations that did not finish within a PWM period
+  uint16_t maxLatency;  // Worst-case update-to-entry time
+  uint16_t lastExec;    // Update-to-exit time of the last iteration
+  uint16_t maxExec;     // Worst-case update-to-exit time
+} CTL_Stats;
+
+/**
+ * @brief Initialize the ADC input, the TIM2 PWM output and the loop
+ *
+ * The loop starts disabled with all gains zero and the output at its lower
+ * limit. TIM2 update interrupts are taken over by the control loop.
+ *
+ * @param adcCh ADC channel number (ADC1_CHANNEL_x) of the measurement
+ * @param pwmCh TIM2 channel of the output (1-3)
+ * @param rate Loop rate in Hz (CTL_PWM_HZ / 255 to CTL_PWM_HZ); rounded to
+ *             CTL_PWM_HZ / n
+ * @param priority Interrupt priority (0-3)
+ * @param pPeriod Receives the PWM period in TIM2 counts, may be NULL
+ * @return CTL_Result Result of the operation
+ */
+CTL_Result CTL_Init(uint8_t adcCh, uint8_t pwmCh, uint16_t rate, uint8_t priority,
+                    uint16_t *pPeriod);
+
+/**
+ * @brief Set the PID gains
+ *
+ * @param kp Proportional gain (Q11)
+ * @param ki Integral gain per sample (Q11)
+ * @param kd Derivative gain per sample (Q11)
+ */
+void CTL_SetGains(int16_t kp, int16_t ki, int16_t kd);
+
+/**
+ * @brief Set the derivative low-pass filter
+ *
+ * The derivative is filtered with a first-order IIR whose time constant is
+ * about 2^shift samples.
+ *
+ * @param shift Filter shift (0: unfiltered, up to 7)
+ * @return CTL_Result Result of the operation
+ */
+CTL_Result CTL_SetDFilter(uint8_t shift);
+
+/**
+ * @brief Set the output limits
+ *
+ * @param min Lower output limit (Q15)
+ * @param max Upper output limit (Q15)
+ * @return CTL_Result Result of the operation
+ */
+CTL_Result CTL_SetLimits(int16_t min, int16_t max);
+
+/**
+ * @brief Set the setpoint
+ *
+ * @param sp Setpoint (Q15, 0 to CTL_FULL_SCALE)
+ */
+void CTL_SetSetpoint(int16_t sp);
+
+/**
+ * @brief Enable or disable the loop
+ *
+ * Enabling starts from a cleared integrator and derivative; disabling holds
+ * the output at its lower limit.
+ *
+ * @param enable true to run the loop
+ */
+void CTL_Enable(bool enable);
+
+/**
+ * @brief Get the latest measurement
+ *
+ * @return int16_t Measurement (Q15)
+ */
+int16_t CTL_Measurement(void);
+
+/**
+ * @brief Get the latest output
+ *
+ * @return int16_t Output (Q15)
+ */
+int16_t CTL_Output(void);
+
+/**
+ * @brief Get the PWM period
+ *
+ * Changes with Sys_ClockSet when the TIM2 prescaler cannot absorb the new
+ * clock; the statistics are reset then.
+ *
+ * @return uint16_t PWM period in TIM2 counts
+ */
+uint16_t CTL_Period(void);
+
+/**
+ * @brief Get the loop timing statistics
+ *
+ * @param pStats Receives a consistent copy of the statistics
+ */
+void CTL_GetStats(CTL_Stats *pStats);
+
+/**
+ * @brief Reset the loop timing statistics
+ */
+void CTL_ResetStats(void);
+
+/**
+ * @brief TIM2 update interrupt service routine
+ *
+ * Registered with the interrupt module by CTL_Init.
+ */
+void CTL_Isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CONTROL_H
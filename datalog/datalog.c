@@ -0,0 +1,245 @@
+/**
+ * @file datalog.c
+ * @brief Persistent sample/event log in data EEPROM for STM8S003F3
+ *
+ * This file contains the implementation of the data log. Samples and events
+ * are accumulated in a RAM copy of the record and written out as a whole
+ * data EEPROM block, so many updates coalesce into one block program (one
+ * erase/write cycle of ~6 ms instead of ~6 ms per byte).
+ *
+ * Each write goes to the block after the one holding the current record, so
+ * wear is spread over DLOG_NUM_BLOCKS blocks and a power loss during a write
+ * can only corrupt the new copy. At boot the valid record (CRC match) with the
+ * newest sequence number wins.
+ */
+
+#include <string.h>
+#include "stm8s.h"
+#include "datalog.h"
+#include "system.h"
+
+// The record must fill exactly one block
+typedef char DLOG_RecordSizeCheck[(sizeof(DLOG_Record) == FLASH_BLOCK_SIZE) ? 1 : -1];
+
+// Rotation needs a second block so a failed write never hits the last copy
+typedef char DLOG_BlocksCheck[(DLOG_NUM_BLOCKS >= 2 &&
+                               DLOG_FIRST_BLOCK + DLOG_NUM_BLOCKS <= FLASH_DATA_BLOCKS_NUMBER) ? 1 : -1];
+
+#define DLOG_BLOCK(n) \
+    ((const DLOG_Record *)(FLASH_DATA_START_PHYSICAL_ADDRESS + \
+                           (uint16_t)(DLOG_FIRST_BLOCK + (n)) * FLASH_BLOCK_SIZE))
+
+static DLOG_Record _rec;
+static uint8_t _slot = DLOG_NUM_BLOCKS - 1;   // Block holding the latest record
+static uint8_t _dirty = 0;
+static clock_t _lastWrite = 0;
+
+/**
+ * @brief Compute the CRC of a record
+ *
+ * @param rec Record
+ * @return uint16_t CRC of all bytes before the crc field
+ */
+static uint16_t DLog_Crc(const DLOG_Record *rec)
+{
+    return Sys_Crc16(0xFFFF, (const uint8_t *)rec, sizeof(DLOG_Record) - sizeof(rec->crc));
+}
+
+/**
+ * @brief Reset statistics and event counters in the RAM record
+ */
+static void DLog_ResetStats(void)
+{
+    _rec.minVal = 0xFFFF;
+    _rec.maxVal = 0;
+    _rec.count = 0;
+    _rec.sum = 0;
+    memset(_rec.events, 0, sizeof(_rec.events));
+}
+
+/**
+ * @brief Load the most recent valid record from data EEPROM
+ *
+ * @return DLOG_Result DLOG_RESULT_EMPTY if no valid record was found
+ */
+DLOG_Result DLog_Init(void)
+{
+    const DLOG_Record *best = NULL;
+    uint8_t i;
+
+    for (i = 0; i < DLOG_NUM_BLOCKS; ++i) {
+        const DLOG_Record *r = DLOG_BLOCK(i);
+        if (DLog_Crc(r) != r->crc)
+            continue;
+        if (best == NULL || (int16_t)(r->seq - best->seq) > 0) {
+            best = r;
+            _slot = i;
+        }
+    }
+
+    _dirty = 0;
+    _lastWrite = clock();
+
+    if (best == NULL) {
+        memset(&_rec, 0, sizeof(_rec));
+        DLog_ResetStats();
+        _slot = DLOG_NUM_BLOCKS - 1;
+        return DLOG_RESULT_EMPTY;
+    }
+
+    memcpy(&_rec, best, sizeof(_rec));
+    return DLOG_RESULT_OK;
+}
+
+/**
+ * @brief Accumulate a sample into min/max/average
+ *
+ * @param val Sample value
+ */
+void DLog_AddSample(uint16_t val)
+{
+    if (val < _rec.minVal)
+        _rec.minVal = val;
+    if (val > _rec.maxVal)
+        _rec.maxVal = val;
+    _rec.sum += val;
+    ++_rec.count;
+    _dirty = 1;
+}
+
+/**
+ * @brief Increment an event counter
+ *
+ * @param idx Event index (0 to DLOG_NUM_EVENTS - 1)
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_CountEvent(uint8_t idx)
+{
+    if (idx >= DLOG_NUM_EVENTS) {
+        return DLOG_RESULT_INVALID_PARAM;
+    }
+
+    ++_rec.events[idx];
+    _dirty = 1;
+
+    return DLOG_RESULT_OK;
+}
+
+/**
+ * @brief Get the average of all accumulated samples
+ *
+ * @return uint16_t Average value (0 if there are no samples)
+ */
+uint16_t DLog_Average(void)
+{
+    if (_rec.count == 0)
+        return 0;
+
+    return (uint16_t)(_rec.sum / _rec.count);
+}
+
+/**
+ * @brief Get the current (RAM) log record
+ *
+ * @return const DLOG_Record* Current record
+ */
+const DLOG_Record *DLog_Get(void)
+{
+    return &_rec;
+}
+
+/**
+ * @brief Store application data in the log record
+ *
+ * @param offset Offset in the user area
+ * @param data Data to store
+ * @param len Number of bytes
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_SetUser(uint8_t offset, const void *data, uint8_t len)
+{
+    if (data == NULL || (uint16_t)offset + len > DLOG_USER_SIZE) {
+        return DLOG_RESULT_INVALID_PARAM;
+    }
+
+    if (memcmp(&_rec.user[offset], data, len) != 0) {
+        memcpy(&_rec.user[offset], data, len);
+        _dirty = 1;
+    }
+
+    return DLOG_RESULT_OK;
+}
+
+/**
+ * @brief Read application data from the log record
+ *
+ * @param offset Offset in the user area
+ * @param data Buffer for the data
+ * @param len Number of bytes
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_GetUser(uint8_t offset, void *data, uint8_t len)
+{
+    if (data == NULL || (uint16_t)offset + len > DLOG_USER_SIZE) {
+        return DLOG_RESULT_INVALID_PARAM;
+    }
+
+    memcpy(data, &_rec.user[offset], len);
+    return DLOG_RESULT_OK;
+}
+
+/**
+ * @brief Reset statistics and event counters (user data is kept)
+ */
+void DLog_Clear(void)
+{
+    DLog_ResetStats();
+    _dirty = 1;
+}
+
+/**
+ * @brief Write the record to data EEPROM if it has changed
+ *
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_Flush(void)
+{
+    uint8_t next;
+
+    if (!_dirty) {
+        return DLOG_RESULT_OK;
+    }
+
+    next = (uint8_t)((_slot + 1) % DLOG_NUM_BLOCKS);
+
+    ++_rec.seq;
+    _rec.crc = DLog_Crc(&_rec);
+
+    // One block program (erase + write) for the whole record
+    FLASH_Unlock(FLASH_MEMTYPE_DATA);
+    FLASH_ProgramBlock(DLOG_FIRST_BLOCK + next, FLASH_MEMTYPE_DATA,
+                       FLASH_PROGRAMMODE_STANDARD, (uint8_t *)&_rec);
+    FLASH_WaitForLastOperation(FLASH_MEMTYPE_DATA);
+    FLASH_Lock(FLASH_MEMTYPE_DATA);
+
+    _lastWrite = clock();
+
+    if (memcmp(DLOG_BLOCK(next), &_rec, sizeof(_rec)) != 0) {
+        // Keep pointing at the previous good copy; the next flush retries
+        return DLOG_RESULT_VERIFY;
+    }
+
+    _slot = next;
+    _dirty = 0;
+
+    return DLOG_RESULT_OK;
+}
+
+/**
+ * @brief Flush the record once DLOG_FLUSH_MS have elapsed since the last write
+ */
+void DLog_Poll(void)
+{
+    if (_dirty && clock() - _lastWrite >= DLOG_FLUSH_MS)
+        DLog_Flush();
+}
@@ -0,0 +1,163 @@
+/**
+ * @file datalog.h
+ * @brief Persistent sample/event log in data EEPROM for STM8S003F3
+ *
+ * This file contains the declarations of the data log functions, types, and
+ * definitions for accumulating ADC sample statistics and event counts in RAM
+ * and persisting them across resets in the data EEPROM of the STM8S003F3
+ * microcontroller.
+ */
+
+#ifndef __DATALOG_H
+#define __DATALOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm8s.h"
+
+/**
+ * @brief First data EEPROM block used by the log
+ */
+#ifndef DLOG_FIRST_BLOCK
+#define DLOG_FIRST_BLOCK    0
+#endif
+
+/**
+ * @brief Number of data EEPROM blocks the log rotates over (at least 2)
+ *
+ * The STM8S003 has 128 bytes of data EEPROM, although the SPL lists it with
+ * the 640 bytes of the STM8S103 (FLASH_DATA_BLOCKS_NUMBER).
+ */
+#ifndef DLOG_NUM_BLOCKS
+#if defined(STM8S003)
+#define DLOG_NUM_BLOCKS     (128 / FLASH_BLOCK_SIZE)
+#else
+#define DLOG_NUM_BLOCKS     FLASH_DATA_BLOCKS_NUMBER
+#endif
+#endif
+
+/**
+ * @brief Minimum time between automatic flushes in milliseconds
+ */
+#ifndef DLOG_FLUSH_MS
+#define DLOG_FLUSH_MS       60000UL
+#endif
+
+/**
+ * @brief Number of event counters
+ */
+#define DLOG_NUM_EVENTS     4
+
+/**
+ * @brief Bytes of application data persisted along with the log
+ */
+#define DLOG_USER_SIZE      (FLASH_BLOCK_SIZE - 32)
+
+/**
+ * @brief Log record, exactly one data EEPROM block
+ */
+typedef struct {
+  uint16_t seq;                       // Incremented on every write
+  uint16_t minVal;                    // Smallest sample
+  uint16_t maxVal;                    // Largest sample
+  uint32_t count;                     // Number of samples
+  uint32_t sum;                       // Sum of samples
+  uint32_t events[DLOG_NUM_EVENTS];   // Event counters
+  uint8_t user[DLOG_USER_SIZE];       // Application data
+  uint16_t crc;                       // CRC-16 of all preceding bytes
+} DLOG_Record;
+
+/**
+ * @brief Enumeration of data log operation results
+ */
+typedef enum {
+  DLOG_RESULT_OK,
+  DLOG_RESULT_EMPTY,
+  DLOG_RESULT_INVALID_PARAM,
+  DLOG_RESULT_VERIFY,
+  DLOG_RESULT_ERROR
+} DLOG_Result;
+
+/**
+ * @brief Load the most recent valid record from data EEPROM
+ *
+ * @return DLOG_Result DLOG_RESULT_EMPTY if no valid record was found
+ *         (the log then starts from zero)
+ */
+DLOG_Result DLog_Init(void);
+
+/**
+ * @brief Accumulate a sample into min/max/average
+ *
+ * @param val Sample value
+ */
+void DLog_AddSample(uint16_t val);
+
+/**
+ * @brief Increment an event counter
+ *
+ * @param idx Event index (0 to DLOG_NUM_EVENTS - 1)
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_CountEvent(uint8_t idx);
+
+/**
+ * @brief Get the average of all accumulated samples
+ *
+ * @return uint16_t Average value (0 if there are no samples)
+ */
+uint16_t DLog_Average(void);
+
+/**
+ * @brief Get the current (RAM) log record
+ *
+ * @return const DLOG_Record* Current record
+ */
+const DLOG_Record *DLog_Get(void);
+
+/**
+ * @brief Store application data in the log record
+ *
+ * @param offset Offset in the user area
+ * @param data Data to store
+ * @param len Number of bytes
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_SetUser(uint8_t offset, const void *data, uint8_t len);
+
+/**
+ * @brief Read application data from the log record
+ *
+ * @param offset Offset in the user area
+ * @param data Buffer for the data
+ * @param len Number of bytes
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_GetUser(uint8_t offset, void *data, uint8_t len);
+
+/**
+ * @brief Reset statistics and event counters (user data is kept)
+ */
+void DLog_Clear(void);
+
+/**
+ * @brief Write the record to data EEPROM if it has changed
+ *
+ * @return DLOG_Result Result of the operation
+ */
+DLOG_Result DLog_Flush(void);
+
+/**
+ * @brief Flush the record once DLOG_FLUSH_MS have elapsed since the last write
+ *
+ * Must be called periodically from the main loop.
+ */
+void DLog_Poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DATALOG_H
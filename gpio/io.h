@@ -42,6 +42,24 @@ typedef enum {
   // PWM
   IOP_PWM2,
 
+  // SPI
+  IOP_SPI_CS,
+
+  // I2C
+  IOP_I2C_SCL,
+  IOP_I2C_SDA,
+
+  // Stepper
+  IOP_STEP,
+  IOP_DIR,
+
+  // 1-Wire
+  IOP_OW,
+
+  // Software UART
+  IOP_U2RX,
+  IOP_U2TX,
+
   // Add other IO pins as needed
 
   IO_IDX_MAX  // Keep this as the last item
@@ -0,0 +1,464 @@
+/**
+ * @file i2c.c
+ * @brief I2C master driver implementation for STM8S003F3
+ *
+ * This file contains the implementation of I2C functions for initializing the
+ * I2C peripheral as a master and performing non-blocking, interrupt-driven
+ * transactions on the STM8S003F3 microcontroller.
+ *
+ * Each transaction is driven by the I2C event interrupt through the states
+ * start -> address -> write data -> repeated start -> address -> read data ->
+ * stop. Nothing busy-waits on the bus; a transaction that stalls is aborted by
+ * I2C_Poll once it exceeds I2C_TIMEOUT_MS. A transaction that is started
+ * while the STOP of the previous one is still pending waits for I2C_Poll to
+ * issue its START, since the peripheral raises no interrupt when STOP ends.
+ */
+
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "i2c.h"
+#include "io.h"
+#include "system.h"
+#include "interrupt.h"
+
+/**
+ * @brief Enumeration of transaction states
+ */
+typedef enum {
+  I2C_ST_IDLE,
+  I2C_ST_WAIT_STOP, // Previous STOP pending, START issued by I2C_Poll
+  I2C_ST_START_W,   // Waiting for SB, then send write address
+  I2C_ST_START_R,   // Waiting for SB, then send read address
+  I2C_ST_TX,        // Sending data bytes
+  I2C_ST_RX,        // Receiving data bytes
+} I2C_STATE;
+
+#define I2C_ITR_ALL   (I2C_ITR_ITERREN | I2C_ITR_ITEVTEN | I2C_ITR_ITBUFEN)
+#define I2C_SR2_ERRS  (I2C_SR2_AF | I2C_SR2_ARLO | I2C_SR2_BERR | I2C_SR2_OVR)
+
+static I2C_Xfer *_queue[I2C_QUEUE_SIZE];
+static volatile uint8_t _qHead = 0;   // Advanced on completion
+static volatile uint8_t _qTail = 0;   // Advanced by I2C_Submit
+static I2C_Xfer *volatile _cur = NULL;
+static volatile I2C_STATE _state = I2C_ST_IDLE;
+static uint8_t _pos;
+static clock_t _tStart;
+static uint32_t _speed;
+
+/**
+ * @brief Short delay for bit-banged bus recovery (~5 us at 16 MHz)
+ */
+static void I2C_BitDelay(void)
+{
+    volatile uint8_t i;
+    for (i = 0; i < 12; ++i);
+}
+
+/**
+ * @brief Configure the I2C peripheral registers
+ *
+ * The peripheral needs a master clock of at least 1 MHz in standard mode
+ * and 4 MHz in fast mode; below that it is left disabled.
+ *
+ * @return I2C_Result I2C_RESULT_INVALID_PARAM if the master clock is too low
+ */
+static I2C_Result I2C_HwInit(void)
+{
+    uint32_t fMaster = Sys_MasterClock();
+
+    I2C_DeInit();
+    if (fMaster < 1000000 || (_speed > 100000 && fMaster < 4000000)) {
+        return I2C_RESULT_INVALID_PARAM;
+    }
+
+    I2C_Init(_speed, 0x00, I2C_DUTYCYCLE_2, I2C_ACK_CURR,
+             I2C_ADDMODE_7BIT, (uint8_t)(fMaster / 1000000));
+    I2C_Cmd(ENABLE);
+
+    return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Clock change hook, recomputes the SCL timing for the new clock
+ *
+ * Clock switches must not happen while a transaction is in progress. At a
+ * master clock too low for the bus speed the peripheral stays disabled and
+ * transactions time out until the clock is raised again.
+ *
+ * @param fMaster New master clock in Hz
+ */
+static void I2C_ClockChanged(uint32_t fMaster)
+{
+    (void)fMaster;
+    (void)I2C_HwInit();
+}
+
+/**
+ * @brief Issue the START of the current transaction
+ *
+ * @param x Transaction descriptor
+ */
+static void I2C_Launch(I2C_Xfer *x)
+{
+    _state = x->wlen || !x->rlen ? I2C_ST_START_W : I2C_ST_START_R;
+
+    I2C->CR2 |= I2C_CR2_ACK;
+    I2C->ITR |= I2C_ITR_ALL;
+    I2C->CR2 |= I2C_CR2_START;
+}
+
+/**
+ * @brief Start a transaction
+ *
+ * If the STOP of the previous transaction is still pending, the START is
+ * left to I2C_Poll; the timeout covers the wait.
+ *
+ * @param x Transaction descriptor
+ */
+static void I2C_Start(I2C_Xfer *x)
+{
+    _cur = x;
+    _pos = 0;
+    _tStart = clock();
+
+    if (I2C->CR2 & I2C_CR2_STOP) {
+        _state = I2C_ST_WAIT_STOP;
+        return;
+    }
+    I2C_Launch(x);
+}
+
+/**
+ * @brief Complete the current transaction and start the next queued one
+ *
+ * @param result Result to store in the finished descriptor
+ */
+static void I2C_Finish(I2C_Result result)
+{
+    I2C_Xfer *x = _cur;
+
+    I2C->ITR &= (uint8_t)~I2C_ITR_ALL;
+
+    x->result = result;
+    x->busy = 0;
+
+    // Start the next transaction before the callback runs, so a transaction
+    // submitted from the callback is queued behind it rather than started
+    // alongside it
+    _qHead = (uint8_t)((_qHead + 1) & (I2C_QUEUE_SIZE - 1));
+    if (_qHead != _qTail) {
+        I2C_Start(_queue[_qHead]);
+    } else {
+        _cur = NULL;
+        _state = I2C_ST_IDLE;
+    }
+
+    if (x->done)
+        x->done(x);
+}
+
+/**
+ * @brief Initialize the I2C peripheral as master
+ *
+ * @param speed Bus clock in Hz (up to 400000)
+ * @param priority Interrupt priority (0-3)
+ * @return I2C_Result I2C_RESULT_INVALID_PARAM also if the master clock is
+ *         below 1 MHz, or below 4 MHz for speeds above 100000
+ */
+I2C_Result I2C_MasterInit(uint32_t speed, uint8_t priority)
+{
+    if (speed == 0 || speed > 400000 || priority > 3) {
+        return I2C_RESULT_INVALID_PARAM;
+    }
+
+    _speed = speed;
+    _qHead = _qTail = 0;
+    _cur = NULL;
+    _state = I2C_ST_IDLE;
+
+    // Enable I2C clock
+    CLK_PeripheralClockConfig(CLK_PERIPHERAL_I2C, ENABLE);
+
+    // A slave may still hold SDA low from before a reset
+    I2C_BusRecover();
+
+    if (I2C_HwInit() != I2C_RESULT_OK) {
+        return I2C_RESULT_INVALID_PARAM;
+    }
+    if (Sys_ClockRegister(I2C_ClockChanged) != 0) {
+        return I2C_RESULT_ERROR;
+    }
+
+    IRQ_Register(IRQ_I2C, I2C_Isr);
+    ITC_SetSoftwarePriority(ITC_IRQ_I2C, (ITC_PriorityLevel_TypeDef)priority);
+
+    return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Queue a transaction without waiting for it
+ *
+ * @param xfer Transaction descriptor
+ * @return I2C_Result I2C_RESULT_QUEUE_FULL if no slot is free
+ */
+I2C_Result I2C_Submit(I2C_Xfer *xfer)
+{
+    uint8_t itr, next;
+
+    if (xfer == NULL || xfer->addr > 0x7F ||
+        (xfer->wlen && xfer->wdata == NULL) ||
+        (xfer->rlen && xfer->rdata == NULL)) {
+        return I2C_RESULT_INVALID_PARAM;
+    }
+    if (xfer->busy) {
+        return I2C_RESULT_BUSY;
+    }
+
+    next = (uint8_t)((_qTail + 1) & (I2C_QUEUE_SIZE - 1));
+    if (next == _qHead) {
+        return I2C_RESULT_QUEUE_FULL;
+    }
+
+    xfer->busy = 1;
+    xfer->result = I2C_RESULT_BUSY;
+
+    // Mask I2C interrupts so the ISR cannot go idle between the queue
+    // update and the idle check below
+    itr = I2C->ITR;
+    I2C->ITR = (uint8_t)(itr & ~I2C_ITR_ALL);
+
+    _queue[_qTail] = xfer;
+    _qTail = next;
+
+    if (_cur == NULL)
+        I2C_Start(xfer);
+    else
+        I2C->ITR = itr;
+
+    return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Perform a transaction and wait for it to complete
+ *
+ * @param addr 7-bit slave address
+ * @param wdata Bytes to write
+ * @param wlen Number of bytes to write
+ * @param rdata Buffer for read bytes
+ * @param rlen Number of bytes to read
+ * @return I2C_Result Result of the operation
+ */
+I2C_Result I2C_Transfer(uint8_t addr, const uint8_t *wdata, uint8_t wlen,
+                        uint8_t *rdata, uint8_t rlen)
+{
+    I2C_Xfer xfer;
+    I2C_Result result;
+
+    xfer.addr = addr;
+    xfer.wdata = wdata;
+    xfer.wlen = wlen;
+    xfer.rdata = rdata;
+    xfer.rlen = rlen;
+    xfer.done = NULL;
+    xfer.busy = 0;
+
+    while ((result = I2C_Submit(&xfer)) == I2C_RESULT_QUEUE_FULL)
+        I2C_Poll();
+    if (result != I2C_RESULT_OK) {
+        return result;
+    }
+
+    while (xfer.busy)
+        I2C_Poll();
+
+    return xfer.result;
+}
+
+/**
+ * @brief Check if transactions are queued or in progress
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int I2C_Busy(void)
+{
+    return _cur != NULL || _qHead != _qTail;
+}
+
+/**
+ * @brief Start a transaction waiting for STOP and check for timeout
+ */
+void I2C_Poll(void)
+{
+    IRQ_State s;
+    clock_t tStart;
+
+    if (_cur == NULL)
+        return;
+
+    // Interrupts are off while waiting, so only this context touches it
+    if (_state == I2C_ST_WAIT_STOP && !(I2C->CR2 & I2C_CR2_STOP)) {
+        I2C_Launch(_cur);
+        return;
+    }
+
+    // Restarted by the ISR when it moves on to the next transaction; the
+    // 32-bit read is not atomic
+    s = IRQ_Lock();
+    tStart = _tStart;
+    IRQ_Unlock(s);
+
+    if (clock() - tStart < I2C_TIMEOUT_MS)
+        return;
+
+    // Silence the ISR before touching the peripheral from this context
+    I2C->ITR &= (uint8_t)~I2C_ITR_ALL;
+    if (_cur == NULL)
+        return;
+
+    I2C_Cmd(DISABLE);
+    I2C_BusRecover();
+    (void)I2C_HwInit();
+
+    I2C_Finish(I2C_RESULT_TIMEOUT);
+}
+
+/**
+ * @brief Free a stuck bus by clocking SCL until the slave releases SDA
+ *
+ * The peripheral must not be driving the pins while this runs.
+ *
+ * @return I2C_Result I2C_RESULT_BUS_ERROR if SDA is still held low
+ */
+I2C_Result I2C_BusRecover(void)
+{
+    int sda = 1;
+    uint8_t i;
+
+    I2C_Cmd(DISABLE);
+
+    IO_Init(IOP_I2C_SCL, IO_MODE_OUTPUT_OD);
+    IO_Write(IOP_I2C_SCL, 1);
+    IO_Init(IOP_I2C_SDA, IO_MODE_INPUT);
+    I2C_BitDelay();
+
+    // Up to 9 clocks lets a slave finish any byte it is sending
+    for (i = 0; i < 9; ++i) {
+        IO_Read(IOP_I2C_SDA, &sda);
+        if (sda)
+            break;
+        IO_Write(IOP_I2C_SCL, 0);
+        I2C_BitDelay();
+        IO_Write(IOP_I2C_SCL, 1);
+        I2C_BitDelay();
+    }
+
+    // Generate a STOP: SDA low -> high while SCL is high
+    IO_Write(IOP_I2C_SCL, 0);
+    I2C_BitDelay();
+    IO_Init(IOP_I2C_SDA, IO_MODE_OUTPUT_OD);
+    I2C_BitDelay();
+    IO_Write(IOP_I2C_SCL, 1);
+    I2C_BitDelay();
+    IO_Write(IOP_I2C_SDA, 1);
+    I2C_BitDelay();
+
+    IO_Init(IOP_I2C_SDA, IO_MODE_INPUT);
+    IO_Read(IOP_I2C_SDA, &sda);
+
+    return sda ? I2C_RESULT_OK : I2C_RESULT_BUS_ERROR;
+}
+
+/**
+ * @brief I2C interrupt service routine
+ *
+ * Registered with the interrupt module by I2C_MasterInit; applications with
+ * their own vector table call it from the I2C interrupt vector.
+ */
+void I2C_Isr(void)
+{
+    I2C_Xfer *x = _cur;
+    uint8_t sr1, sr2;
+
+    if (x == NULL) {
+        I2C->ITR &= (uint8_t)~I2C_ITR_ALL;
+        return;
+    }
+
+    sr2 = I2C->SR2;
+    if (sr2 & I2C_SR2_ERRS) {
+        I2C->SR2 = 0;
+        // After arbitration loss the master has already released the bus
+        if (!(sr2 & I2C_SR2_ARLO))
+            I2C->CR2 |= I2C_CR2_STOP;
+        I2C_Finish((sr2 & I2C_SR2_AF) ? I2C_RESULT_NACK : I2C_RESULT_BUS_ERROR);
+        return;
+    }
+
+    sr1 = I2C->SR1;
+
+    if (sr1 & I2C_SR1_SB) {
+        // EV5: START sent, send address (clears SB)
+        I2C->DR = (uint8_t)((x->addr << 1) | (_state == I2C_ST_START_R ? 1 : 0));
+        return;
+    }
+
+    if (sr1 & I2C_SR1_ADDR) {
+        // EV6: address acknowledged, ADDR is cleared by reading SR3
+        if (_state == I2C_ST_START_R) {
+            _state = I2C_ST_RX;
+            _pos = 0;
+            if (x->rlen == 1) {
+                // Single byte: NACK it and schedule STOP right away
+                I2C->CR2 &= (uint8_t)~I2C_CR2_ACK;
+                (void)I2C->SR3;
+                I2C->CR2 |= I2C_CR2_STOP;
+            } else {
+                (void)I2C->SR3;
+            }
+        } else {
+            (void)I2C->SR3;
+            _state = I2C_ST_TX;
+            _pos = 0;
+            if (x->wlen == 0) {
+                // Address-only probe
+                I2C->CR2 |= I2C_CR2_STOP;
+                I2C_Finish(I2C_RESULT_OK);
+            }
+        }
+        return;
+    }
+
+    if (_state == I2C_ST_TX && (sr1 & I2C_SR1_TXE)) {
+        if (_pos < x->wlen) {
+            // EV8: data register empty
+            I2C->DR = x->wdata[_pos++];
+        } else if (sr1 & I2C_SR1_BTF) {
+            // EV8_2: last byte shifted out
+            if (x->rlen) {
+                _state = I2C_ST_START_R;
+                I2C->CR2 |= I2C_CR2_ACK;
+                I2C->ITR |= I2C_ITR_ITBUFEN;
+                I2C->CR2 |= I2C_CR2_START;
+            } else {
+                I2C->CR2 |= I2C_CR2_STOP;
+                I2C_Finish(I2C_RESULT_OK);
+            }
+        } else {
+            // Nothing left to load: wait for BTF without TXE storming
+            I2C->ITR &= (uint8_t)~I2C_ITR_ITBUFEN;
+        }
+        return;
+    }
+
+    if (_state == I2C_ST_RX && (sr1 & I2C_SR1_RXNE)) {
+        // EV7: byte received
+        x->rdata[_pos++] = I2C->DR;
+        if (_pos == x->rlen) {
+            I2C_Finish(I2C_RESULT_OK);
+        } else if (_pos == x->rlen - 1) {
+            // Last byte is on the wire: NACK it and STOP afterwards
+            I2C->CR2 &= (uint8_t)~I2C_CR2_ACK;
+            I2C->CR2 |= I2C_CR2_STOP;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file i2c.h
+ * @brief I2C master driver interface for STM8S003F3
+ *
+ * This file contains the declarations of I2C functions, types, and definitions
+ * for initializing the I2C peripheral as a master and performing non-blocking,
+ * interrupt-driven transactions on the STM8S003F3 microcontroller.
+ */
+
+#ifndef __I2C_H
+#define __I2C_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Number of transactions that can be queued at once
+ */
+#define I2C_QUEUE_SIZE  4
+
+/**
+ * @brief Default transaction timeout in milliseconds
+ */
+#define I2C_TIMEOUT_MS  10
+
+/**
+ * @brief Enumeration of I2C operation results
+ */
+typedef enum {
+  I2C_RESULT_OK,
+  I2C_RESULT_INVALID_PARAM,
+  I2C_RESULT_BUSY,
+  I2C_RESULT_QUEUE_FULL,
+  I2C_RESULT_NACK,
+  I2C_RESULT_TIMEOUT,
+  I2C_RESULT_BUS_ERROR,
+  I2C_RESULT_ERROR
+} I2C_Result;
+
+struct I2C_Xfer;
+
+/**
+ * @brief Transfer completion callback, called from interrupt context
+ *        (or from I2C_Poll on timeout)
+ */
+typedef void (*I2C_Callback)(struct I2C_Xfer *xfer);
+
+/**
+ * @brief I2C transaction descriptor
+ *
+ * Writes wlen bytes, then reads rlen bytes after a repeated start. Either
+ * length may be zero; with both zero the slave is only addressed (probe).
+ * The descriptor and its buffers are owned by the caller and must stay valid
+ * until the transaction completes.
+ */
+typedef struct I2C_Xfer {
+  uint8_t addr;           // 7-bit slave address
+  const uint8_t *wdata;   // Bytes to write
+  uint8_t wlen;           // Number of bytes to write
+  uint8_t *rdata;         // Buffer for read bytes
+  uint8_t rlen;           // Number of bytes to read
+  I2C_Callback done;      // Completion callback, may be NULL
+  volatile I2C_Result result;
+  volatile uint8_t busy;  // Non-zero while queued or in progress
+} I2C_Xfer;
+
+/**
+ * @brief Initialize the I2C peripheral as master
+ *
+ * @param speed Bus clock in Hz (up to 400000)
+ * @param priority Interrupt priority (0-3)
+ * @return I2C_Result I2C_RESULT_INVALID_PARAM also if the master clock is
+ *         below 1 MHz, or below 4 MHz for speeds above 100000
+ */
+I2C_Result I2C_MasterInit(uint32_t speed, uint8_t priority);
+
+/**
+ * @brief Queue a transaction without waiting for it
+ *
+ * @param xfer Transaction descriptor
+ * @return I2C_Result I2C_RESULT_QUEUE_FULL if no slot is free
+ */
+I2C_Result I2C_Submit(I2C_Xfer *xfer);
+
+/**
+ * @brief Perform a transaction and wait for it to complete
+ *
+ * @param addr 7-bit slave address
+ * @param wdata Bytes to write
+ * @param wlen Number of bytes to write
+ * @param rdata Buffer for read bytes
+ * @param rlen Number of bytes to read
+ * @return I2C_Result Result of the operation
+ */
+I2C_Result I2C_Transfer(uint8_t addr, const uint8_t *wdata, uint8_t wlen,
+                        uint8_t *rdata, uint8_t rlen);
+
+/**
+ * @brief Check if transactions are queued or in progress
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int I2C_Busy(void);
+
+/**
+ * @brief Start a transaction waiting for STOP and check for timeout
+ *
+ * Must be called periodically from the main loop. Issues the START of a
+ * transaction queued behind one whose STOP was still pending. A transaction
+ * that has not completed within I2C_TIMEOUT_MS is aborted, the bus is
+ * recovered and the transaction completes with I2C_RESULT_TIMEOUT.
+ */
+void I2C_Poll(void);
+
+/**
+ * @brief Free a stuck bus by clocking SCL until the slave releases SDA
+ *
+ * @return I2C_Result I2C_RESULT_BUS_ERROR if SDA is still held low
+ */
+I2C_Result I2C_BusRecover(void);
+
+/**
+ * @brief I2C interrupt service routine
+ *
+ * Registered with the interrupt module by I2C_MasterInit; applications with
+ * their own vector table call it from the I2C interrupt vector.
+ */
+void I2C_Isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __I2C_H
@@ -0,0 +1,272 @@
+/**
+ * @file interrupt.c
+ * @brief Interrupt dispatch implementation for STM8S003F3
+ *
+ * This file defines the interrupt vectors used by the drivers and forwards
+ * each one to the callback registered with IRQ_Register. It replaces the
+ * application's stm8s_it.c for these vectors.
+ *
+ * Without IRQ_PROFILE a dispatch costs one table load, a NULL check and an
+ * indirect call. With IRQ_PROFILE every dispatch also samples the TIM4
+ * counter before and after the callback, so the tick (Sys_TickInit) must be
+ * running for execution times to be meaningful.
+ *
+ * Built with IRQ_NO_VECTORS defined, only the functions are compiled; the
+ * bootloader uses this to keep its own forwarding vectors.
+ */
+
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "interrupt.h"
+#include "uart.h"
+
+/**
+ * @brief CC interrupt mask bits (I1, I0) and their main-loop value
+ */
+#define IRQ_CC_IMASK    0x28
+#define IRQ_CC_LEVEL0   0x20
+
+static IRQ_Handler _handlers[IRQ_IDX_MAX];
+
+// Level being restored by IRQ_Unlock; only used while interrupts are masked
+static volatile uint8_t _irqCC;
+
+#ifdef IRQ_PROFILE
+
+static IRQ_Stats _stats[IRQ_IDX_MAX];
+
+/**
+ * @brief Call a handler and record its timing
+ *
+ * @param idx Interrupt source
+ * @param latency Entry latency sampled at vector entry (0 if not measured)
+ */
+static void IRQ_Profile(IRQ_IDX idx, uint16_t latency)
+{
+    IRQ_Stats *s = &_stats[idx];
+    uint8_t start, end;
+    uint16_t exec;
+
+    start = TIM4->CNTR;
+    if (_handlers[idx])
+        _handlers[idx]();
+    end = TIM4->CNTR;
+
+    // TIM4 counts 0..ARR, assume the handler took less than one tick
+    exec = end >= start ? (uint16_t)(end - start)
+                        : (uint16_t)(end + TIM4->ARR + 1 - start);
+
+    ++s->count;
+    if (latency > s->maxLatency)
+        s->maxLatency = latency;
+    if (exec > s->maxExec)
+        s->maxExec = exec;
+}
+
+#define IRQ_DISPATCH(idx, latency)  IRQ_Profile(idx, latency)
+
+#else
+
+#define IRQ_DISPATCH(idx, latency)  do { if (_handlers[idx]) _handlers[idx](); } while (0)
+
+#endif // IRQ_PROFILE
+
+/**
+ * @brief Register a callback for an interrupt source
+ *
+ * @param idx Interrupt source
+ * @param handler Callback, NULL to unregister
+ * @return IRQ_Result Result of the operation
+ */
+IRQ_Result IRQ_Register(IRQ_IDX idx, IRQ_Handler handler)
+{
+    if (idx >= IRQ_IDX_MAX) {
+        return IRQ_RESULT_INVALID_IRQ;
+    }
+
+    // A pointer store is not atomic on STM8; drivers register before they
+    // enable the source's interrupt
+    _handlers[idx] = handler;
+
+    return IRQ_RESULT_OK;
+}
+
+/**
+ * @brief Mask all maskable interrupts
+ *
+ * @return IRQ_State Interrupt level to restore
+ */
+IRQ_State IRQ_Lock(void)
+{
+    IRQ_State s = ITC_GetCPUCC();
+
+    disableInterrupts();
+    return s;
+}
+
+/**
+ * @brief Restore the interrupt level saved by IRQ_Lock
+ *
+ * Only the saved CC brings a handler back to its own level; rim would lower
+ * it to the main-loop level.
+ *
+ * @param s Value returned by the matching IRQ_Lock
+ */
+void IRQ_Unlock(IRQ_State s)
+{
+    _irqCC = s;
+#if defined(_COSMIC_)
+    _asm("ld a,__irqCC\n push a\n pop cc");
+#elif defined(_SDCC_) || defined(__SDCC)
+    __asm__("ld a, __irqCC\n push a\n pop cc");
+#elif defined(_IAR_)
+    __set_interrupt_state((__istate_t)_irqCC);
+#else
+    // No CC access: handlers stay masked until their IRET restores CC
+    if ((_irqCC & IRQ_CC_IMASK) == IRQ_CC_LEVEL0)
+        enableInterrupts();
+#endif
+}
+
+/**
+ * @brief Get the statistics of an interrupt source
+ *
+ * @param idx Interrupt source
+ * @param pStats Pointer to store the statistics
+ * @return IRQ_Result IRQ_RESULT_ERROR if built without IRQ_PROFILE
+ */
+IRQ_Result IRQ_GetStats(IRQ_IDX idx, IRQ_Stats *pStats)
+{
+    if (idx >= IRQ_IDX_MAX || pStats == NULL) {
+        return IRQ_RESULT_INVALID_IRQ;
+    }
+
+#ifdef IRQ_PROFILE
+    IRQ_State s = IRQ_Lock();
+    *pStats = _stats[idx];
+    IRQ_Unlock(s);
+    return IRQ_RESULT_OK;
+#else
+    return IRQ_RESULT_ERROR;
+#endif
+}
+
+/**
+ * @brief Clear the statistics of all interrupt sources
+ */
+void IRQ_ResetStats(void)
+{
+#ifdef IRQ_PROFILE
+    IRQ_State s = IRQ_Lock();
+    uint8_t i;
+
+    for (i = 0; i < IRQ_IDX_MAX; ++i) {
+        _stats[i].count = 0;
+        _stats[i].maxLatency = 0;
+        _stats[i].maxExec = 0;
+    }
+    IRQ_Unlock(s);
+#endif
+}
+
+/**
+ * @brief Print the statistics of all active interrupt sources on the console UART
+ */
+void IRQ_Report(void)
+{
+#ifdef IRQ_PROFILE
+    IRQ_Stats s;
+    uint8_t i;
+
+    UART_puts1("irq count lat exec\n");
+    for (i = 0; i < IRQ_IDX_MAX; ++i) {
+        IRQ_GetStats((IRQ_IDX)i, &s);
+        if (s.count == 0)
+            continue;
+        UART_printf("%u %lu %u %u\n", i, (unsigned long)s.count, s.maxLatency, s.maxExec);
+    }
+#else
+    UART_puts1("IRQ_PROFILE disabled\n");
+#endif
+}
+
+#ifndef IRQ_NO_VECTORS
+
+// Interrupt vectors
+
+INTERRUPT_HANDLER(EXTI_PORTA_IRQHandler, 3)
+{
+    IRQ_DISPATCH(IRQ_EXTI_A, 0);
+}
+
+INTERRUPT_HANDLER(EXTI_PORTB_IRQHandler, 4)
+{
+    IRQ_DISPATCH(IRQ_EXTI_B, 0);
+}
+
+INTERRUPT_HANDLER(EXTI_PORTC_IRQHandler, 5)
+{
+    IRQ_DISPATCH(IRQ_EXTI_C, 0);
+}
+
+INTERRUPT_HANDLER(EXTI_PORTD_IRQHandler, 6)
+{
+    IRQ_DISPATCH(IRQ_EXTI_D, 0);
+}
+
+INTERRUPT_HANDLER(EXTI_PORTE_IRQHandler, 7)
+{
+    IRQ_DISPATCH(IRQ_EXTI_E, 0);
+}
+
+INTERRUPT_HANDLER(SPI_IRQHandler, 10)
+{
+    IRQ_DISPATCH(IRQ_SPI, 0);
+}
+
+INTERRUPT_HANDLER(TIM1_UPD_OVF_TRG_BRK_IRQHandler, 11)
+{
+    IRQ_DISPATCH(IRQ_TIM1_UPD, TIM1_GetCounter());
+}
+
+INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12)
+{
+    IRQ_DISPATCH(IRQ_TIM1_CC, 0);
+}
+
+INTERRUPT_HANDLER(TIM2_UPD_OVF_BRK_IRQHandler, 13)
+{
+    IRQ_DISPATCH(IRQ_TIM2_UPD, TIM2_GetCounter());
+}
+
+INTERRUPT_HANDLER(TIM2_CAP_COM_IRQHandler, 14)
+{
+    IRQ_DISPATCH(IRQ_TIM2_CC, 0);
+}
+
+INTERRUPT_HANDLER(UART1_TX_IRQHandler, 17)
+{
+    IRQ_DISPATCH(IRQ_UART1_TX, 0);
+}
+
+INTERRUPT_HANDLER(UART1_RX_IRQHandler, 18)
+{
+    IRQ_DISPATCH(IRQ_UART1_RX, 0);
+}
+
+INTERRUPT_HANDLER(I2C_IRQHandler, 19)
+{
+    IRQ_DISPATCH(IRQ_I2C, 0);
+}
+
+INTERRUPT_HANDLER(ADC1_IRQHandler, 22)
+{
+    IRQ_DISPATCH(IRQ_ADC1, 0);
+}
+
+INTERRUPT_HANDLER(TIM4_UPD_OVF_IRQHandler, 23)
+{
+    IRQ_DISPATCH(IRQ_TIM4_UPD, TIM4->CNTR);
+}
+
+#endif // IRQ_NO_VECTORS
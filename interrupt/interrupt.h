@@ -0,0 +1,132 @@
+/**
+ * @file interrupt.h
+ * @brief Interrupt dispatch interface for STM8S003F3
+ *
+ * This file contains the declarations of the interrupt dispatch functions,
+ * types, and definitions. The interrupt module owns the interrupt vectors
+ * used by the drivers and forwards each one to a registered callback. Drivers
+ * register their handlers when they are initialized.
+ *
+ * Build with IRQ_PROFILE defined to record per-vector call counts, worst-case
+ * entry latency and worst-case execution time. Build with IRQ_NO_VECTORS
+ * defined to leave the vectors out (bootloader).
+ */
+
+#ifndef __INTERRUPT_H
+#define __INTERRUPT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Enumeration of dispatched interrupt sources
+ */
+typedef enum {
+  IRQ_EXTI_A,
+  IRQ_EXTI_B,
+  IRQ_EXTI_C,
+  IRQ_EXTI_D,
+  IRQ_EXTI_E,
+  IRQ_SPI,
+  IRQ_TIM1_UPD,
+  IRQ_TIM1_CC,
+  IRQ_TIM2_UPD,
+  IRQ_TIM2_CC,
+  IRQ_UART1_TX,
+  IRQ_UART1_RX,
+  IRQ_I2C,
+  IRQ_ADC1,
+  IRQ_TIM4_UPD,
+
+  IRQ_IDX_MAX  // Keep this as the last item
+} IRQ_IDX;
+
+/**
+ * @brief Enumeration of interrupt module operation results
+ */
+typedef enum {
+  IRQ_RESULT_OK,
+  IRQ_RESULT_INVALID_IRQ,
+  IRQ_RESULT_ERROR
+} IRQ_Result;
+
+/**
+ * @brief Saved interrupt level (condition code register)
+ */
+typedef uint8_t IRQ_State;
+
+/**
+ * @brief Interrupt callback
+ *
+ * The callback is responsible for clearing its interrupt flag.
+ */
+typedef void (*IRQ_Handler)(void);
+
+/**
+ * @brief Per-vector statistics (IRQ_PROFILE builds only)
+ *
+ * Times are in TIM4 counts (4 us at 16 MHz). Latency is the time from the
+ * update event to handler entry and is only measured for timer update
+ * vectors; it is in counts of the respective timer.
+ */
+typedef struct {
+  uint32_t count;       // Number of calls
+  uint16_t maxLatency;  // Worst-case entry latency
+  uint16_t maxExec;     // Worst-case execution time
+} IRQ_Stats;
+
+/**
+ * @brief Register a callback for an interrupt source
+ *
+ * Must be called while the source's interrupt is disabled.
+ *
+ * @param idx Interrupt source
+ * @param handler Callback, NULL to unregister
+ * @return IRQ_Result Result of the operation
+ */
+IRQ_Result IRQ_Register(IRQ_IDX idx, IRQ_Handler handler);
+
+/**
+ * @brief Mask all maskable interrupts
+ *
+ * Usable from the main loop and from handlers. Keep the masked section
+ * short and end it with IRQ_Unlock.
+ *
+ * @return IRQ_State Interrupt level to restore
+ */
+IRQ_State IRQ_Lock(void);
+
+/**
+ * @brief Restore the interrupt level saved by IRQ_Lock
+ *
+ * @param s Value returned by the matching IRQ_Lock
+ */
+void IRQ_Unlock(IRQ_State s);
+
+/**
+ * @brief Get the statistics of an interrupt source
+ *
+ * @param idx Interrupt source
+ * @param pStats Pointer to store the statistics
+ * @return IRQ_Result IRQ_RESULT_ERROR if built without IRQ_PROFILE
+ */
+IRQ_Result IRQ_GetStats(IRQ_IDX idx, IRQ_Stats *pStats);
+
+/**
+ * @brief Clear the statistics of all interrupt sources
+ */
+void IRQ_ResetStats(void);
+
+/**
+ * @brief Print the statistics of all active interrupt sources on the console UART
+ */
+void IRQ_Report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __INTERRUPT_H
@@ -0,0 +1,206 @@
+/**
+ * @file log.c
+ * @brief Deferred logging implementation for STM8S003F3
+ *
+ * This file contains the implementation of the logging functions. Entries
+ * are fixed-size records in a ring buffer with free-running 8-bit indices;
+ * producers (main loop and interrupt handlers) reserve and fill a record
+ * with interrupts masked, the main loop consumes them in Log_Poll.
+ *
+ * The store is bracketed by IRQ_Lock/IRQ_Unlock, which restore the caller's
+ * interrupt level right away, so a handler that logs is not left masked
+ * for the rest of its run.
+ */
+
+#include <stdio.h>
+#include "stm8s.h"
+#include "log.h"
+#include "uart.h"
+#include "interrupt.h"
+
+/**
+ * @brief Buffered log entry
+ */
+typedef struct {
+  const char *fmt;              // Format string, also the message ID
+  uint8_t info;                 // Level | argument count << 4
+  uint16_t arg[LOG_MAX_ARGS];
+} LOG_Entry;
+
+typedef char LOG_BufSizeCheck[(LOG_BUF_SIZE >= 2 && LOG_BUF_SIZE <= 128 &&
+                               (LOG_BUF_SIZE & (LOG_BUF_SIZE - 1)) == 0) ? 1 : -1];
+
+static LOG_Entry _buf[LOG_BUF_SIZE];
+static volatile uint8_t _head = 0;      // Next entry to output
+static volatile uint8_t _tail = 0;      // Next free entry
+static volatile uint16_t _dropped = 0;
+static uint16_t _reported = 0;          // Dropped count already output
+static LOG_Mode _mode = LOG_MODE_TEXT;
+
+/**
+ * @brief Store an entry
+ *
+ * @param level Log level
+ * @param fmt Format string
+ * @param n Number of arguments
+ * @param a First argument
+ * @param b Second argument
+ * @param c Third argument
+ */
+static void Log_Put(uint8_t level, const char *fmt, uint8_t n,
+                    uint16_t a, uint16_t b, uint16_t c)
+{
+    LOG_Entry *e;
+    IRQ_State s = IRQ_Lock();
+
+    if ((uint8_t)(_tail - _head) == LOG_BUF_SIZE) {
+        ++_dropped;
+    } else {
+        e = &_buf[_tail & (LOG_BUF_SIZE - 1)];
+        e->fmt = fmt;
+        e->info = (uint8_t)(level | (n << 4));
+        e->arg[0] = a;
+        e->arg[1] = b;
+        e->arg[2] = c;
+        ++_tail;
+    }
+
+    IRQ_Unlock(s);
+}
+
+void Log_Put0(uint8_t level, const char *fmt)
+{
+    Log_Put(level, fmt, 0, 0, 0, 0);
+}
+
+void Log_Put1(uint8_t level, const char *fmt, uint16_t a)
+{
+    Log_Put(level, fmt, 1, a, 0, 0);
+}
+
+void Log_Put2(uint8_t level, const char *fmt, uint16_t a, uint16_t b)
+{
+    Log_Put(level, fmt, 2, a, b, 0);
+}
+
+void Log_Put3(uint8_t level, const char *fmt, uint16_t a, uint16_t b, uint16_t c)
+{
+    Log_Put(level, fmt, 3, a, b, c);
+}
+
+/**
+ * @brief Send a string, expanding newlines
+ *
+ * @param str Null-terminated string
+ */
+static void Log_Puts(const char *str)
+{
+    while (*str) {
+        if (*str == '\n')
+            UART_Send(LOG_UART, '\r');
+        UART_Send(LOG_UART, (unsigned char)*str++);
+    }
+}
+
+/**
+ * @brief Output an entry in the selected mode
+ *
+ * @param e Entry
+ */
+static void Log_Emit(const LOG_Entry *e)
+{
+    static const char lvl[] = "DIWE";
+    char str[48];
+    uint16_t id = (uint16_t)e->fmt;
+    uint8_t i, n = (uint8_t)(e->info >> 4);
+
+    if (_mode == LOG_MODE_BINARY) {
+        UART_Send(LOG_UART, LOG_SYNC1);
+        UART_Send(LOG_UART, LOG_SYNC2);
+        UART_Send(LOG_UART, (uint8_t)id);
+        UART_Send(LOG_UART, (uint8_t)(id >> 8));
+        UART_Send(LOG_UART, e->info);
+        for (i = 0; i < n; ++i) {
+            UART_Send(LOG_UART, (uint8_t)e->arg[i]);
+            UART_Send(LOG_UART, (uint8_t)(e->arg[i] >> 8));
+        }
+        return;
+    }
+
+    str[0] = '[';
+    str[1] = lvl[e->info & 0x03];
+    str[2] = ']';
+    str[3] = ' ';
+    if (e->fmt)
+        snprintf(&str[4], sizeof(str) - 4, e->fmt, e->arg[0], e->arg[1], e->arg[2]);
+    else
+        snprintf(&str[4], sizeof(str) - 4, "%u log entries dropped", e->arg[0]);
+    Log_Puts(str);
+    Log_Puts("\n");
+}
+
+/**
+ * @brief Select the output mode
+ *
+ * @param mode LOG_MODE_TEXT or LOG_MODE_BINARY
+ */
+void Log_SetMode(LOG_Mode mode)
+{
+    _mode = mode;
+}
+
+/**
+ * @brief Output one buffered entry
+ *
+ * @return int 1 if an entry was output, 0 if the buffer is empty
+ */
+int Log_Poll(void)
+{
+    LOG_Entry e;
+    uint16_t d;
+
+    // Report drops first; the count is written from handlers, read it twice
+    do {
+        d = _dropped;
+    } while (d != _dropped);
+    if (d != _reported) {
+        e.fmt = NULL;
+        e.info = (uint8_t)(LOG_LEVEL_WARN | (1 << 4));
+        e.arg[0] = (uint16_t)(d - _reported);
+        _reported = d;
+        Log_Emit(&e);
+        return 1;
+    }
+
+    if (_head == _tail)
+        return 0;
+
+    e = _buf[_head & (LOG_BUF_SIZE - 1)];
+    ++_head;
+    Log_Emit(&e);
+
+    return 1;
+}
+
+/**
+ * @brief Output all buffered entries
+ */
+void Log_Flush(void)
+{
+    while (Log_Poll());
+}
+
+/**
+ * @brief Get the number of entries dropped because the buffer was full
+ *
+ * @return uint16_t Total dropped entries
+ */
+uint16_t Log_Dropped(void)
+{
+    uint16_t d;
+
+    do {
+        d = _dropped;
+    } while (d != _dropped);
+    return d;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file log.h
+ * @brief Deferred logging interface for STM8S003F3
+ *
+ * This file contains the declarations of the logging functions, macros, and
+ * definitions. A log call only stores the format string's address and up to
+ * LOG_MAX_ARGS raw 16-bit arguments in a RAM ring buffer, so it is cheap
+ * enough for interrupt handlers and control loops. Log_Poll formats or
+ * transmits the stored entries later, from the main loop.
+ *
+ * The format string's address is the message ID. In binary mode only the ID
+ * and the arguments are sent; the host rebuilds the message by looking the
+ * address up in the strings of the firmware's ELF file or linker map.
+ *
+ * Binary record (little endian):
+ *
+ *   LOG_SYNC1 LOG_SYNC2 idL idH (level | n << 4) argL argH ...
+ *
+ * A record with ID 0 and one argument reports entries dropped because the
+ * buffer was full.
+ */
+
+#ifndef __LOG_H
+#define __LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Log levels
+ */
+#define LOG_LEVEL_DEBUG     0
+#define LOG_LEVEL_INFO      1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_ERROR     3
+#define LOG_LEVEL_NONE      4
+
+/**
+ * @brief Lowest level compiled in; calls below it generate no code
+ */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL           LOG_LEVEL_INFO
+#endif
+
+/**
+ * @brief Number of buffered entries (power of two)
+ */
+#ifndef LOG_BUF_SIZE
+#define LOG_BUF_SIZE        16
+#endif
+
+/**
+ * @brief Maximum number of arguments per message
+ */
+#define LOG_MAX_ARGS        3
+
+/**
+ * @brief UART used for log output
+ */
+#ifndef LOG_UART
+#define LOG_UART            CON_UART
+#endif
+
+/**
+ * @brief Binary record sync bytes
+ */
+#define LOG_SYNC1           0xA5
+#define LOG_SYNC2           0xC3
+
+/**
+ * @brief Enumeration of output modes
+ */
+typedef enum {
+  LOG_MODE_TEXT,      // Format on the target
+  LOG_MODE_BINARY     // Send ID and raw arguments
+} LOG_Mode;
+
+/**
+ * @brief Log macros
+ *
+ * Take a string literal format and up to LOG_MAX_ARGS integer arguments,
+ * which are stored as 16 bits; use only conversions that take an int
+ * (%d, %u, %x, %c). Interrupts are masked only for the few cycles it
+ * takes to store an entry, then the caller's level is restored.
+ */
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...)      LOG_WRITE(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)      ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...)       LOG_WRITE(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)       ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...)       LOG_WRITE(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...)       ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...)      LOG_WRITE(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...)      ((void)0)
+#endif
+
+// Dispatch on the number of arguments after the format: Log_Put0 ... Log_Put3
+#define LOG_WRITE(lvl, ...)         LOG_CAT(Log_Put, LOG_NARG(__VA_ARGS__))(lvl, __VA_ARGS__)
+#define LOG_NARG(...)               LOG_NARG_(__VA_ARGS__, 3, 2, 1, 0, 0)
+#define LOG_NARG_(f, a, b, c, n, ...) n
+#define LOG_CAT(a, b)               LOG_CAT_(a, b)
+#define LOG_CAT_(a, b)              a##b
+
+void Log_Put0(uint8_t level, const char *fmt);
+void Log_Put1(uint8_t level, const char *fmt, uint16_t a);
+void Log_Put2(uint8_t level, const char *fmt, uint16_t a, uint16_t b);
+void Log_Put3(uint8_t level, const char *fmt, uint16_t a, uint16_t b, uint16_t c);
+
+/**
+ * @brief Select the output mode
+ *
+ * @param mode LOG_MODE_TEXT or LOG_MODE_BINARY
+ */
+void Log_SetMode(LOG_Mode mode);
+
+/**
+ * @brief Output one buffered entry
+ *
+ * Call from the main loop when idle.
+ *
+ * @return int 1 if an entry was output, 0 if the buffer is empty
+ */
+int Log_Poll(void);
+
+/**
+ * @brief Output all buffered entries
+ */
+void Log_Flush(void);
+
+/**
+ * @brief Get the number of entries dropped because the buffer was full
+ *
+ * @return uint16_t Total dropped entries
+ */
+uint16_t Log_Dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LOG_H
@@ -0,0 +1,616 @@
+/**
+ * @file motion.c
+ * @brief Stepper motor pulse generator implementation for STM8S003F3
+ *
+ * This file contains the implementation of the motion functions. TIM2 runs
+ * freely at MOT_TICK_HZ and each step is scheduled by advancing the channel 1
+ * compare value by the current step period, kept in Q16 ticks so fractional
+ * periods average out exactly.
+ *
+ * The period follows a trapezoidal (constant acceleration) profile using
+ * Eiderman's recurrence p' = p * (1 + q + 1.5 q^2) with q = -/+ a * p^2 / F^2
+ * (accelerate/decelerate). It needs only multiplications per step; the
+ * divisions happen once in MOT_SetAccel/MOT_SetSpeed. Deceleration starts
+ * when the steps to the next standstill equal the steps spent accelerating,
+ * which gives a triangular profile for short moves. The next queued move
+ * extends that distance if it continues in the same direction, so the motor
+ * keeps its speed into it; a reversal is planned as a full stop.
+ *
+ * The cruise speed is never below the first-step speed sqrt(2a), which keeps
+ * q below 0.5 on every ramp.
+ *
+ * The STEP pin is raised on ISR entry and lowered after the next period has
+ * been computed, so the pulse is a few microseconds wide.
+ */
+
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "motion.h"
+#include "io.h"
+#include "timer.h"
+#include "system.h"
+#include "interrupt.h"
+#include "spsc.h"
+
+/**
+ * @brief Longest step period, Q16 ticks
+ */
+#define MOT_PERIOD_MAX  0xFFFF0000UL
+
+/**
+ * @brief Minimum lead of a compare over the counter, ticks
+ */
+#define MOT_T_MARGIN    5
+
+/**
+ * @brief Queued move
+ */
+typedef struct {
+  int32_t target;   // Absolute target position (run == 0)
+  int8_t run;       // 0: move to target, +1/-1: run in that direction
+} MOT_Move;
+
+SPSC_DEFINE(MOT_Queue, MOT_Move, MOT_QUEUE_SIZE)
+
+/**
+ * @brief Enumeration of motion states
+ */
+typedef enum {
+  MOT_ST_IDLE,
+  MOT_ST_RUN,       // Accelerating, cruising or adjusting to a new speed
+  MOT_ST_DECEL,     // Decelerating to stop
+} MOT_STATE;
+
+static MOT_Queue_t _queue;
+static volatile MOT_STATE _state = MOT_ST_IDLE;
+static volatile uint8_t _stopReq = 0;
+static int32_t _pos = 0;
+static int8_t _dir = 1;
+static uint8_t _run = 0;
+static uint32_t _stepsLeft;
+static uint32_t _nAcc;          // Steps needed to decelerate to standstill
+static uint32_t _p;             // Current step period, Q16 ticks
+static uint32_t _tNext;         // Time of the next step, Q16 ticks
+static uint32_t _pMin;          // Cruise period, Q16 ticks (at most _pStart)
+static uint32_t _pCruise;       // Cruise period as set, Q16 ticks
+static uint32_t _pStart;        // First step period, Q16 ticks
+static uint32_t _m;             // a / F^2 = _m * 2^(_qShift - 64)
+static int8_t _qShift;
+
+static GPIO_TypeDef *_stepPort, *_dirPort;
+static uint8_t _stepPin, _dirPin;
+
+/**
+ * @brief High 32 bits of a 32x32-bit product
+ *
+ * @param a Factor
+ * @param b Factor
+ * @return uint32_t (a * b) >> 32
+ */
+static uint32_t MOT_MulHi(uint32_t a, uint32_t b)
+{
+    uint16_t ah = (uint16_t)(a >> 16), al = (uint16_t)a;
+    uint16_t bh = (uint16_t)(b >> 16), bl = (uint16_t)b;
+    uint32_t hl = (uint32_t)ah * bl;
+    uint32_t lh = (uint32_t)al * bh;
+    uint32_t mid = (((uint32_t)al * bl) >> 16) + (uint16_t)hl + (uint16_t)lh;
+
+    return (uint32_t)ah * bh + (hl >> 16) + (lh >> 16) + (mid >> 16);
+}
+
+/**
+ * @brief Integer square root
+ *
+ * @param x Value
+ * @return uint16_t floor(sqrt(x))
+ */
+static uint16_t MOT_Sqrt(uint32_t x)
+{
+    uint32_t r = 0, bit = 1UL << 30;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)r;
+}
+
+/**
+ * @brief Divide into a Q16 period
+ *
+ * @param num Numerator
+ * @param den Denominator (below 65536)
+ * @return uint32_t num / den in Q16, saturated at MOT_PERIOD_MAX
+ */
+static uint32_t MOT_Period(uint32_t num, uint32_t den)
+{
+    uint32_t q = num / den;
+
+    if (q > 0xFFFF)
+        return MOT_PERIOD_MAX;
+    return (q << 16) + (((num % den) << 16) / den);
+}
+
+/**
+ * @brief Next step period on an acceleration or deceleration ramp
+ *
+ * @param p Current period, Q16 ticks
+ * @param decel 0 to accelerate, 1 to decelerate
+ * @return uint32_t Next period, Q16 ticks
+ */
+static uint32_t MOT_Ramp(uint32_t p, uint8_t decel)
+{
+    uint32_t q, d, d2 = 0, next;
+
+    // q = a * p^2 / F^2 in Q32 (below 0.5 on the ramp)
+    q = MOT_MulHi(_m, MOT_MulHi(p, p));
+    q = _qShift >= 0 ? q << _qShift : q >> -_qShift;
+
+    d = MOT_MulHi(p, q);
+    if (d == 0)
+        d = 1;
+
+    // Second-order term only matters near standstill
+    if (q > (1UL << 26)) {
+        uint32_t q2 = MOT_MulHi(q, q);
+        d2 = MOT_MulHi(p, q2 + (q2 >> 1));
+    }
+
+    if (!decel)
+        return p - d + d2;
+
+    next = p + d + d2;
+    return next < p ? MOT_PERIOD_MAX : next;
+}
+
+/**
+ * @brief Mask the step interrupt
+ *
+ * @return uint8_t Previous interrupt enable register
+ */
+static uint8_t MOT_Lock(void)
+{
+    uint8_t ier = TIM2->IER;
+    TIM2->IER = (uint8_t)(ier & ~TIM2_IER_CC1IE);
+    return ier;
+}
+
+/**
+ * @brief Restore the step interrupt
+ *
+ * @param ier Value returned by MOT_Lock
+ */
+static void MOT_Unlock(uint8_t ier)
+{
+    TIM2->IER = ier;
+}
+
+/**
+ * @brief Limit the cruise period to the first step period
+ */
+static void MOT_SetMin(void)
+{
+    _pMin = _pCruise < _pStart ? _pCruise : _pStart;
+}
+
+/**
+ * @brief Set the compare value for the next step
+ *
+ * _tNext has just been advanced by _p. If the counter is already past it
+ * (the ISR took longer than the step period, e.g. near MOT_SPEED_MAX), the
+ * step is moved to MOT_T_MARGIN ahead of the counter and the schedule
+ * continues from there; the 16-bit counter would otherwise only match again
+ * after a full wrap.
+ */
+static void MOT_Schedule(void)
+{
+    uint16_t prev = (uint16_t)((_tNext - _p) >> 16);
+    uint16_t t = (uint16_t)(_tNext >> 16);
+    uint16_t early = (uint16_t)(TIM2_GetCounter() + MOT_T_MARGIN);
+
+    if ((uint16_t)(early - prev) >= (uint16_t)(t - prev)) {
+        t = early;
+        _tNext = (uint32_t)t << 16;
+    }
+
+    // CCR1H first: the compare is inhibited until CCR1L is written
+    TIM2->CCR1H = (uint8_t)(t >> 8);
+    TIM2->CCR1L = (uint8_t)t;
+}
+
+/**
+ * @brief Take the next move from the queue
+ *
+ * @return uint8_t 1 if a move was started, 0 if the queue is empty
+ */
+static uint8_t MOT_Begin(void)
+{
+    MOT_Move mv;
+    int32_t d;
+    int8_t dir;
+
+    while (MOT_Queue_Pop(&_queue, &mv)) {
+        if (mv.run) {
+            dir = mv.run > 0 ? 1 : -1;
+        } else {
+            d = mv.target - _pos;
+            if (d == 0)
+                continue;
+            dir = d > 0 ? 1 : -1;
+            _stepsLeft = (uint32_t)(d > 0 ? d : -d);
+        }
+        _run = mv.run != 0;
+
+        // Continue at the current speed in the same direction; a reversal
+        // has been decelerated to standstill
+        if (_state == MOT_ST_IDLE || dir != _dir) {
+            _nAcc = 0;
+            _p = _pStart;
+        }
+
+        _dir = dir;
+        if (_dir > 0)
+            _dirPort->ODR |= _dirPin;
+        else
+            _dirPort->ODR &= (uint8_t)~_dirPin;
+
+        _state = MOT_ST_RUN;
+        return 1;
+    }
+
+    _state = MOT_ST_IDLE;
+    _stopReq = 0;
+    return 0;
+}
+
+/**
+ * @brief Steps the next queued move continues in the current direction
+ *
+ * @return uint32_t Steps beyond the current move's target, 0xFFFFFFFF for
+ *         continuous motion
+ */
+static uint32_t MOT_Continue(void)
+{
+    MOT_Move *mv = MOT_Queue_Peek(&_queue);
+    int32_t d;
+
+    if (mv == NULL)
+        return 0;
+    if (mv->run)
+        return mv->run == _dir ? 0xFFFFFFFFUL : 0;
+
+    d = mv->target - (_pos + _dir * (int32_t)_stepsLeft);
+    if (_dir < 0)
+        d = -d;
+    return d > 0 ? (uint32_t)d : 0;
+}
+
+/**
+ * @brief Queue a move and start it if the motor is idle
+ *
+ * @param mv Move
+ * @return MOT_Result MOT_RESULT_QUEUE_FULL if no slot is free
+ */
+static MOT_Result MOT_Submit(const MOT_Move *mv)
+{
+    uint8_t ier;
+
+    if (!MOT_Queue_Push(&_queue, mv)) {
+        return MOT_RESULT_QUEUE_FULL;
+    }
+
+    ier = MOT_Lock();
+    if (_state == MOT_ST_IDLE) {
+        _stopReq = 0;
+        if (MOT_Begin()) {
+            // First step one start period from now, which also gives DIR
+            // its setup time
+            _tNext = ((uint32_t)TIM2_GetCounter() << 16) + _p;
+            MOT_Schedule();
+            TIM2->SR1 = (uint8_t)~TIM2_SR1_CC1IF;
+            ier |= TIM2_IER_CC1IE;
+        }
+    }
+    MOT_Unlock(ier);
+
+    return MOT_RESULT_OK;
+}
+
+/**
+ * @brief Initialize the STEP/DIR pins and TIM2
+ *
+ * @param priority Interrupt priority (0-3)
+ * @return MOT_Result Result of the operation
+ */
+MOT_Result MOT_Init(uint8_t priority)
+{
+    uint32_t f = Sys_MasterClock();
+    uint8_t e = 0;
+
+    if (priority > 3) {
+        return MOT_RESULT_INVALID_PARAM;
+    }
+
+    IO_Init(IOP_STEP, IO_MODE_OUTPUT);
+    IO_Init(IOP_DIR, IO_MODE_OUTPUT);
+    _stepPort = _ios[IOP_STEP].port;
+    _stepPin = (uint8_t)_ios[IOP_STEP].pin;
+    _dirPort = _ios[IOP_DIR].port;
+    _dirPin = (uint8_t)_ios[IOP_DIR].pin;
+
+    MOT_Queue_Init(&_queue);
+    _state = MOT_ST_IDLE;
+    _stopReq = 0;
+
+    MOT_SetAccel(4000);
+    MOT_SetSpeed(1000);
+
+    // Free-running TIM2 at MOT_TICK_HZ (prescaler 2^e, full 16-bit period)
+    while ((f >> e) > MOT_TICK_HZ)
+        ++e;
+    if (Timer_Init(TIMER_2, (uint16_t)(e + 1), 0, 1) != TIMER_RESULT_OK) {
+        return MOT_RESULT_ERROR;
+    }
+
+    TIM2_OC1Init(TIM2_OCMODE_TIMING, TIM2_OUTPUTSTATE_DISABLE, 0, TIM2_OCPOLARITY_HIGH);
+    TIM2_OC1PreloadConfig(DISABLE);
+
+    IRQ_Register(IRQ_TIM2_CC, MOT_Isr);
+    ITC_SetSoftwarePriority(ITC_IRQ_TIM2_CAPCOM, (ITC_PriorityLevel_TypeDef)priority);
+    Timer_Start(TIMER_2, true);
+
+    return MOT_RESULT_OK;
+}
+
+/**
+ * @brief Set the acceleration (and deceleration) rate
+ *
+ * @param accel Acceleration in steps/s^2 (100 to 100000)
+ * @return MOT_Result MOT_RESULT_BUSY if the motor is moving
+ */
+MOT_Result MOT_SetAccel(uint32_t accel)
+{
+    uint32_t x = accel;
+    uint8_t e = 0, i;
+    uint16_t s;
+
+    if (accel < 100 || accel > 100000) {
+        return MOT_RESULT_INVALID_PARAM;
+    }
+    if (_state != MOT_ST_IDLE) {
+        return MOT_RESULT_BUSY;
+    }
+
+    // m = a / F^2 with F^2 = 10^12 = 2^12 * 15625^2, normalized to 32 bits
+    for (i = 0; i < 2; ++i) {
+        while (!(x & 0x80000000UL)) {
+            x <<= 1;
+            ++e;
+        }
+        x /= 15625;
+    }
+    while (!(x & 0x80000000UL)) {
+        x <<= 1;
+        ++e;
+    }
+    // x = m * 2^(e + 12), q = MulHi(x, p^2) * 2^(64 - (e + 12))
+    _m = x;
+    _qShift = (int8_t)(52 - e);
+
+    // First step from standstill: p1 = F / sqrt(2a) = F * 128 / sqrt(2a * 2^14)
+    s = MOT_Sqrt((accel * 2) << 14);
+    _pStart = MOT_Period(MOT_TICK_HZ << 7, s);
+    MOT_SetMin();
+
+    return MOT_RESULT_OK;
+}
+
+/**
+ * @brief Set the cruise speed
+ *
+ * @param speed Speed in steps/s (MOT_SPEED_MIN to MOT_SPEED_MAX)
+ * @return MOT_Result Result of the operation
+ */
+MOT_Result MOT_SetSpeed(uint16_t speed)
+{
+    uint32_t p;
+    uint8_t ier;
+
+    if (speed < MOT_SPEED_MIN || speed > MOT_SPEED_MAX) {
+        return MOT_RESULT_INVALID_PARAM;
+    }
+
+    p = MOT_Period(MOT_TICK_HZ, speed);
+
+    ier = MOT_Lock();
+    _pCruise = p;
+    MOT_SetMin();
+    MOT_Unlock(ier);
+
+    return MOT_RESULT_OK;
+}
+
+/**
+ * @brief Queue a move to an absolute position
+ *
+ * @param pos Target position in steps
+ * @return MOT_Result MOT_RESULT_QUEUE_FULL if no slot is free
+ */
+MOT_Result MOT_MoveTo(int32_t pos)
+{
+    MOT_Move mv;
+
+    mv.target = pos;
+    mv.run = 0;
+
+    return MOT_Submit(&mv);
+}
+
+/**
+ * @brief Queue continuous motion at the cruise speed until MOT_Stop
+ *
+ * @param dir Direction, positive or negative
+ * @return MOT_Result MOT_RESULT_QUEUE_FULL if no slot is free
+ */
+MOT_Result MOT_Run(int8_t dir)
+{
+    MOT_Move mv;
+
+    if (dir == 0) {
+        return MOT_RESULT_INVALID_PARAM;
+    }
+
+    mv.target = 0;
+    mv.run = dir > 0 ? 1 : -1;
+
+    return MOT_Submit(&mv);
+}
+
+/**
+ * @brief Decelerate to a stop and discard queued moves
+ */
+void MOT_Stop(void)
+{
+    uint8_t ier = MOT_Lock();
+
+    if (_state != MOT_ST_IDLE)
+        _stopReq = 1;
+    MOT_Unlock(ier);
+}
+
+/**
+ * @brief Stop immediately without deceleration and discard queued moves
+ */
+void MOT_Halt(void)
+{
+    MOT_Move mv;
+    uint8_t ier = MOT_Lock();
+
+    while (MOT_Queue_Pop(&_queue, &mv));
+    _state = MOT_ST_IDLE;
+    _stopReq = 0;
+
+    MOT_Unlock((uint8_t)(ier & ~TIM2_IER_CC1IE));
+}
+
+/**
+ * @brief Get the current position
+ *
+ * @return int32_t Position in steps
+ */
+int32_t MOT_Position(void)
+{
+    int32_t pos;
+    uint8_t ier = MOT_Lock();
+
+    pos = _pos;
+    MOT_Unlock(ier);
+
+    return pos;
+}
+
+/**
+ * @brief Set the current position (motor must be idle)
+ *
+ * @param pos Position in steps
+ * @return MOT_Result MOT_RESULT_BUSY if the motor is moving
+ */
+MOT_Result MOT_SetPosition(int32_t pos)
+{
+    if (_state != MOT_ST_IDLE) {
+        return MOT_RESULT_BUSY;
+    }
+
+    _pos = pos;
+    return MOT_RESULT_OK;
+}
+
+/**
+ * @brief Check if the motor is moving or moves are queued
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int MOT_Busy(void)
+{
+    return _state != MOT_ST_IDLE || MOT_Queue_Count(&_queue) != 0;
+}
+
+/**
+ * @brief TIM2 capture/compare interrupt service routine
+ */
+void MOT_Isr(void)
+{
+    MOT_Move mv;
+
+    TIM2->SR1 = (uint8_t)~TIM2_SR1_CC1IF;
+
+    if (_state == MOT_ST_IDLE) {
+        TIM2->IER &= (uint8_t)~TIM2_IER_CC1IE;
+        return;
+    }
+
+    _stepPort->ODR |= _stepPin;
+    _pos += _dir;
+
+    if (_stopReq) {
+        // Decelerate over the steps it took to get up to speed
+        _stopReq = 0;
+        while (MOT_Queue_Pop(&_queue, &mv));
+        if (_run || _stepsLeft > _nAcc + 1)
+            _stepsLeft = _nAcc + 1;
+        _run = 0;
+    }
+
+    if (!_run && --_stepsLeft == 0) {
+        // Chain straight into the next queued move
+        if (MOT_Begin()) {
+            _tNext += _p;
+            MOT_Schedule();
+        } else {
+            TIM2->IER &= (uint8_t)~TIM2_IER_CC1IE;
+        }
+        _stepPort->ODR &= (uint8_t)~_stepPin;
+        return;
+    }
+
+    // Decelerate once the steps to the next standstill are down to the steps
+    // it takes to stop
+    if (!_run && _stepsLeft <= _nAcc && MOT_Continue() <= _nAcc - _stepsLeft)
+        _state = MOT_ST_DECEL;
+    else
+        _state = MOT_ST_RUN;
+
+    if (_state == MOT_ST_RUN) {
+        if (_p > _pMin) {
+            _p = MOT_Ramp(_p, 0);
+            ++_nAcc;
+            if (_p < _pMin)
+                _p = _pMin;
+        } else if (_p < _pMin) {
+            // Cruise speed was lowered
+            _p = MOT_Ramp(_p, 1);
+            if (_nAcc)
+                --_nAcc;
+            if (_p > _pMin)
+                _p = _pMin;
+        }
+    } else {
+        _p = MOT_Ramp(_p, 1);
+        if (_nAcc)
+            --_nAcc;
+        if (_p > _pStart)
+            _p = _pStart;
+    }
+
+    _tNext += _p;
+    MOT_Schedule();
+
+    _stepPort->ODR &= (uint8_t)~_stepPin;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file motion.h
+ * @brief Stepper motor pulse generator interface for STM8S003F3
+ *
+ * This file contains the declarations of the motion functions, types, and
+ * definitions for generating STEP/DIR pulses with trapezoidal acceleration
+ * profiles from the TIM2 output compare interrupt on the STM8S003F3
+ * microcontroller.
+ */
+
+#ifndef __MOTION_H
+#define __MOTION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Step timer frequency in Hz (TIM2 after prescaling)
+ */
+#define MOT_TICK_HZ     1000000UL
+
+/**
+ * @brief Number of moves that can be queued behind the running one
+ */
+#define MOT_QUEUE_SIZE  4
+
+/**
+ * @brief Speed limits in steps per second
+ */
+#define MOT_SPEED_MIN   16
+#define MOT_SPEED_MAX   10000
+
+/**
+ * @brief Enumeration of motion operation results
+ */
+typedef enum {
+  MOT_RESULT_OK,
+  MOT_RESULT_INVALID_PARAM,
+  MOT_RESULT_BUSY,
+  MOT_RESULT_QUEUE_FULL,
+  MOT_RESULT_ERROR
+} MOT_Result;
+
+/**
+ * @brief Initialize the STEP/DIR pins and TIM2
+ *
+ * @param priority Interrupt priority (0-3)
+ * @return MOT_Result Result of the operation
+ */
+MOT_Result MOT_Init(uint8_t priority);
+
+/**
+ * @brief Set the acceleration (and deceleration) rate
+ *
+ * @param accel Acceleration in steps/s^2 (100 to 100000)
+ * @return MOT_Result MOT_RESULT_BUSY if the motor is moving
+ */
+MOT_Result MOT_SetAccel(uint32_t accel);
+
+/**
+ * @brief Set the cruise speed
+ *
+ * Takes effect immediately; a running move accelerates or decelerates to
+ * the new speed. Speeds below the first-step speed sqrt(2 * accel) run at
+ * the first-step speed.
+ *
+ * @param speed Speed in steps/s (MOT_SPEED_MIN to MOT_SPEED_MAX)
+ * @return MOT_Result Result of the operation
+ */
+MOT_Result MOT_SetSpeed(uint16_t speed);
+
+/**
+ * @brief Queue a move to an absolute position
+ *
+ * The move starts as soon as the previous one has finished.
+ *
+ * @param pos Target position in steps
+ * @return MOT_Result MOT_RESULT_QUEUE_FULL if no slot is free
+ */
+MOT_Result MOT_MoveTo(int32_t pos);
+
+/**
+ * @brief Queue continuous motion at the cruise speed until MOT_Stop
+ *
+ * @param dir Direction, positive or negative
+ * @return MOT_Result MOT_RESULT_QUEUE_FULL if no slot is free
+ */
+MOT_Result MOT_Run(int8_t dir);
+
+/**
+ * @brief Decelerate to a stop and discard queued moves
+ */
+void MOT_Stop(void);
+
+/**
+ * @brief Stop immediately without deceleration and discard queued moves
+ */
+void MOT_Halt(void);
+
+/**
+ * @brief Get the current position
+ *
+ * @return int32_t Position in steps
+ */
+int32_t MOT_Position(void);
+
+/**
+ * @brief Set the current position (motor must be idle)
+ *
+ * @param pos Position in steps
+ * @return MOT_Result MOT_RESULT_BUSY if the motor is moving
+ */
+MOT_Result MOT_SetPosition(int32_t pos);
+
+/**
+ * @brief Check if the motor is moving or moves are queued
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int MOT_Busy(void);
+
+/**
+ * @brief TIM2 capture/compare interrupt service routine
+ *
+ * Registered with the interrupt module by MOT_Init.
+ */
+void MOT_Isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MOTION_H
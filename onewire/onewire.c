@@ -0,0 +1,592 @@
+/**
+ * @file onewire.c
+ * @brief 1-Wire master driver implementation for STM8S003F3
+ *
+ * This file contains the implementation of the 1-Wire functions. TIM1 runs
+ * freely at 1 MHz and its channel 1 compare interrupt starts every time slot,
+ * so the CPU is only occupied for the part of a slot that has to be timed to
+ * the microsecond:
+ *
+ * - write 1 / read: 6 us low pulse, for reads sampled 15 us into the slot,
+ *   timed inline against the counter
+ * - write 0: 60 us low, released from the next compare interrupt
+ * - reset: 480 us low and 480 us recovery, both compare-scheduled; presence
+ *   is sampled from 60 us after release
+ *
+ * Slots are 70 us from the start of the low pulse. A compare target that a
+ * late interrupt has already passed is moved to just ahead of the counter,
+ * so lateness only lengthens the recovery time between slots, which the bus
+ * tolerates.
+ */
+
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "onewire.h"
+#include "io.h"
+#include "timer.h"
+#include "system.h"
+#include "interrupt.h"
+
+/**
+ * @brief Slot timer frequency in Hz
+ */
+#define OW_TICK_HZ      1000000UL
+
+/**
+ * @brief Timing in microseconds
+ *
+ * The counter is read up to one tick after it changed, so the minimum low
+ * times are one tick longer than the bus specification.
+ */
+#define OW_T_START      10    // First event after a transaction is started
+#define OW_T_LOW1       6     // Low time of write-1 and read slots
+#define OW_T_SAMPLE     15    // Read sample point from slot start
+#define OW_T_LOW0       61    // Low time of write-0 slots (60 min)
+#define OW_T_SLOT       70    // Slot length including recovery
+#define OW_T_RESET      481   // Reset low time (480 min)
+#define OW_T_PRESENCE   60    // Presence sampling window from release...
+#define OW_T_PRESENCE_END 90  // ...to here
+#define OW_T_RESET_REC  480   // Reset recovery from release
+#define OW_T_MARGIN     5     // Minimum lead of a compare over the counter
+
+/**
+ * @brief Enumeration of transaction states
+ */
+typedef enum {
+  OW_ST_IDLE,
+  OW_ST_RESET,      // Check the bus and pull it low
+  OW_ST_RESET_LOW,  // Reset pulse in progress
+  OW_ST_PRESENCE,   // Sample the presence pulse
+  OW_ST_RESET_END,  // Reset recovery over
+  OW_ST_LOW0,       // Write-0 low time over
+  OW_ST_SLOT,       // Start the next slot
+} OW_STATE;
+
+/**
+ * @brief Enumeration of transaction phases
+ */
+typedef enum {
+  OW_PH_WRITE,
+  OW_PH_SEARCH,
+  OW_PH_READ,
+} OW_PHASE;
+
+/**
+ * @brief Slot operations returned by OW_NextBit
+ */
+#define OW_OP_WRITE0    0
+#define OW_OP_WRITE1    1
+#define OW_OP_READ      2
+#define OW_OP_DONE      3
+
+static OW_Xfer *_queue[OW_QUEUE_SIZE];
+static volatile uint8_t _qHead = 0;   // Advanced on completion
+static volatile uint8_t _qTail = 0;   // Advanced by OW_Submit
+static OW_Xfer *volatile _cur = NULL;
+static volatile OW_STATE _state = OW_ST_IDLE;
+static OW_PHASE _phase;
+static uint16_t _bit;                 // Bit index within the phase
+static uint8_t _sub;                  // Search step: id bit, complement, direction
+static uint8_t _idBits;               // Search bits read in this step
+static uint8_t _lastZero;             // Search: last branch where 0 was taken
+static uint8_t _presence;
+static OW_Result _err;
+static uint16_t _t;                   // Reference time of the current event
+
+static GPIO_TypeDef *_port;
+static uint8_t _pin;
+
+/**
+ * @brief Read the slot timer
+ *
+ * @return uint16_t Counter in microseconds
+ */
+static uint16_t OW_Now(void)
+{
+    // Reading CNTRH latches CNTRL
+    uint8_t h = TIM1->CNTRH;
+    return (uint16_t)(((uint16_t)h << 8) | TIM1->CNTRL);
+}
+
+/**
+ * @brief Schedule the next compare interrupt
+ *
+ * A target that has passed, or is too close to be armed in time, is moved
+ * to OW_T_MARGIN ahead of the counter; the 16-bit counter would otherwise
+ * only match again after a full wrap.
+ *
+ * @param t Counter value
+ */
+static void OW_Schedule(uint16_t t)
+{
+    uint16_t early = (uint16_t)(OW_Now() + OW_T_MARGIN);
+
+    if ((int16_t)(t - early) < 0)
+        t = early;
+
+    // CCR1H first: the compare is inhibited until CCR1L is written
+    TIM1->CCR1H = (uint8_t)(t >> 8);
+    TIM1->CCR1L = (uint8_t)t;
+}
+
+/**
+ * @brief Start a transaction
+ *
+ * @param x Transaction descriptor
+ */
+static void OW_Start(OW_Xfer *x)
+{
+    _cur = x;
+    _phase = OW_PH_WRITE;
+    _bit = 0;
+    _err = OW_RESULT_OK;
+    _state = x->reset ? OW_ST_RESET : OW_ST_SLOT;
+
+    OW_Schedule((uint16_t)(OW_Now() + OW_T_START));
+    TIM1->SR1 = (uint8_t)~TIM1_SR1_CC1IF;
+    TIM1->IER |= TIM1_IER_CC1IE;
+}
+
+/**
+ * @brief Complete the current transaction and start the next queued one
+ *
+ * @param result Result to store in the finished descriptor
+ */
+static void OW_Finish(OW_Result result)
+{
+    OW_Xfer *x = _cur;
+
+    TIM1->IER &= (uint8_t)~TIM1_IER_CC1IE;
+
+    x->result = result;
+    x->busy = 0;
+
+    // Start the next transaction before the callback runs, so a transaction
+    // submitted from the callback is queued behind it rather than started
+    // alongside it
+    _qHead = (uint8_t)((_qHead + 1) & (OW_QUEUE_SIZE - 1));
+    if (_qHead != _qTail) {
+        OW_Start(_queue[_qHead]);
+    } else {
+        _cur = NULL;
+        _state = OW_ST_IDLE;
+    }
+
+    if (x->done)
+        x->done(x);
+}
+
+/**
+ * @brief Pick the operation for the next slot
+ *
+ * @return uint8_t OW_OP_x
+ */
+static uint8_t OW_NextBit(void)
+{
+    OW_Xfer *x = _cur;
+    OW_SearchState *s = x->search;
+    uint8_t n, dir, mask;
+
+    if (_err != OW_RESULT_OK)
+        return OW_OP_DONE;
+
+    if (_phase == OW_PH_WRITE) {
+        if (_bit < (uint16_t)x->wlen * 8) {
+            dir = (uint8_t)((x->wdata[_bit >> 3] >> (_bit & 7)) & 1);
+            ++_bit;
+            return dir;
+        }
+        _bit = 0;
+        if (s != NULL) {
+            if (s->lastDevice) {
+                _err = OW_RESULT_NO_DEVICE;
+                return OW_OP_DONE;
+            }
+            _phase = OW_PH_SEARCH;
+            _sub = 0;
+            _idBits = 0;
+            _lastZero = 0;
+        } else {
+            _phase = OW_PH_READ;
+        }
+    }
+
+    if (_phase == OW_PH_SEARCH) {
+        if (_bit < 64) {
+            if (_sub < 2)
+                return OW_OP_READ;
+
+            // Both bits read: pick the branch (bit numbers are 1-based)
+            n = (uint8_t)(_bit + 1);
+            mask = (uint8_t)(1 << (_bit & 7));
+            if (_idBits == 0) {
+                // Discrepancy: devices with 0 and 1 at this position
+                if (n < s->lastDisc)
+                    dir = (s->rom[_bit >> 3] & mask) ? 1 : 0;
+                else
+                    dir = n == s->lastDisc;
+                if (!dir)
+                    _lastZero = n;
+            } else {
+                dir = _idBits & 1;
+            }
+
+            if (dir)
+                s->rom[_bit >> 3] |= mask;
+            else
+                s->rom[_bit >> 3] &= (uint8_t)~mask;
+
+            ++_bit;
+            _sub = 0;
+            _idBits = 0;
+            return dir;
+        }
+
+        s->lastDisc = _lastZero;
+        s->lastDevice = _lastZero == 0;
+        if (OW_Crc8(0, s->rom, 8) != 0) {
+            _err = OW_RESULT_CRC;
+            return OW_OP_DONE;
+        }
+        _phase = OW_PH_READ;
+        _bit = 0;
+    }
+
+    if (_bit < (uint16_t)x->rlen * 8)
+        return OW_OP_READ;
+
+    return OW_OP_DONE;
+}
+
+/**
+ * @brief Store a bit sampled in a read slot
+ *
+ * @param b Bit value
+ */
+static void OW_GotBit(uint8_t b)
+{
+    uint8_t *p;
+    uint8_t mask;
+
+    if (_phase == OW_PH_SEARCH) {
+        _idBits |= (uint8_t)(b << _sub);
+        if (++_sub == 2 && _idBits == 3) {
+            // Nobody answered, or the device set changed mid-search
+            _err = OW_RESULT_NO_DEVICE;
+        }
+        return;
+    }
+
+    p = &_cur->rdata[_bit >> 3];
+    mask = (uint8_t)(1 << (_bit & 7));
+    if (mask == 1)
+        *p = 0;
+    if (b)
+        *p |= mask;
+    ++_bit;
+}
+
+/**
+ * @brief Start a time slot
+ */
+static void OW_Slot(void)
+{
+    uint8_t op = OW_NextBit();
+
+    if (op == OW_OP_DONE) {
+        OW_Finish(_err);
+        return;
+    }
+
+    _t = OW_Now();
+    _port->ODR &= (uint8_t)~_pin;
+
+    if (op == OW_OP_WRITE0) {
+        _state = OW_ST_LOW0;
+        OW_Schedule((uint16_t)(_t + OW_T_LOW0));
+        return;
+    }
+
+    while ((uint16_t)(OW_Now() - _t) < OW_T_LOW1);
+    _port->ODR |= _pin;
+
+    if (op == OW_OP_READ) {
+        while ((uint16_t)(OW_Now() - _t) < OW_T_SAMPLE);
+        OW_GotBit((_port->IDR & _pin) ? 1 : 0);
+    }
+
+    _state = OW_ST_SLOT;
+    OW_Schedule((uint16_t)(_t + OW_T_SLOT));
+}
+
+/**
+ * @brief Initialize the 1-Wire pin and the slot timer (TIM1)
+ *
+ * @param priority Interrupt priority (0-3)
+ * @return OW_Result Result of the operation
+ */
+OW_Result OW_Init(uint8_t priority)
+{
+    uint32_t f = Sys_MasterClock();
+
+    if (priority > 3 || f < OW_TICK_HZ) {
+        return OW_RESULT_INVALID_PARAM;
+    }
+
+    IO_Init(IOP_OW, IO_MODE_OUTPUT_OD);
+    _port = _ios[IOP_OW].port;
+    _pin = (uint8_t)_ios[IOP_OW].pin;
+    _port->ODR |= _pin;   // Release the bus
+
+    _qHead = _qTail = 0;
+    _cur = NULL;
+    _state = OW_ST_IDLE;
+
+    // Free-running TIM1 at 1 MHz, full 16-bit period
+    if (Timer_Init(TIMER_1, (uint16_t)(f / OW_TICK_HZ), 0, 1) != TIMER_RESULT_OK) {
+        return OW_RESULT_ERROR;
+    }
+    TIM1_OC1Init(TIM1_OCMODE_TIMING, TIM1_OUTPUTSTATE_DISABLE, TIM1_OUTPUTNSTATE_DISABLE,
+                 0, TIM1_OCPOLARITY_HIGH, TIM1_OCNPOLARITY_HIGH,
+                 TIM1_OCIDLESTATE_RESET, TIM1_OCNIDLESTATE_RESET);
+    TIM1_OC1PreloadConfig(DISABLE);
+
+    IRQ_Register(IRQ_TIM1_CC, OW_Isr);
+    ITC_SetSoftwarePriority(ITC_IRQ_TIM1_CAPCOM, (ITC_PriorityLevel_TypeDef)priority);
+    Timer_Start(TIMER_1, true);
+
+    return OW_RESULT_OK;
+}
+
+/**
+ * @brief Queue a transaction without waiting for it
+ *
+ * @param xfer Transaction descriptor
+ * @return OW_Result OW_RESULT_QUEUE_FULL if no slot is free
+ */
+OW_Result OW_Submit(OW_Xfer *xfer)
+{
+    uint8_t ier, next;
+
+    if (xfer == NULL ||
+        (xfer->wlen && xfer->wdata == NULL) ||
+        (xfer->rlen && xfer->rdata == NULL) ||
+        (xfer->search && xfer->wlen == 0)) {
+        return OW_RESULT_INVALID_PARAM;
+    }
+    if (xfer->busy) {
+        return OW_RESULT_BUSY;
+    }
+
+    next = (uint8_t)((_qTail + 1) & (OW_QUEUE_SIZE - 1));
+    if (next == _qHead) {
+        return OW_RESULT_QUEUE_FULL;
+    }
+
+    xfer->busy = 1;
+    xfer->result = OW_RESULT_BUSY;
+
+    // Mask the slot interrupt so the ISR cannot go idle between the queue
+    // update and the idle check below
+    ier = TIM1->IER;
+    TIM1->IER = (uint8_t)(ier & ~TIM1_IER_CC1IE);
+
+    _queue[_qTail] = xfer;
+    _qTail = next;
+
+    if (_cur == NULL)
+        OW_Start(xfer);
+    else
+        TIM1->IER = ier;
+
+    return OW_RESULT_OK;
+}
+
+/**
+ * @brief Perform a transaction and wait for it to complete
+ *
+ * @param reset Non-zero to reset the bus first
+ * @param wdata Bytes to write
+ * @param wlen Number of bytes to write
+ * @param rdata Buffer for read bytes
+ * @param rlen Number of bytes to read
+ * @return OW_Result Result of the operation
+ */
+OW_Result OW_Transfer(uint8_t reset, const uint8_t *wdata, uint8_t wlen,
+                      uint8_t *rdata, uint8_t rlen)
+{
+    OW_Xfer xfer;
+    OW_Result result;
+
+    xfer.reset = reset;
+    xfer.wdata = wdata;
+    xfer.wlen = wlen;
+    xfer.rdata = rdata;
+    xfer.rlen = rlen;
+    xfer.search = NULL;
+    xfer.done = NULL;
+    xfer.busy = 0;
+
+    while ((result = OW_Submit(&xfer)) == OW_RESULT_QUEUE_FULL);
+    if (result != OW_RESULT_OK) {
+        return result;
+    }
+
+    while (xfer.busy);
+
+    return xfer.result;
+}
+
+/**
+ * @brief Clear a ROM search state to start a new enumeration
+ *
+ * @param s Search state
+ */
+void OW_SearchReset(OW_SearchState *s)
+{
+    uint8_t i;
+
+    for (i = 0; i < 8; ++i)
+        s->rom[i] = 0;
+    s->lastDisc = 0;
+    s->lastDevice = 0;
+}
+
+/**
+ * @brief Find the next device on the bus and wait for the result
+ *
+ * @param s Search state
+ * @return OW_Result OW_RESULT_NO_DEVICE when all devices have been found
+ */
+OW_Result OW_Search(OW_SearchState *s)
+{
+    static const uint8_t cmd = OW_CMD_SEARCH_ROM;
+    OW_Xfer xfer;
+    OW_Result result;
+
+    if (s == NULL) {
+        return OW_RESULT_INVALID_PARAM;
+    }
+    if (s->lastDevice) {
+        return OW_RESULT_NO_DEVICE;
+    }
+
+    xfer.reset = 1;
+    xfer.wdata = &cmd;
+    xfer.wlen = 1;
+    xfer.rdata = NULL;
+    xfer.rlen = 0;
+    xfer.search = s;
+    xfer.done = NULL;
+    xfer.busy = 0;
+
+    while ((result = OW_Submit(&xfer)) == OW_RESULT_QUEUE_FULL);
+    if (result != OW_RESULT_OK) {
+        return result;
+    }
+
+    while (xfer.busy);
+
+    return xfer.result;
+}
+
+/**
+ * @brief Check if transactions are queued or in progress
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int OW_Busy(void)
+{
+    return _cur != NULL || _qHead != _qTail;
+}
+
+/**
+ * @brief Update a Dallas/Maxim CRC-8 (polynomial x^8 + x^5 + x^4 + 1)
+ *
+ * @param crc Initial value (0)
+ * @param data Data bytes
+ * @param len Number of bytes
+ * @return uint8_t Updated CRC; 0 over data that ends with its own CRC
+ */
+uint8_t OW_Crc8(uint8_t crc, const uint8_t *data, uint8_t len)
+{
+    uint8_t i;
+
+    while (len--) {
+        crc ^= *data++;
+        for (i = 0; i < 8; ++i)
+            crc = (crc & 1) ? (uint8_t)((crc >> 1) ^ 0x8C) : (uint8_t)(crc >> 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief Timer capture/compare interrupt service routine
+ */
+void OW_Isr(void)
+{
+    uint16_t now;
+
+    TIM1->SR1 = (uint8_t)~TIM1_SR1_CC1IF;
+
+    if (_cur == NULL) {
+        TIM1->IER &= (uint8_t)~TIM1_IER_CC1IE;
+        return;
+    }
+
+    switch (_state) {
+    case OW_ST_RESET:
+        // A shorted bus would look like a presence pulse
+        if (!(_port->IDR & _pin)) {
+            OW_Finish(OW_RESULT_BUS_ERROR);
+            return;
+        }
+        _t = OW_Now();
+        _port->ODR &= (uint8_t)~_pin;
+        _state = OW_ST_RESET_LOW;
+        OW_Schedule((uint16_t)(_t + OW_T_RESET));
+        break;
+
+    case OW_ST_RESET_LOW:
+        _port->ODR |= _pin;
+        _t = OW_Now();
+        _state = OW_ST_PRESENCE;
+        OW_Schedule((uint16_t)(_t + OW_T_PRESENCE));
+        break;
+
+    case OW_ST_PRESENCE:
+        // Every device is low from 60 to 75 us after release
+        _presence = 0;
+        do {
+            if (!(_port->IDR & _pin)) {
+                _presence = 1;
+                break;
+            }
+            now = OW_Now();
+        } while ((uint16_t)(now - _t) < OW_T_PRESENCE_END);
+        _state = OW_ST_RESET_END;
+        OW_Schedule((uint16_t)(_t + OW_T_RESET_REC));
+        break;
+
+    case OW_ST_RESET_END:
+        if (!_presence) {
+            OW_Finish(OW_RESULT_NO_DEVICE);
+            return;
+        }
+        OW_Slot();
+        break;
+
+    case OW_ST_LOW0:
+        _port->ODR |= _pin;
+        _state = OW_ST_SLOT;
+        OW_Schedule((uint16_t)(_t + OW_T_SLOT));
+        break;
+
+    case OW_ST_SLOT:
+        OW_Slot();
+        break;
+
+    default:
+        break;
+    }
+}
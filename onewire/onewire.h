@@ -0,0 +1,163 @@
+/**
+ * @file onewire.h
+ * @brief 1-Wire master driver interface for STM8S003F3
+ *
+ * This file contains the declarations of the 1-Wire functions, types, and
+ * definitions for performing non-blocking, timer-scheduled transactions on an
+ * open-drain GPIO pin of the STM8S003F3 microcontroller.
+ */
+
+#ifndef __ONEWIRE_H
+#define __ONEWIRE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Number of transactions that can be queued at once
+ */
+#define OW_QUEUE_SIZE   4
+
+/**
+ * @brief ROM commands
+ */
+#define OW_CMD_READ_ROM     0x33
+#define OW_CMD_MATCH_ROM    0x55
+#define OW_CMD_SKIP_ROM     0xCC
+#define OW_CMD_SEARCH_ROM   0xF0
+#define OW_CMD_ALARM_SEARCH 0xEC
+
+/**
+ * @brief Enumeration of 1-Wire operation results
+ */
+typedef enum {
+  OW_RESULT_OK,
+  OW_RESULT_INVALID_PARAM,
+  OW_RESULT_BUSY,
+  OW_RESULT_QUEUE_FULL,
+  OW_RESULT_NO_DEVICE,    // No presence pulse, or no (more) devices found
+  OW_RESULT_CRC,
+  OW_RESULT_BUS_ERROR,    // Bus held low before reset
+  OW_RESULT_ERROR
+} OW_Result;
+
+/**
+ * @brief ROM search state
+ *
+ * Clear with OW_SearchReset before the first search. After each successful
+ * search rom holds the device found; lastDevice is set once all devices have
+ * been enumerated.
+ */
+typedef struct {
+  uint8_t rom[8];       // Family code, serial number, CRC
+  uint8_t lastDisc;     // Bit position of the last branch taken (0: none)
+  uint8_t lastDevice;   // Non-zero when the previous search found the last device
+} OW_SearchState;
+
+struct OW_Xfer;
+
+/**
+ * @brief Transfer completion callback, called from interrupt context
+ */
+typedef void (*OW_Callback)(struct OW_Xfer *xfer);
+
+/**
+ * @brief 1-Wire transaction descriptor
+ *
+ * Optionally resets the bus, writes wlen bytes, then reads rlen bytes. With
+ * search set the bytes written must be a search command; the ROM search
+ * follows the write and updates the search state. The descriptor and its
+ * buffers are owned by the caller and must stay valid until the transaction
+ * completes.
+ */
+typedef struct OW_Xfer {
+  uint8_t reset;            // Non-zero to start with a reset/presence cycle
+  const uint8_t *wdata;     // Bytes to write (LSB first on the wire)
+  uint8_t wlen;             // Number of bytes to write
+  uint8_t *rdata;           // Buffer for read bytes
+  uint8_t rlen;             // Number of bytes to read
+  OW_SearchState *search;   // ROM search state, NULL for none
+  OW_Callback done;         // Completion callback, may be NULL
+  volatile OW_Result result;
+  volatile uint8_t busy;    // Non-zero while queued or in progress
+} OW_Xfer;
+
+/**
+ * @brief Initialize the 1-Wire pin and the slot timer (TIM1)
+ *
+ * Priority 3 is recommended: the short parts of a slot are timed inline in
+ * the ISR and must not be stretched by other interrupts.
+ *
+ * @param priority Interrupt priority (0-3)
+ * @return OW_Result Result of the operation
+ */
+OW_Result OW_Init(uint8_t priority);
+
+/**
+ * @brief Queue a transaction without waiting for it
+ *
+ * @param xfer Transaction descriptor
+ * @return OW_Result OW_RESULT_QUEUE_FULL if no slot is free
+ */
+OW_Result OW_Submit(OW_Xfer *xfer);
+
+/**
+ * @brief Perform a transaction and wait for it to complete
+ *
+ * @param reset Non-zero to reset the bus first
+ * @param wdata Bytes to write
+ * @param wlen Number of bytes to write
+ * @param rdata Buffer for read bytes
+ * @param rlen Number of bytes to read
+ * @return OW_Result Result of the operation
+ */
+OW_Result OW_Transfer(uint8_t reset, const uint8_t *wdata, uint8_t wlen,
+                      uint8_t *rdata, uint8_t rlen);
+
+/**
+ * @brief Clear a ROM search state to start a new enumeration
+ *
+ * @param s Search state
+ */
+void OW_SearchReset(OW_SearchState *s);
+
+/**
+ * @brief Find the next device on the bus and wait for the result
+ *
+ * @param s Search state
+ * @return OW_Result OW_RESULT_NO_DEVICE when all devices have been found
+ */
+OW_Result OW_Search(OW_SearchState *s);
+
+/**
+ * @brief Check if transactions are queued or in progress
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int OW_Busy(void);
+
+/**
+ * @brief Update a Dallas/Maxim CRC-8 (polynomial x^8 + x^5 + x^4 + 1)
+ *
+ * @param crc Initial value (0)
+ * @param data Data bytes
+ * @param len Number of bytes
+ * @return uint8_t Updated CRC; 0 over data that ends with its own CRC
+ */
+uint8_t OW_Crc8(uint8_t crc, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Timer capture/compare interrupt service routine
+ *
+ * Registered with the interrupt module by OW_Init.
+ */
+void OW_Isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ONEWIRE_H
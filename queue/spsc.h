@@ -0,0 +1,154 @@
+/**
+ * @file spsc.h
+ * @brief Lock-free single-producer/single-consumer ring queue
+ *
+ * This file contains a header-only ring queue for passing data between one
+ * producer and one consumer, typically an interrupt handler and the main loop,
+ * without disabling interrupts.
+ *
+ * The head index is written only by the producer and the tail index only by
+ * the consumer. Both are 8-bit, so every update is a single atomic store on
+ * the STM8 core. The indices run freely over 0-255 and are masked on access;
+ * their difference is the fill level. An element is always completely
+ * written (read) before the index that publishes (releases) it is stored.
+ *
+ * Usage:
+ * @code
+ * SPSC_DEFINE(RxQ, uint8_t, 32)      // at file scope
+ * static RxQ_t rxq;
+ *
+ * // ISR
+ * RxQ_Push(&rxq, &ch);
+ *
+ * // main loop
+ * while (RxQ_Pop(&rxq, &ch)) { ... }
+ * @endcode
+ */
+
+#ifndef __SPSC_H
+#define __SPSC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Compiler barrier ordering element accesses against index updates
+ *
+ * STM8 compilers do not move memory accesses across volatile ones, so it is
+ * empty there. GCC/Clang builds get an explicit barrier.
+ */
+#ifndef SPSC_BARRIER
+#if defined(__GNUC__)
+#define SPSC_BARRIER()  __asm__ __volatile__("" ::: "memory")
+#else
+#define SPSC_BARRIER()
+#endif
+#endif
+
+/**
+ * @brief Define a queue type and its functions
+ *
+ * Generates the type name##_t and the functions name##_Init, name##_Count,
+ * name##_Free, name##_Push, name##_Pop, name##_Peek, name##_PushN and
+ * name##_PopN.
+ *
+ * @param name Prefix for the generated type and functions
+ * @param type Element type
+ * @param size Capacity, a power of two from 2 to 128
+ */
+#define SPSC_DEFINE(name, type, size)                                          \
+                                                                               \
+typedef char name##_SizeCheck[((size) >= 2 && (size) <= 128 &&                \
+                               ((size) & ((size) - 1)) == 0) ? 1 : -1];       \
+                                                                               \
+typedef struct {                                                               \
+  type buf[size];                                                              \
+  volatile uint8_t head;  /* Written by the producer only */                   \
+  volatile uint8_t tail;  /* Written by the consumer only */                   \
+} name##_t;                                                                    \
+                                                                               \
+static inline void name##_Init(name##_t *q)                                    \
+{                                                                              \
+  q->head = 0;                                                                 \
+  q->tail = 0;                                                                 \
+}                                                                              \
+                                                                               \
+static inline uint8_t name##_Count(const name##_t *q)                         \
+{                                                                              \
+  return (uint8_t)(q->head - q->tail);                                         \
+}                                                                              \
+                                                                               \
+static inline uint8_t name##_Free(const name##_t *q)                          \
+{                                                                              \
+  return (uint8_t)((size) - (uint8_t)(q->head - q->tail));                     \
+}                                                                              \
+                                                                               \
+static inline uint8_t name##_Push(name##_t *q, const type *v)                 \
+{                                                                              \
+  uint8_t h = q->head;                                                         \
+  if ((uint8_t)(h - q->tail) >= (size))                                        \
+    return 0;                                                                  \
+  q->buf[h & ((size) - 1)] = *v;                                               \
+  SPSC_BARRIER();                                                              \
+  q->head = (uint8_t)(h + 1);                                                  \
+  return 1;                                                                    \
+}                                                                              \
+                                                                               \
+static inline uint8_t name##_Pop(name##_t *q, type *v)                        \
+{                                                                              \
+  uint8_t t = q->tail;                                                         \
+  if (q->head == t)                                                            \
+    return 0;                                                                  \
+  SPSC_BARRIER();                                                              \
+  *v = q->buf[t & ((size) - 1)];                                               \
+  SPSC_BARRIER();                                                              \
+  q->tail = (uint8_t)(t + 1);                                                  \
+  return 1;                                                                    \
+}                                                                              \
+                                                                               \
+static inline type *name##_Peek(name##_t *q)                                  \
+{                                                                              \
+  uint8_t t = q->tail;                                                         \
+  if (q->head == t)                                                            \
+    return 0;                                                                  \
+  SPSC_BARRIER();                                                              \
+  return &q->buf[t & ((size) - 1)];                                            \
+}                                                                              \
+                                                                               \
+static inline uint8_t name##_PushN(name##_t *q, const type *src, uint8_t n)   \
+{                                                                              \
+  uint8_t h = q->head;                                                         \
+  uint8_t room = (uint8_t)((size) - (uint8_t)(h - q->tail));                   \
+  uint8_t i;                                                                   \
+  if (n > room)                                                                \
+    n = room;                                                                  \
+  for (i = 0; i < n; ++i)                                                      \
+    q->buf[(uint8_t)(h + i) & ((size) - 1)] = src[i];                          \
+  SPSC_BARRIER();                                                              \
+  q->head = (uint8_t)(h + n);  /* Publish all elements at once */             \
+  return n;                                                                    \
+}                                                                              \
+                                                                               \
+static inline uint8_t name##_PopN(name##_t *q, type *dst, uint8_t n)          \
+{                                                                              \
+  uint8_t t = q->tail;                                                         \
+  uint8_t avail = (uint8_t)(q->head - t);                                      \
+  uint8_t i;                                                                   \
+  if (n > avail)                                                               \
+    n = avail;                                                                 \
+  SPSC_BARRIER();                                                              \
+  for (i = 0; i < n; ++i)                                                      \
+    dst[i] = q->buf[(uint8_t)(t + i) & ((size) - 1)];                          \
+  SPSC_BARRIER();                                                              \
+  q->tail = (uint8_t)(t + n);  /* Release all slots at once */                \
+  return n;                                                                    \
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SPSC_H
@@ -0,0 +1,203 @@
+/**
+ * @file softpwm.c
+ * @brief Software PWM (bit-angle modulation) implementation for STM8S003F3
+ *
+ * This file contains the implementation of the software PWM functions.
+ *
+ * With bit-angle modulation a frame is split into SPWM_BITS slots whose
+ * lengths are 1, 2, 4, ... 128 time units. During slot b every pin whose duty
+ * has bit b set is high, so the average matches duty / 255 with only
+ * SPWM_BITS interrupts per frame instead of 256.
+ *
+ * The output levels for each slot are precomputed per port, so the ISR does
+ * one masked write per port regardless of the number of channels. Tables are
+ * double-buffered: SPWM_Commit rebuilds the back table and the ISR swaps at
+ * the next frame start, so a frame never mixes old and new duties.
+ *
+ * Slot lengths go through the ARR preload register: the ISR at the start of
+ * a slot writes the length of the following one, which the timer loads at
+ * the next update event. A late ISR then only lengthens a slot instead of
+ * letting the counter pass the new reload value and run on to 0xFFFF.
+ *
+ * The ISR rewrites whole output data registers; pins on the same ports that
+ * are not PWM channels keep their level, but writing them from the main loop
+ * can briefly restore a stale PWM level for the remainder of a slot.
+ */
+
+#include <string.h>
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "softpwm.h"
+#include "io.h"
+#include "timer.h"
+#include "system.h"
+#include "interrupt.h"
+
+/**
+ * @brief Timer prescaler; a power of two so clock scaling can keep the unit
+ */
+#define SPWM_PRESCALE   8
+
+static GPIO_TypeDef *_ports[SPWM_MAX_PORTS];
+static uint8_t _keep[SPWM_MAX_PORTS];           // ODR bits not driven by PWM
+static uint8_t _nPorts = 0;
+static uint8_t _chPort[SPWM_MAX_CHANNELS];      // Port index of each channel
+static uint8_t _chPin[SPWM_MAX_CHANNELS];       // Pin mask of each channel
+static uint8_t _nCh = 0;
+static uint8_t _duty[SPWM_MAX_CHANNELS];
+
+static uint8_t _tbl[2][SPWM_BITS][SPWM_MAX_PORTS];  // High pins per slot and port
+static uint16_t _arr[SPWM_BITS];                    // Auto-reload per slot
+static uint8_t _front = 0;                          // Table used by the ISR
+static volatile uint8_t _swap = 0;                  // Back table ready
+static uint8_t _bit = 0;                            // Next slot
+
+/**
+ * @brief Configure the pins and start the PWM timer (TIM1)
+ *
+ * @param pins IO indices of the channels
+ * @param n Number of channels (1 to SPWM_MAX_CHANNELS)
+ * @param frameHz PWM frequency in Hz (20 to 200)
+ * @param priority Interrupt priority (0-3)
+ * @return SPWM_Result SPWM_RESULT_INVALID_PARAM also if the shortest slot is
+ *         below SPWM_MIN_SLOT master clock cycles at the current clock
+ */
+SPWM_Result SPWM_Init(const IO_IDX *pins, uint8_t n, uint16_t frameHz, uint8_t priority)
+{
+    uint16_t unit;
+    uint8_t i, p;
+
+    if (pins == NULL || n == 0 || n > SPWM_MAX_CHANNELS ||
+        frameHz < 20 || frameHz > 200 || priority > 3) {
+        return SPWM_RESULT_INVALID_PARAM;
+    }
+
+    // One time unit is 1/255 of a frame, e.g. 16 MHz / 8 / (100 * 255) = 78
+    unit = (uint16_t)(Sys_MasterClock() / SPWM_PRESCALE / ((uint32_t)frameHz * 255));
+    if ((uint32_t)unit * SPWM_PRESCALE < SPWM_MIN_SLOT) {
+        return SPWM_RESULT_INVALID_PARAM;
+    }
+
+    _nPorts = 0;
+    for (i = 0; i < n; ++i) {
+        if (pins[i] >= IO_IDX_MAX) {
+            return SPWM_RESULT_INVALID_PARAM;
+        }
+
+        for (p = 0; p < _nPorts && _ports[p] != _ios[pins[i]].port; ++p);
+        if (p == _nPorts) {
+            if (_nPorts == SPWM_MAX_PORTS) {
+                return SPWM_RESULT_INVALID_PARAM;
+            }
+            _ports[p] = _ios[pins[i]].port;
+            _keep[p] = 0xFF;
+            ++_nPorts;
+        }
+
+        _chPort[i] = p;
+        _chPin[i] = (uint8_t)_ios[pins[i]].pin;
+        _keep[p] &= (uint8_t)~_chPin[i];
+        _duty[i] = 0;
+
+        IO_Init(pins[i], IO_MODE_OUTPUT);
+    }
+    _nCh = n;
+
+    for (i = 0; i < SPWM_BITS; ++i)
+        _arr[i] = (uint16_t)((unit << i) - 1);
+
+    memset(_tbl, 0, sizeof(_tbl));
+    _front = 0;
+    _swap = 0;
+    _bit = 0;
+
+    if (Timer_Init(TIMER_1, SPWM_PRESCALE, unit, 1) != TIMER_RESULT_OK) {
+        return SPWM_RESULT_ERROR;
+    }
+    // ARR holds slot 0, the first update loads it; the ISR preloads the rest
+    TIM1_ARRPreloadConfig(ENABLE);
+
+    IRQ_Register(IRQ_TIM1_UPD, SPWM_Isr);
+    ITC_SetSoftwarePriority(ITC_IRQ_TIM1_OVF, (ITC_PriorityLevel_TypeDef)priority);
+    TIM1_ClearITPendingBit(TIM1_IT_UPDATE);
+    TIM1_ITConfig(TIM1_IT_UPDATE, ENABLE);
+    Timer_Start(TIMER_1, true);
+
+    return SPWM_RESULT_OK;
+}
+
+/**
+ * @brief Set the duty of a channel (takes effect on SPWM_Commit)
+ *
+ * @param ch Channel index
+ * @param duty Duty cycle, 0 (off) to 255 (fully on)
+ * @return SPWM_Result Result of the operation
+ */
+SPWM_Result SPWM_Set(uint8_t ch, uint8_t duty)
+{
+    if (ch >= _nCh) {
+        return SPWM_RESULT_INVALID_PARAM;
+    }
+
+    _duty[ch] = duty;
+    return SPWM_RESULT_OK;
+}
+
+/**
+ * @brief Apply all duties set since the last commit at the next frame start
+ *
+ * @return SPWM_Result SPWM_RESULT_BUSY if the previous commit is still pending
+ */
+SPWM_Result SPWM_Commit(void)
+{
+    uint8_t (*back)[SPWM_MAX_PORTS];
+    uint8_t b, i, mask;
+
+    if (_swap) {
+        return SPWM_RESULT_BUSY;
+    }
+
+    back = _tbl[_front ^ 1];
+    memset(back, 0, sizeof(_tbl[0]));
+
+    for (i = 0; i < _nCh; ++i) {
+        mask = _duty[i];
+        for (b = 0; b < SPWM_BITS; ++b, mask >>= 1) {
+            if (mask & 1)
+                back[b][_chPort[i]] |= _chPin[i];
+        }
+    }
+
+    _swap = 1;
+    return SPWM_RESULT_OK;
+}
+
+/**
+ * @brief Timer update interrupt service routine
+ */
+void SPWM_Isr(void)
+{
+    const uint8_t *lvl;
+    uint16_t arr;
+    uint8_t p;
+
+    TIM1->SR1 = (uint8_t)~TIM1_SR1_UIF;
+
+    if (_bit == 0 && _swap) {
+        _front ^= 1;
+        _swap = 0;
+    }
+
+    // Outputs for this slot: one masked write per port
+    lvl = _tbl[_front][_bit];
+    for (p = 0; p < _nPorts; ++p)
+        _ports[p]->ODR = (uint8_t)((_ports[p]->ODR & _keep[p]) | lvl[p]);
+
+    if (++_bit == SPWM_BITS)
+        _bit = 0;
+
+    // Length of the next slot, loaded at the end of this one
+    arr = _arr[_bit];
+    TIM1->ARRH = (uint8_t)(arr >> 8);
+    TIM1->ARRL = (uint8_t)arr;
+}
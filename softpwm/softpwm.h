@@ -0,0 +1,96 @@
+/**
+ * @file softpwm.h
+ * @brief Software PWM (bit-angle modulation) interface for STM8S003F3
+ *
+ * This file contains the declarations of the software PWM functions, types,
+ * and definitions for dimming many GPIO pins from a single hardware timer on
+ * the STM8S003F3 microcontroller.
+ */
+
+#ifndef __SOFTPWM_H
+#define __SOFTPWM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "io.h"  // For IO_IDX type
+
+/**
+ * @brief Maximum number of software PWM channels
+ */
+#ifndef SPWM_MAX_CHANNELS
+#define SPWM_MAX_CHANNELS   12
+#endif
+
+/**
+ * @brief Maximum number of distinct GPIO ports used by the channels
+ */
+#define SPWM_MAX_PORTS      4
+
+/**
+ * @brief Duty resolution in bits (duty 0-255)
+ */
+#define SPWM_BITS           8
+
+/**
+ * @brief Shortest slot in master clock cycles, to leave room for the ISR
+ */
+#ifndef SPWM_MIN_SLOT
+#define SPWM_MIN_SLOT       256
+#endif
+
+/**
+ * @brief Enumeration of software PWM operation results
+ */
+typedef enum {
+  SPWM_RESULT_OK,
+  SPWM_RESULT_INVALID_PARAM,
+  SPWM_RESULT_BUSY,
+  SPWM_RESULT_ERROR
+} SPWM_Result;
+
+/**
+ * @brief Configure the pins and start the PWM timer (TIM1)
+ *
+ * All duties start at 0. The shortest slot is 1/255 of a frame and must be
+ * at least SPWM_MIN_SLOT master clock cycles, e.g. 200 Hz needs 16 MHz.
+ *
+ * @param pins IO indices of the channels
+ * @param n Number of channels (1 to SPWM_MAX_CHANNELS)
+ * @param frameHz PWM frequency in Hz (20 to 200)
+ * @param priority Interrupt priority (0-3)
+ * @return SPWM_Result SPWM_RESULT_INVALID_PARAM also if the shortest slot is
+ *         too short at the current clock
+ */
+SPWM_Result SPWM_Init(const IO_IDX *pins, uint8_t n, uint16_t frameHz, uint8_t priority);
+
+/**
+ * @brief Set the duty of a channel (takes effect on SPWM_Commit)
+ *
+ * @param ch Channel index
+ * @param duty Duty cycle, 0 (off) to 255 (fully on)
+ * @return SPWM_Result Result of the operation
+ */
+SPWM_Result SPWM_Set(uint8_t ch, uint8_t duty);
+
+/**
+ * @brief Apply all duties set since the last commit at the next frame start
+ *
+ * @return SPWM_Result SPWM_RESULT_BUSY if the previous commit is still pending
+ */
+SPWM_Result SPWM_Commit(void);
+
+/**
+ * @brief Timer update interrupt service routine
+ *
+ * Registered with the interrupt module by SPWM_Init.
+ */
+void SPWM_Isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SOFTPWM_H
@@ -0,0 +1,252 @@
+/**
+ * @file spi.c
+ * @brief SPI master driver implementation for STM8S003F3
+ *
+ * This file contains the implementation of SPI functions for initializing the
+ * SPI peripheral as a master and performing interrupt-driven, full-duplex
+ * block transfers on the STM8S003F3 microcontroller.
+ *
+ * Transactions are queued and then clocked by the TXE/RXNE interrupts, so the
+ * CPU is only involved once per byte for the time it takes to move it between
+ * memory and the data register. At most two bytes are in flight (data register
+ * plus shift register) so the receiver can never overrun.
+ */
+
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "spi.h"
+#include "io.h"
+#include "interrupt.h"
+
+static SPI_Xfer *_queue[SPI_QUEUE_SIZE];
+static volatile uint8_t _qHead = 0;   // Advanced by the ISR
+static volatile uint8_t _qTail = 0;   // Advanced by SPI_Submit
+static SPI_Xfer *volatile _cur = NULL;
+static uint16_t _txPos, _rxPos;
+
+/**
+ * @brief Start clocking a transaction
+ *
+ * @param x Transaction descriptor
+ */
+static void SPI_Start(SPI_Xfer *x)
+{
+    _cur = x;
+    _txPos = 0;
+    _rxPos = 0;
+
+    if (x->cs != SPI_NO_CS)
+        IO_Write(x->cs, 0);
+
+    // TXE fires immediately since the data register is empty
+    SPI->ICR |= SPI_ICR_RXEI | SPI_ICR_TXEI;
+}
+
+/**
+ * @brief Complete the current transaction and start the next queued one
+ *
+ * @param result Result to store in the finished descriptor
+ */
+static void SPI_Finish(SPI_Result result)
+{
+    SPI_Xfer *x = _cur;
+
+    SPI->ICR &= (uint8_t)~(SPI_ICR_RXEI | SPI_ICR_TXEI);
+
+    if (x->cs != SPI_NO_CS)
+        IO_Write(x->cs, 1);
+
+    x->result = result;
+    x->busy = 0;
+
+    // Start the next transaction before the callback runs, so a transaction
+    // submitted from the callback is queued behind it rather than started
+    // alongside it
+    _qHead = (uint8_t)((_qHead + 1) & (SPI_QUEUE_SIZE - 1));
+    if (_qHead != _qTail)
+        SPI_Start(_queue[_qHead]);
+    else
+        _cur = NULL;
+
+    if (x->done)
+        x->done(x);
+}
+
+/**
+ * @brief Initialize the SPI peripheral as master
+ *
+ * @param clk SPI clock divider
+ * @param mode Clock polarity/phase mode
+ * @param priority Interrupt priority (0-3)
+ * @return SPI_Result Result of the operation
+ */
+SPI_Result SPI_MasterInit(SPI_CLK clk, SPI_MODE mode, uint8_t priority)
+{
+    if (mode > SPI_MODE3 || priority > 3) {
+        return SPI_RESULT_INVALID_PARAM;
+    }
+
+    // Enable SPI clock
+    CLK_PeripheralClockConfig(CLK_PERIPHERAL_SPI, ENABLE);
+
+    // Configure SPI
+    SPI_DeInit();
+    SPI_Init(SPI_FIRSTBIT_MSB, (SPI_BaudRatePrescaler_TypeDef)clk, SPI_MODE_MASTER,
+             (mode & 2) ? SPI_CLOCKPOLARITY_HIGH : SPI_CLOCKPOLARITY_LOW,
+             (mode & 1) ? SPI_CLOCKPHASE_2EDGE : SPI_CLOCKPHASE_1EDGE,
+             SPI_DATADIRECTION_2LINES_FULLDUPLEX, SPI_NSS_SOFT, 0x07);
+    SPI_NSSInternalSoftwareCmd(ENABLE);
+
+    IRQ_Register(IRQ_SPI, SPI_Isr);
+    ITC_SetSoftwarePriority(ITC_IRQ_SPI, (ITC_PriorityLevel_TypeDef)priority);
+
+    _qHead = _qTail = 0;
+    _cur = NULL;
+
+    // Start SPI Peripheral
+    SPI_Cmd(ENABLE);
+
+    return SPI_RESULT_OK;
+}
+
+/**
+ * @brief Initialize a chip-select pin (output, deasserted)
+ *
+ * @param cs IO index of the chip-select pin
+ * @return SPI_Result Result of the operation
+ */
+SPI_Result SPI_CSInit(IO_IDX cs)
+{
+    if (IO_Init(cs, IO_MODE_OUTPUT_PP_HIGH) != IO_RESULT_OK) {
+        return SPI_RESULT_INVALID_PARAM;
+    }
+
+    return SPI_RESULT_OK;
+}
+
+/**
+ * @brief Queue a transaction without waiting for it
+ *
+ * @param xfer Transaction descriptor
+ * @return SPI_Result SPI_RESULT_QUEUE_FULL if no slot is free
+ */
+SPI_Result SPI_Submit(SPI_Xfer *xfer)
+{
+    uint8_t icr, next;
+
+    if (xfer == NULL || xfer->len == 0) {
+        return SPI_RESULT_INVALID_PARAM;
+    }
+    if (xfer->busy) {
+        return SPI_RESULT_BUSY;
+    }
+
+    next = (uint8_t)((_qTail + 1) & (SPI_QUEUE_SIZE - 1));
+    if (next == _qHead) {
+        return SPI_RESULT_QUEUE_FULL;
+    }
+
+    xfer->busy = 1;
+    xfer->result = SPI_RESULT_BUSY;
+
+    // Mask SPI interrupts so the ISR cannot go idle between the queue
+    // update and the idle check below
+    icr = SPI->ICR;
+    SPI->ICR = (uint8_t)(icr & ~(SPI_ICR_RXEI | SPI_ICR_TXEI));
+
+    _queue[_qTail] = xfer;
+    _qTail = next;
+
+    if (_cur == NULL)
+        SPI_Start(xfer);
+    else
+        SPI->ICR = icr;
+
+    return SPI_RESULT_OK;
+}
+
+/**
+ * @brief Perform a transaction and wait for it to complete
+ *
+ * @param cs Chip-select pin or SPI_NO_CS
+ * @param tx Bytes to send, NULL to send SPI_DUMMY_BYTE
+ * @param rx Received bytes, NULL to discard
+ * @param len Number of bytes to exchange
+ * @return SPI_Result Result of the operation
+ */
+SPI_Result SPI_Transfer(IO_IDX cs, const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+    SPI_Xfer xfer;
+    SPI_Result result;
+
+    xfer.cs = cs;
+    xfer.tx = tx;
+    xfer.rx = rx;
+    xfer.len = len;
+    xfer.done = NULL;
+    xfer.busy = 0;
+
+    while ((result = SPI_Submit(&xfer)) == SPI_RESULT_QUEUE_FULL);
+    if (result != SPI_RESULT_OK) {
+        return result;
+    }
+
+    while (xfer.busy);
+
+    return xfer.result;
+}
+
+/**
+ * @brief Check if transactions are queued or in progress
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int SPI_Busy(void)
+{
+    return _cur != NULL || _qHead != _qTail;
+}
+
+/**
+ * @brief SPI interrupt service routine
+ *
+ * Registered with the interrupt module by SPI_MasterInit; applications with
+ * their own vector table call it from the SPI interrupt vector.
+ */
+void SPI_Isr(void)
+{
+    SPI_Xfer *x = _cur;
+    uint8_t sr = SPI->SR;
+
+    if (x == NULL) {
+        SPI->ICR &= (uint8_t)~(SPI_ICR_RXEI | SPI_ICR_TXEI);
+        return;
+    }
+
+    if (sr & SPI_SR_OVR) {
+        // Cleared by reading DR then SR
+        (void)SPI->DR;
+        (void)SPI->SR;
+        SPI_Finish(SPI_RESULT_ERROR);
+        return;
+    }
+
+    if (sr & SPI_SR_RXNE) {
+        uint8_t b = SPI->DR;
+        if (x->rx)
+            x->rx[_rxPos] = b;
+        if (++_rxPos == x->len) {
+            SPI_Finish(SPI_RESULT_OK);
+            return;
+        }
+        if (_txPos < x->len)
+            SPI->ICR |= SPI_ICR_TXEI;
+    }
+
+    if ((SPI->ICR & SPI_ICR_TXEI) && (sr & SPI_SR_TXE)) {
+        SPI->DR = x->tx ? x->tx[_txPos] : SPI_DUMMY_BYTE;
+        ++_txPos;
+        // Keep at most two bytes in flight so RXNE is always serviced in time
+        if (_txPos == x->len || (uint16_t)(_txPos - _rxPos) >= 2)
+            SPI->ICR &= (uint8_t)~SPI_ICR_TXEI;
+    }
+}
@@ -0,0 +1,149 @@
+/**
+ * @file spi.h
+ * @brief SPI master driver interface for STM8S003F3
+ *
+ * This file contains the declarations of SPI functions, types, and definitions
+ * for initializing the SPI peripheral as a master and performing interrupt-driven,
+ * full-duplex block transfers on the STM8S003F3 microcontroller.
+ */
+
+#ifndef __SPI_H
+#define __SPI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "io.h"  // For IO_IDX type
+
+/**
+ * @brief Number of transactions that can be queued at once
+ */
+#define SPI_QUEUE_SIZE  4
+
+/**
+ * @brief Use as chip-select for transfers that do not drive a CS pin
+ */
+#define SPI_NO_CS       IO_IDX_MAX
+
+/**
+ * @brief Byte clocked out when a transfer has no transmit buffer
+ */
+#define SPI_DUMMY_BYTE  0xFF
+
+/**
+ * @brief Enumeration of SPI clock dividers (f_MASTER / n)
+ */
+typedef enum {
+  SPI_CLK_DIV2 = SPI_BAUDRATEPRESCALER_2,
+  SPI_CLK_DIV4 = SPI_BAUDRATEPRESCALER_4,
+  SPI_CLK_DIV8 = SPI_BAUDRATEPRESCALER_8,
+  SPI_CLK_DIV16 = SPI_BAUDRATEPRESCALER_16,
+  SPI_CLK_DIV32 = SPI_BAUDRATEPRESCALER_32,
+  SPI_CLK_DIV64 = SPI_BAUDRATEPRESCALER_64,
+  SPI_CLK_DIV128 = SPI_BAUDRATEPRESCALER_128,
+  SPI_CLK_DIV256 = SPI_BAUDRATEPRESCALER_256,
+} SPI_CLK;
+
+/**
+ * @brief Enumeration of SPI clock polarity/phase modes
+ */
+typedef enum {
+  SPI_MODE0,  // CPOL=0, CPHA=0
+  SPI_MODE1,  // CPOL=0, CPHA=1
+  SPI_MODE2,  // CPOL=1, CPHA=0
+  SPI_MODE3,  // CPOL=1, CPHA=1
+} SPI_MODE;
+
+/**
+ * @brief Enumeration of SPI operation results
+ */
+typedef enum {
+  SPI_RESULT_OK,
+  SPI_RESULT_INVALID_PARAM,
+  SPI_RESULT_BUSY,
+  SPI_RESULT_QUEUE_FULL,
+  SPI_RESULT_ERROR
+} SPI_Result;
+
+struct SPI_Xfer;
+
+/**
+ * @brief Transfer completion callback, called from interrupt context
+ */
+typedef void (*SPI_Callback)(struct SPI_Xfer *xfer);
+
+/**
+ * @brief SPI transaction descriptor
+ *
+ * The descriptor and its buffers are owned by the caller and must stay valid
+ * until the transaction completes.
+ */
+typedef struct SPI_Xfer {
+  IO_IDX cs;              // Chip-select pin (active low) or SPI_NO_CS
+  const uint8_t *tx;      // Bytes to send, NULL to send SPI_DUMMY_BYTE
+  uint8_t *rx;            // Received bytes, NULL to discard
+  uint16_t len;           // Number of bytes to exchange
+  SPI_Callback done;      // Completion callback, may be NULL
+  volatile SPI_Result result;
+  volatile uint8_t busy;  // Non-zero while queued or in progress
+} SPI_Xfer;
+
+/**
+ * @brief Initialize the SPI peripheral as master
+ *
+ * @param clk SPI clock divider
+ * @param mode Clock polarity/phase mode
+ * @param priority Interrupt priority (0-3)
+ * @return SPI_Result Result of the operation
+ */
+SPI_Result SPI_MasterInit(SPI_CLK clk, SPI_MODE mode, uint8_t priority);
+
+/**
+ * @brief Initialize a chip-select pin (output, deasserted)
+ *
+ * @param cs IO index of the chip-select pin
+ * @return SPI_Result Result of the operation
+ */
+SPI_Result SPI_CSInit(IO_IDX cs);
+
+/**
+ * @brief Queue a transaction without waiting for it
+ *
+ * @param xfer Transaction descriptor
+ * @return SPI_Result SPI_RESULT_QUEUE_FULL if no slot is free
+ */
+SPI_Result SPI_Submit(SPI_Xfer *xfer);
+
+/**
+ * @brief Perform a transaction and wait for it to complete
+ *
+ * @param cs Chip-select pin or SPI_NO_CS
+ * @param tx Bytes to send, NULL to send SPI_DUMMY_BYTE
+ * @param rx Received bytes, NULL to discard
+ * @param len Number of bytes to exchange
+ * @return SPI_Result Result of the operation
+ */
+SPI_Result SPI_Transfer(IO_IDX cs, const uint8_t *tx, uint8_t *rx, uint16_t len);
+
+/**
+ * @brief Check if transactions are queued or in progress
+ *
+ * @return int 1 if busy, 0 otherwise
+ */
+int SPI_Busy(void);
+
+/**
+ * @brief SPI interrupt service routine
+ *
+ * Registered with the interrupt module by SPI_MasterInit; applications with
+ * their own vector table call it from the SPI interrupt vector.
+ */
+void SPI_Isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SPI_H
@@ -1,8 +1,14 @@
 #include "stm8s.h"
 #include "system.h"
+#include "interrupt.h"
 
 static volatile clock_t _TmTick = 0;
 
+static uint32_t _fMaster = HSI_FREQUENCY;
+static uint8_t _cpuShift = 0;
+static Sys_ClockHook _clkHooks[SYS_CLOCK_HOOKS];
+static uint8_t _nClkHooks = 0;
+
 void Sys_IoInit()
 {
 
@@ -13,22 +19,93 @@ void Sys_ClockInit(void)
 //  CLK_DeInit();
   
   CLK_HSIPrescalerConfig(CLK_PRESCALER_HSIDIV1);
+  _fMaster = HSI_FREQUENCY;
   
 //  CLK_SYSCLKConfig(CLK_PRESCALER_CPUDIV1);
 }
 
+// TIM4 reload for a 1 kHz tick at the current master clock
+static void Sys_TickConfig(void)
+{
+  uint8_t psc = 0;
+  
+  // Smallest prescaler that fits one tick into the 8-bit counter
+  while (psc < 7 && (_fMaster >> psc) / CLOCKS_PER_SEC > 256)
+    ++psc;
+  
+  // 16 MHz / 64 / 250 = 1kHz, 2 MHz / 8 / 250 = 1kHz, ...
+  // A new prescaler takes effect at the next update event
+  TIM4_TimeBaseInit((TIM4_Prescaler_TypeDef)psc,
+                    (uint8_t)((_fMaster >> psc) / CLOCKS_PER_SEC - 1));
+}
+
 void Sys_TickInit(void)
 {
   CLK_PeripheralClockConfig(CLK_PERIPHERAL_TIMER4, ENABLE);
   
-  TIM4_TimeBaseInit(TIM4_PRESCALER_128, 124); // 16 MHz / 128 / 125 = 1kHz
+  Sys_TickConfig();
+  IRQ_Register(IRQ_TIM4_UPD, Sys_ClockTick);
   TIM4_ClearFlag(TIM4_FLAG_UPDATE);
   TIM4_ITConfig(TIM4_IT_UPDATE, ENABLE);
   TIM4_Cmd(ENABLE);  
 }
 
+// Switch master (HSIDIVx) and CPU (CPUDIVx) dividers at runtime. The tick
+// is reprogrammed here; UART, timers etc. follow through their clock hooks.
+// Returns 0 on success, -1 if a divider is out of range
+int Sys_ClockSet(CLK_Prescaler_TypeDef hsiDiv, CLK_Prescaler_TypeDef cpuDiv)
+{
+  uint8_t i;
+  
+  if (((uint8_t)hsiDiv & ~0x18) != 0x00 || ((uint8_t)cpuDiv & ~0x07) != 0x80)
+    return -1;
+  
+  CLK_HSIPrescalerConfig(hsiDiv);
+  CLK_SYSCLKConfig(cpuDiv);
+  
+  _fMaster = HSI_FREQUENCY >> (((uint8_t)hsiDiv >> 3) & 0x03);
+  _cpuShift = (uint8_t)cpuDiv & 0x07;
+  
+  if (TIM4->CR1 & TIM4_CR1_CEN)
+    Sys_TickConfig();
+  
+  for (i = 0; i < _nClkHooks; ++i)
+    _clkHooks[i](_fMaster);
+  
+  return 0;
+}
+
+uint32_t Sys_MasterClock(void)
+{
+  return _fMaster;
+}
+
+uint32_t Sys_CpuClock(void)
+{
+  return _fMaster >> _cpuShift;
+}
+
+// Returns 0 on success, -1 if the registry is full (raise SYS_CLOCK_HOOKS)
+int Sys_ClockRegister(Sys_ClockHook hook)
+{
+  uint8_t i;
+  
+  for (i = 0; i < _nClkHooks; ++i) {
+    if (_clkHooks[i] == hook)
+      return 0;
+  }
+  
+  if (_nClkHooks >= SYS_CLOCK_HOOKS)
+    return -1;
+  
+  _clkHooks[_nClkHooks++] = hook;
+  return 0;
+}
+
+// TIM4 update interrupt
 void Sys_ClockTick(void)
 {
+  TIM4->SR1 = (uint8_t)~TIM4_SR1_UIF;
   ++_TmTick;
 }
 
@@ -41,4 +118,15 @@ void DelayMs(uint16_t ms)
 {
   clock_t start = clock();
   while (clock() - start < ms);
+}
+
+// CRC-16/CCITT (poly 0x1021), start with crc = 0xFFFF
+uint16_t Sys_Crc16(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+  while (len--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; ++i)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
 }
\ No newline at end of file
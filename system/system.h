@@ -5,20 +5,36 @@
 extern "C" {
 #endif
 
+#include "stm8s.h"
+
 #define HSI_FREQUENCY   16000000 // 16 MHz
 #define CLOCKS_PER_SEC  1000 // 1 kHz tick
   
 #define CON_UART        UART_1
 
+#define SYS_CLOCK_HOOKS 4 // Max. peripherals notified on clock change
+                          // (timer, UART, I2C, control)
+
 typedef uint32_t clock_t;
 
+// Called with the new master clock (Hz) after Sys_ClockSet
+typedef void (*Sys_ClockHook)(uint32_t fMaster);
+
 void Sys_ClockInit();
 void Sys_IoInit();
 void Sys_TickInit();
+void Sys_ClockTick(void);
+
+int Sys_ClockSet(CLK_Prescaler_TypeDef hsiDiv, CLK_Prescaler_TypeDef cpuDiv);
+uint32_t Sys_MasterClock(void);
+uint32_t Sys_CpuClock(void);
+int Sys_ClockRegister(Sys_ClockHook hook);
 
 clock_t clock(void);
 void DelayMs(uint16_t ms);
 
+uint16_t Sys_Crc16(uint16_t crc, const uint8_t *data, uint16_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,210 @@
+/**
+ * @file adc_cal_test.c
+ * @brief Host test of the two-point ADC calibration and integer correction
+ *
+ * The mock converts at once from a model input: an ADC with a gain and
+ * offset error per channel, clamped to 0-1023. After capturing two points
+ * and calibrating, the corrected reading must match the ideal code over the
+ * full 0-1023 range. The fixed-point correction is also compared against
+ * the exact (floating point) result for every raw code.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Iadc -Igpio -Iinterrupt tests/adc_cal_test.c adc/adc.c gpio/io.c \
+ *      tests/mock/mock.c -lm -o adc_cal_test && ./adc_cal_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "adc.h"
+
+IO_PIN _ios[IO_IDX_MAX];
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+static uint16_t _input;                         // Ideal code of the applied input
+static double _gainErr[8], _offsetErr[8];       // Model error per channel
+
+/**
+ * @brief Raw code of a channel for an ideal code
+ */
+static uint16_t Raw(uint8_t ch, uint16_t ideal)
+{
+    double v = floor(ideal * _gainErr[ch] + _offsetErr[ch] + 0.5);
+
+    return (uint16_t)(v < 0 ? 0 : v > 1023 ? 1023 : v);
+}
+
+/**
+ * @brief Conversion result of the model ADC
+ */
+static uint16_t AdcInput(uint8_t ch)
+{
+    return Raw(ch, _input);
+}
+
+/**
+ * @brief Worst difference between AY_ADC_Correct and the exact correction
+ *
+ * @param ch Calibrated channel
+ * @return Largest error over raw codes 0-1023, in codes
+ */
+static double CorrectError(uint8_t ch)
+{
+    ADC_Cal c;
+    double worst = 0;
+    unsigned raw;
+
+    AY_ADC_CalGet(ch, &c);
+    for (raw = 0; raw <= 1023; ++raw) {
+        double e = raw * (double)c.gain / (1 << ADC_CAL_SHIFT) + c.offset;
+
+        e = e < 0 ? 0 : e > 1023 ? 1023 : e;
+        if (fabs(AY_ADC_Correct(ch, (uint16_t)raw) - e) > worst)
+            worst = fabs(AY_ADC_Correct(ch, (uint16_t)raw) - e);
+    }
+    return worst;
+}
+
+/**
+ * @brief Calibrate a channel at two points and check the whole range
+ *
+ * @param ch Channel
+ * @param gain Gain error of the model
+ * @param offset Offset error of the model, in codes
+ * @return int Largest corrected error, in codes, over ideal codes whose raw
+ *         reading is not clamped
+ */
+static int CalibrateAndCheck(uint8_t ch, double gain, double offset)
+{
+    int worst = 0;
+    unsigned ideal;
+
+    _gainErr[ch] = gain;
+    _offsetErr[ch] = offset;
+
+    CHECK(AY_ADC_SelectChannel(ch) == ADC_RESULT_OK);
+    _input = 50;
+    CHECK(AY_ADC_CalCapture(0, 50) == ADC_RESULT_OK);
+    _input = 900;
+    CHECK(AY_ADC_CalCapture(1, 900) == ADC_RESULT_OK);
+    CHECK(AY_ADC_Calibrate() == ADC_RESULT_OK);
+    CHECK(CorrectError(ch) <= 0.5);
+
+    for (ideal = 0; ideal <= 1023; ++ideal) {
+        uint16_t raw = Raw(ch, (uint16_t)ideal);
+        int e;
+
+        if (raw == 0 || raw == 1023)
+            continue;
+        _input = (uint16_t)ideal;
+        CHECK(AY_ADC_ConvertS() == AY_ADC_Correct(ch, raw));
+        e = abs((int)AY_ADC_Correct(ch, raw) - (int)ideal);
+        if (e > worst)
+            worst = e;
+    }
+    return worst;
+}
+
+int main(void)
+{
+    static const struct { double gain, offset; } errs[] = {
+        { 1.000,  0.0 }, { 1.020,  3.0 }, { 0.970, -5.0 },
+        { 1.080, 12.0 }, { 0.900, 20.0 }, { 1.003, -1.4 },
+    };
+    ADC_Cal c, saved[ADC_CAL_CHANNELS];
+    unsigned raw, i;
+    uint8_t ch;
+
+    Mock_Reset();
+    Mock_AdcInput = AdcInput;
+    for (ch = 0; ch < 8; ++ch)
+        _gainErr[ch] = 1.0;
+    AY_ADC_Init_Single();
+
+    // Identity until calibrated, also outside the calibrated channels
+    for (raw = 0; raw <= 1023; ++raw) {
+        CHECK(AY_ADC_Correct(ADC_CAL_FIRST_CH, (uint16_t)raw) == raw);
+        CHECK(AY_ADC_Correct(0, (uint16_t)raw) == raw);
+    }
+
+    // Within one code of the ideal over the full range
+    for (i = 0; i < sizeof(errs) / sizeof(errs[0]); ++i) {
+        for (ch = ADC_CAL_FIRST_CH; ch < ADC_CAL_FIRST_CH + ADC_CAL_CHANNELS; ++ch) {
+            int worst = CalibrateAndCheck(ch, errs[i].gain, errs[i].offset);
+
+            if (worst > 1) {
+                printf("FAIL: gain %.3f offset %.1f ch %u: %d codes off\n",
+                       errs[i].gain, errs[i].offset, ch, worst);
+                ++_failed;
+            }
+        }
+    }
+
+    // Extreme settings clamp instead of wrapping
+    c.gain = 0xFFFF;
+    c.offset = 1023;
+    CHECK(AY_ADC_CalSet(ADC_CAL_FIRST_CH, &c) == ADC_RESULT_OK);
+    CHECK(AY_ADC_Correct(ADC_CAL_FIRST_CH, 1023) == 1023 && CorrectError(ADC_CAL_FIRST_CH) <= 0.5);
+    c.gain = 1;
+    c.offset = -1023;
+    CHECK(AY_ADC_CalSet(ADC_CAL_FIRST_CH, &c) == ADC_RESULT_OK);
+    CHECK(AY_ADC_Correct(ADC_CAL_FIRST_CH, 1023) == 0 && CorrectError(ADC_CAL_FIRST_CH) <= 0.5);
+
+    // Storage is up to the caller: get, reset, set restores the correction
+    CHECK(CalibrateAndCheck(3, 1.05, 7.0) <= 1);
+    for (i = 0; i < ADC_CAL_CHANNELS; ++i)
+        CHECK(AY_ADC_CalGet((uint8_t)(ADC_CAL_FIRST_CH + i), &saved[i]) == ADC_RESULT_OK);
+    AY_ADC_CalReset();
+    CHECK(AY_ADC_Correct(3, 500) == 500);
+    for (i = 0; i < ADC_CAL_CHANNELS; ++i)
+        CHECK(AY_ADC_CalSet((uint8_t)(ADC_CAL_FIRST_CH + i), &saved[i]) == ADC_RESULT_OK);
+    CHECK(abs((int)AY_ADC_Correct(3, Raw(3, 500)) - 500) <= 1);
+
+    // Invalid channels and settings
+    CHECK(AY_ADC_CalGet(ADC_CAL_FIRST_CH - 1, &c) == ADC_RESULT_INVALID_CHANNEL);
+    CHECK(AY_ADC_CalSet(ADC_CAL_FIRST_CH + ADC_CAL_CHANNELS, &c) == ADC_RESULT_INVALID_CHANNEL);
+    CHECK(AY_ADC_CalGet(ADC_CAL_FIRST_CH, NULL) == ADC_RESULT_INVALID_PARAM);
+    c.gain = 0;
+    c.offset = 0;
+    CHECK(AY_ADC_CalSet(ADC_CAL_FIRST_CH, &c) == ADC_RESULT_INVALID_PARAM);
+    c.gain = 1 << ADC_CAL_SHIFT;
+    c.offset = 1024;
+    CHECK(AY_ADC_CalSet(ADC_CAL_FIRST_CH, &c) == ADC_RESULT_INVALID_PARAM);
+
+    // Calibration needs two distinct points on the same channel
+    CHECK(AY_ADC_SelectChannel(4) == ADC_RESULT_OK);
+    CHECK(AY_ADC_Calibrate() == ADC_RESULT_NO_DATA);
+    _input = 100;
+    CHECK(AY_ADC_CalCapture(0, 100) == ADC_RESULT_OK);
+    CHECK(AY_ADC_SelectChannel(5) == ADC_RESULT_OK);
+    CHECK(AY_ADC_CalCapture(1, 900) == ADC_RESULT_OK);
+    CHECK(AY_ADC_Calibrate() == ADC_RESULT_NO_DATA);
+    CHECK(AY_ADC_CalCapture(0, 900) == ADC_RESULT_OK);
+    CHECK(AY_ADC_Calibrate() == ADC_RESULT_INVALID_PARAM);
+    CHECK(AY_ADC_CalCapture(2, 900) == ADC_RESULT_INVALID_PARAM);
+    CHECK(AY_ADC_CalCapture(0, 1024) == ADC_RESULT_INVALID_PARAM);
+    CHECK(AY_ADC_SelectChannel(0) == ADC_RESULT_OK);
+    CHECK(AY_ADC_CalCapture(0, 100) == ADC_RESULT_OK);
+    CHECK(AY_ADC_CalCapture(1, 900) == ADC_RESULT_OK);
+    CHECK(AY_ADC_Calibrate() == ADC_RESULT_INVALID_CHANNEL);
+    CHECK(AY_ADC_SelectChannel(7) == ADC_RESULT_INVALID_CHANNEL);
+
+    // Fixed scale voltage conversion
+    CHECK(fabs(AY_ADC_ToVoltage(ADC_MAX) - ADC_VREF) < 1e-4);
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file control_test.c
+ * @brief Host simulation of the PID loop against a first-order plant
+ *
+ * TIM2 is modelled period by period: the plant is integrated over one PWM
+ * period with the duty of the active compare register, then the update
+ * event loads the compare preload value and calls CTL_Isr. The mock ADC
+ * converts the plant output at the time the ISR starts a conversion, so the
+ * loop sees the measurement one iteration late, as on the target.
+ *
+ * The plant is y' = (gain * duty + load - y) / tau with the output in
+ * fractions of the ADC full scale. Step responses must settle without
+ * sustained oscillation for a range of gains, and the output must recover
+ * quickly from saturation.
+ *
+ * The cycle cost is checked through the loop's own statistics: every TIM2
+ * access moves the simulated counter on (Mock_Tim2Hook), after an injected
+ * interrupt latency, and the latency, execution time and overruns reported
+ * must match. The register accesses per interrupt are counted as well.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Icontrol -Iadc -Itimer -Igpio -Isystem -Iinterrupt tests/control_test.c \
+ *      control/control.c adc/adc.c timer/timer.c gpio/io.c system/system.c tests/mock/mock.c \
+ *      -lm -o control_test && ./control_test
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "system.h"
+#include "control.h"
+
+#define RATE        1000            // Loop rate, Hz
+#define Q15(x)      ((int16_t)((x) * 32768.0 + 0.5))
+#define MS(t)       ((unsigned long)(t) * (CTL_PWM_HZ / 1000))     // PWM periods
+
+IO_PIN _ios[IO_IDX_MAX];
+
+static double _y;                   // Plant output, fraction of full scale
+static double _gain = 1.0, _tau = 0.01, _load;
+static unsigned _noise;             // ADC noise amplitude, codes
+static uint32_t _rand = 1;
+static uint16_t _active;            // Active compare value
+static uint16_t _cnt;               // TIM2 counter
+static unsigned _latency, _cost;    // Update to ISR, counts per TIM2 access
+static unsigned long _accesses;     // TIM2 accesses so far
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/**
+ * @brief Absolute value (stdlib.h clashes with system.h)
+ */
+static int Abs(int v)
+{
+    return v < 0 ? -v : v;
+}
+
+/**
+ * @brief Conversion result of the ADC: the plant output plus noise
+ */
+static uint16_t AdcInput(uint8_t ch)
+{
+    double v = _y * 1023.0 + 0.5;
+
+    (void)ch;
+    if (_noise) {
+        _rand = _rand * 1103515245UL + 12345;
+        v += (double)((_rand >> 16) % (2 * _noise + 1)) - _noise;
+    }
+    return (uint16_t)(v < 0 ? 0 : v > 1023 ? 1023 : v);
+}
+
+/**
+ * @brief PWM period in counts, from the auto-reload register
+ */
+static uint16_t Period(void)
+{
+    return (uint16_t)(((Mock_TIM2.ARRH << 8) | Mock_TIM2.ARRL) + 1);
+}
+
+/**
+ * @brief Load the counter registers
+ *
+ * CNTRH shows the counter one access ahead, so the CNTRH, CNTRL read pair
+ * of the driver sees one consistent value, as with the latch of the timer.
+ */
+static void SetCounter(void)
+{
+    uint16_t next = (uint16_t)(_cnt + _cost);
+
+    if (next >= Period())
+        next = (uint16_t)(next - Period());
+    Mock_TIM2.CNTRH = (uint8_t)(next >> 8);
+    Mock_TIM2.CNTRL = (uint8_t)_cnt;
+}
+
+/**
+ * @brief TIM2 access: the counter moves on, an update sets UIF
+ */
+static void Tim2Access(void)
+{
+    ++_accesses;
+    _cnt = (uint16_t)(_cnt + _cost);
+    if (_cnt >= Period()) {
+        _cnt = (uint16_t)(_cnt - Period());
+        Mock_TIM2.SR1 |= TIM2_SR1_UIF;
+    }
+    SetCounter();
+}
+
+/**
+ * @brief Run a number of PWM periods
+ *
+ * @param periods PWM periods
+ * @param pMax Receives the highest plant output, may be NULL
+ * @param pMin Receives the lowest plant output, may be NULL
+ */
+static void Run(unsigned long periods, double *pMax, double *pMin)
+{
+    double a = 1.0 - exp(-1.0 / (CTL_PWM_HZ * _tau));
+    double duty;
+
+    while (periods--) {
+        duty = (double)_active / Period();
+        _y += (_gain * duty + _load - _y) * a;
+        if (pMax && _y > *pMax)
+            *pMax = _y;
+        if (pMin && _y < *pMin)
+            *pMin = _y;
+
+        // Update event: compare preload to the active register
+        _active = (uint16_t)((Mock_TIM2.CCR1H << 8) | Mock_TIM2.CCR1L);
+        _cnt = (uint16_t)_latency;
+        SetCounter();
+        Mock_TIM2.SR1 |= TIM2_SR1_UIF;
+        Mock_Irq(IRQ_TIM2_UPD);
+    }
+}
+
+/**
+ * @brief Step the setpoint and measure the response
+ *
+ * @param sp New setpoint, fraction of full scale
+ * @param ms Time to run
+ * @param pOvershoot Receives the overshoot, fraction of the step
+ * @return double Settling time to within 2 % of the step in ms, -1 if the
+ *         plant is still outside the band at the end
+ */
+static double Step(double sp, unsigned ms, double *pOvershoot)
+{
+    double y0 = _y, band = fabs(sp - y0) * 0.02, peak = y0, settled = -1;
+    unsigned t;
+
+    if (band < 3.0 / 1023)
+        band = 3.0 / 1023;
+    CTL_SetSetpoint(Q15(sp));
+    for (t = 0; t < ms; ++t) {
+        if (sp > y0)
+            Run(MS(1), &peak, NULL);
+        else
+            Run(MS(1), NULL, &peak);
+        if (fabs(_y - sp) > band)
+            settled = -1;
+        else if (settled < 0)
+            settled = t + 1;
+    }
+    if (pOvershoot)
+        *pOvershoot = fabs(peak - y0) > fabs(sp - y0) ? fabs(peak - sp) / fabs(sp - y0) : 0;
+    return settled;
+}
+
+/**
+ * @brief Start a step response from a settled plant at zero output
+ */
+static void Restart(int16_t kp, int16_t ki, int16_t kd)
+{
+    CTL_Enable(false);
+    CTL_SetSetpoint(0);
+    _y = 0;
+    Run(MS(5), NULL, NULL);
+    CTL_SetGains(kp, ki, kd);
+    CTL_Enable(true);
+}
+
+int main(void)
+{
+    static const struct { int16_t kp, ki; double settle; } tunings[] = {
+        { CTL_GAIN_ONE / 2, 102, 150 }, { CTL_GAIN_ONE, 205, 80 },
+        { 2 * CTL_GAIN_ONE, 410, 40 }, { 4 * CTL_GAIN_ONE, 820, 40 },
+    };
+    CTL_Stats st;
+    double settle, over, y, lo, hi, swing[2];
+    uint16_t period;
+    unsigned long acc;
+    unsigned i, n;
+
+    Mock_Reset();
+    Sys_ClockInit();
+    Sys_TickInit();
+    Mock_AdcInput = AdcInput;
+
+    // Invalid configurations
+    CHECK(CTL_Init(7, 1, RATE, 1, NULL) == CTL_RESULT_INVALID_PARAM);
+    CHECK(CTL_Init(3, 0, RATE, 1, NULL) == CTL_RESULT_INVALID_PARAM);
+    CHECK(CTL_Init(3, 1, 0, 1, NULL) == CTL_RESULT_INVALID_PARAM);
+    CHECK(CTL_Init(3, 1, CTL_PWM_HZ / 300, 1, NULL) == CTL_RESULT_INVALID_PARAM);
+    CHECK(CTL_Init(3, 1, RATE, 4, NULL) == CTL_RESULT_INVALID_PARAM);
+
+    CHECK(CTL_Init(3, 1, RATE, 2, &period) == CTL_RESULT_OK);
+    CHECK(period == 16000000UL / CTL_PWM_HZ && Period() == period);
+    CHECK((Mock_TIM2.CR1 & TIM2_CR1_ARPE) && (Mock_TIM2.CCMR1 & 0x08));
+    CHECK(Mock_Priority[ITC_IRQ_TIM2_OVF] == 2);
+    Mock_Tim2Hook = Tim2Access;
+
+    // Disabled: output held at the lower limit
+    Run(MS(20), NULL, NULL);
+    CHECK(CTL_Output() == 0 && _active == 0 && _y == 0);
+
+    // Step responses settle without sustained oscillation, faster with
+    // higher gains; the integrator removes the steady-state error
+    for (i = 0; i < sizeof(tunings) / sizeof(tunings[0]); ++i) {
+        Restart(tunings[i].kp, tunings[i].ki, 0);
+        settle = Step(0.5, 300, &over);
+        if (settle < 0 || settle > tunings[i].settle || over > 0.1) {
+            printf("FAIL: kp %d ki %d: settled in %.0f ms (%.0f max), overshoot %.1f %%\n",
+                   tunings[i].kp, tunings[i].ki, settle, tunings[i].settle, over * 100);
+            ++_failed;
+        }
+        CHECK(Abs(CTL_Measurement() - Q15(0.5)) <= 64);
+        settle = Step(0.2, 300, &over);
+        CHECK(settle >= 0 && settle <= tunings[i].settle && over <= 0.1);
+    }
+
+    // Load disturbance is rejected
+    Restart(CTL_GAIN_ONE, 205, 0);
+    CHECK(Step(0.4, 200, NULL) >= 0);
+    _load = 0.1;
+    Run(MS(150), NULL, NULL);
+    CHECK(fabs(_y - 0.4) < 0.01);
+    _load = 0;
+
+    // Saturation: the setpoint cannot be reached with the output at its
+    // upper limit, and the output comes back as soon as it is lowered
+    _gain = 0.5;
+    Restart(CTL_GAIN_ONE, 205, 0);
+    CHECK(CTL_SetLimits(Q15(0.1), Q15(0.9)) == CTL_RESULT_OK);
+    Step(0.8, 1000, NULL);
+    CHECK(CTL_Output() == Q15(0.9));
+    CHECK(_active == (uint16_t)(((uint32_t)Q15(0.9) * period) >> 15));
+    settle = Step(0.25, 300, &over);
+    CHECK(settle >= 0 && settle <= 80 && over <= 0.15);
+
+    // Limits hold on the way down too
+    lo = 1, hi = 0;
+    CTL_SetSetpoint(0);
+    for (n = 0; n < 200; ++n) {
+        Run(MS(1), NULL, NULL);
+        y = (double)CTL_Output() / 32768;
+        lo = y < lo ? y : lo;
+        hi = y > hi ? y : hi;
+    }
+    CHECK(lo >= 0.1 - 1e-4 && hi <= 0.9 + 1e-4 && CTL_Output() == Q15(0.1));
+    CHECK(CTL_SetLimits(Q15(0.5), Q15(0.5)) == CTL_RESULT_INVALID_PARAM);
+    CHECK(CTL_SetLimits(-1, Q15(0.5)) == CTL_RESULT_INVALID_PARAM);
+    CHECK(CTL_SetLimits(0, CTL_FULL_SCALE) == CTL_RESULT_OK);
+    _gain = 1.0;
+
+    // No derivative kick on a setpoint step, and the derivative filter
+    // smooths the output under ADC noise
+    Restart(CTL_GAIN_ONE, 205, 8 * CTL_GAIN_ONE);
+    CHECK(Step(0.3, 300, NULL) >= 0);
+    i = (unsigned)CTL_Output();
+    CTL_SetSetpoint(Q15(0.6));
+    Run(MS(1), NULL, NULL);
+    CHECK(CTL_Output() <= (int)i + Q15(0.3) + Q15(0.05));
+    CHECK(CTL_SetDFilter(8) == CTL_RESULT_INVALID_PARAM);
+    for (i = 0; i < 2; ++i) {
+        CHECK(CTL_SetDFilter(i ? 5 : 0) == CTL_RESULT_OK);
+        Restart(CTL_GAIN_ONE, 205, 8 * CTL_GAIN_ONE);
+        CHECK(Step(0.5, 300, NULL) >= 0);
+        _noise = 2;
+        lo = 1, hi = 0;
+        for (n = 0; n < 200; ++n) {
+            Run(MS(1), NULL, NULL);
+            y = (double)CTL_Output() / 32768;
+            lo = y < lo ? y : lo;
+            hi = y > hi ? y : hi;
+        }
+        swing[i] = hi - lo;
+        _noise = 0;
+    }
+    CHECK(swing[1] * 2 < swing[0]);
+    CHECK(CTL_SetDFilter(0) == CTL_RESULT_OK);
+
+    // Statistics: one iteration every CTL_PWM_HZ / RATE updates, the
+    // injected latency and the execution time in counts. The counter is
+    // read as the first two accesses and just before the last one; the
+    // other updates only read it and clear the flag.
+    Restart(CTL_GAIN_ONE, 205, 0);
+    _latency = 100;
+    _cost = 10;
+    CTL_ResetStats();
+    acc = _accesses;
+    Run(MS(100), NULL, NULL);
+    acc = _accesses - acc;
+    CTL_GetStats(&st);
+    CHECK(st.count == 100 && st.overruns == 0);
+    CHECK((acc - 3 * (MS(100) - st.count)) % st.count == 0);
+    n = (unsigned)((acc - 3 * (MS(100) - st.count)) / st.count);
+    CHECK(n <= 8);
+    CHECK(st.maxLatency == _latency + 2 * _cost);
+    CHECK(st.lastExec == _latency + (n - 1) * _cost && st.maxExec == st.lastExec);
+    printf("load: %u loop iterations/s, %u TIM2 accesses per iteration, 3 per other update\n",
+           RATE, n);
+
+    // An ISR longer than the PWM period is counted as an overrun
+    _cost = period / 4;
+    CTL_ResetStats();
+    Run(MS(10), NULL, NULL);
+    CTL_GetStats(&st);
+    CHECK(st.count == 10 && st.overruns == 10);
+    _cost = 0;
+    _latency = 0;
+
+    // Clock change: the period in counts follows, the duty keeps its scale
+    // and the loop keeps regulating
+    Restart(CTL_GAIN_ONE, 205, 0);
+    CHECK(Step(0.5, 200, NULL) >= 0);
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV2, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(CTL_Period() == period / 2 && Period() == period / 2);
+    CHECK(Abs((int)(((uint32_t)CTL_Output() * (period / 2)) >> 15) -
+              ((Mock_TIM2.CCR1H << 8) | Mock_TIM2.CCR1L)) <= 1);
+    settle = Step(0.3, 300, &over);
+    CHECK(settle >= 0 && settle <= 80 && over <= 0.1);
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV1, CLK_PRESCALER_CPUDIV1) == 0);
+
+    Mock_Tim2Hook = NULL;
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
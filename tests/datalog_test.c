@@ -0,0 +1,179 @@
+/**
+ * @file datalog_test.c
+ * @brief Host test of the data log with power loss during block writes
+ *
+ * The data EEPROM is the mock's Mock_Eeprom, programmed by the mock
+ * FLASH_ProgramBlock. A power loss is injected by cutting the next block
+ * program after n bytes (the rest of the block stays erased); a reset is a
+ * new DLog_Init. After every cut the newest record with a valid sequence
+ * number and CRC must be recovered, i.e. the last completed write.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Idatalog -Isystem -Iinterrupt tests/datalog_test.c \
+ *      datalog/datalog.c system/system.c tests/mock/mock.c -o datalog_test && ./datalog_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "system.h"
+#include "datalog.h"
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/**
+ * @brief Check that no block outside the log was written
+ *
+ * @return int 1 if the rest of the EEPROM is still blank
+ */
+static int OutsideBlank(void)
+{
+    unsigned i;
+
+    for (i = (DLOG_FIRST_BLOCK + DLOG_NUM_BLOCKS) * FLASH_BLOCK_SIZE; i < sizeof(Mock_Eeprom); ++i) {
+        if (Mock_Eeprom[i])
+            return 0;
+    }
+    for (i = 0; i < DLOG_FIRST_BLOCK * FLASH_BLOCK_SIZE; ++i) {
+        if (Mock_Eeprom[i])
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Write a record with a valid CRC straight into a block
+ *
+ * @param block Block within the log
+ * @param seq Sequence number
+ * @param count Sample count, to tell records apart
+ */
+static void Plant(uint8_t block, uint16_t seq, uint32_t count)
+{
+    DLOG_Record r;
+
+    memset(&r, 0, sizeof(r));
+    r.seq = seq;
+    r.count = count;
+    r.crc = Sys_Crc16(0xFFFF, (const uint8_t *)&r, sizeof(r) - sizeof(r.crc));
+    memcpy(&Mock_Eeprom[(DLOG_FIRST_BLOCK + block) * FLASH_BLOCK_SIZE], &r, sizeof(r));
+}
+
+int main(void)
+{
+    DLOG_Record last;
+    uint8_t user[4] = { 1, 2, 3, 4 }, got[4];
+    unsigned writes, i;
+    int cut, round;
+
+    Mock_Reset();
+    CHECK(DLOG_NUM_BLOCKS == 2);
+
+    // Blank EEPROM
+    CHECK(DLog_Init() == DLOG_RESULT_EMPTY);
+    CHECK(DLog_Get()->count == 0 && DLog_Average() == 0);
+
+    // Many updates coalesce into one block program
+    writes = Mock_FlashWrites;
+    for (i = 0; i < 1000; ++i)
+        DLog_AddSample((uint16_t)(100 + i % 21));
+    CHECK(DLog_CountEvent(2) == DLOG_RESULT_OK);
+    CHECK(DLog_CountEvent(DLOG_NUM_EVENTS) == DLOG_RESULT_INVALID_PARAM);
+    CHECK(DLog_SetUser(0, user, sizeof(user)) == DLOG_RESULT_OK);
+    CHECK(DLog_SetUser(DLOG_USER_SIZE - 3, user, sizeof(user)) == DLOG_RESULT_INVALID_PARAM);
+    CHECK(DLog_Flush() == DLOG_RESULT_OK);
+    CHECK(DLog_Flush() == DLOG_RESULT_OK);
+    CHECK(Mock_FlashWrites == writes + 1);
+
+    // Recovered after a reset
+    memcpy(&last, DLog_Get(), sizeof(last));
+    memset(got, 0, sizeof(got));
+    CHECK(DLog_Init() == DLOG_RESULT_OK);
+    CHECK(memcmp(DLog_Get(), &last, sizeof(last)) == 0);
+    CHECK(DLog_Get()->minVal == 100 && DLog_Get()->maxVal == 120 && DLog_Average() == 109);
+    CHECK(DLog_Get()->events[2] == 1);
+    CHECK(DLog_GetUser(0, got, sizeof(got)) == DLOG_RESULT_OK && memcmp(got, user, 4) == 0);
+
+    // Power loss at every byte of the block, over several rotations
+    for (round = 0; round < 3; ++round) {
+        for (cut = 0; cut <= FLASH_BLOCK_SIZE; ++cut) {
+            DLog_AddSample((uint16_t)(cut + round));
+            DLog_CountEvent(0);
+
+            Mock_FlashCut = cut;
+            if (cut < FLASH_BLOCK_SIZE) {
+                CHECK(DLog_Flush() == DLOG_RESULT_VERIFY);
+            } else {
+                CHECK(DLog_Flush() == DLOG_RESULT_OK);
+                memcpy(&last, DLog_Get(), sizeof(last));
+            }
+
+            // Reset: the last completed write wins
+            CHECK(DLog_Init() == DLOG_RESULT_OK);
+            if (memcmp(DLog_Get(), &last, sizeof(last)) != 0) {
+                printf("FAIL: round %d, cut at %d: seq %u recovered, %u expected\n",
+                       round, cut, DLog_Get()->seq, last.seq);
+                ++_failed;
+            }
+        }
+    }
+
+    CHECK(OutsideBlank());
+
+    // A failed write is retried on the next flush, into the same block
+    DLog_AddSample(7);
+    Mock_FlashCut = 10;
+    CHECK(DLog_Flush() == DLOG_RESULT_VERIFY);
+    CHECK(DLog_Flush() == DLOG_RESULT_OK);
+    memcpy(&last, DLog_Get(), sizeof(last));
+    CHECK(DLog_Init() == DLOG_RESULT_OK && memcmp(DLog_Get(), &last, sizeof(last)) == 0);
+
+    // Sequence numbers wrap around
+    memset(Mock_Eeprom, 0, sizeof(Mock_Eeprom));
+    Plant(0, 0xFFFE, 1);
+    Plant(1, 0xFFFF, 2);
+    CHECK(DLog_Init() == DLOG_RESULT_OK && DLog_Get()->count == 2);
+    DLog_AddSample(1);
+    CHECK(DLog_Flush() == DLOG_RESULT_OK && DLog_Get()->seq == 0);
+    CHECK(DLog_Init() == DLOG_RESULT_OK && DLog_Get()->seq == 0 && DLog_Get()->count == 3);
+
+    // A corrupted newest record falls back to the older one
+    Mock_Eeprom[DLOG_FIRST_BLOCK * FLASH_BLOCK_SIZE + 20] ^= 0x10;
+    CHECK(DLog_Init() == DLOG_RESULT_OK && DLog_Get()->seq == 0xFFFF);
+
+    // Garbage everywhere
+    memset(Mock_Eeprom, 0xFF, DLOG_NUM_BLOCKS * FLASH_BLOCK_SIZE);
+    CHECK(DLog_Init() == DLOG_RESULT_EMPTY);
+    memset(Mock_Eeprom, 0, sizeof(Mock_Eeprom));
+
+    // Periodic flush from the main loop
+    CHECK(DLog_Init() == DLOG_RESULT_EMPTY);
+    DLog_AddSample(5);
+    writes = Mock_FlashWrites;
+    for (i = 0; i < DLOG_FLUSH_MS - 1; ++i) {
+        Sys_ClockTick();
+        DLog_Poll();
+    }
+    CHECK(Mock_FlashWrites == writes);
+    Sys_ClockTick();
+    DLog_Poll();
+    CHECK(Mock_FlashWrites == writes + 1);
+    Sys_ClockTick();
+    DLog_Poll();
+    CHECK(Mock_FlashWrites == writes + 1);
+
+    CHECK(OutsideBlank());
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,471 @@
+/**
+ * @file i2c_test.c
+ * @brief Host test of the I2C master driver against simulated slaves
+ *
+ * The I2C peripheral is modelled on the mock registers: START/STOP requests
+ * in CR2, the SB/ADDR/TXE/BTF/RXNE events in SR1 with a data register in
+ * front of the shift register, AF in SR2 and the interrupt enables in ITR.
+ * Two slaves sit on the bus: a 24C02-style EEPROM at 0x50 (word address,
+ * then sequential data) and a read-only sensor at 0x48 that NACKs data
+ * writes. The bus recovery is checked with a slave holding SDA low.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Ii2c -Igpio -Isystem -Iinterrupt tests/i2c_test.c \
+ *      i2c/i2c.c gpio/io.c system/system.c tests/mock/mock.c -o i2c_test && ./i2c_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "system.h"
+#include "i2c.h"
+
+#define EE_ADDR     0x50
+#define SENSOR_ADDR 0x48
+#define SCL_PIN     GPIO_PIN_4
+#define SDA_PIN     GPIO_PIN_5
+
+IO_PIN _ios[IO_IDX_MAX] = {
+    [IOP_I2C_SCL] = { GPIOB, SCL_PIN },
+    [IOP_I2C_SDA] = { GPIOB, SDA_PIN },
+};
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/* Slaves ----------------------------------------------------------------- */
+
+static uint8_t _ee[256];
+static uint8_t _eePtr;
+static uint8_t _sensor[4] = { 0x12, 0x34, 0x56, 0x78 };
+static uint8_t _sensorPtr;
+static int _slave = -1;         // Addressed slave
+static int _first;              // Next written byte is the register address
+
+/**
+ * @brief Address phase
+ *
+ * @param addr 7-bit address
+ * @return int 1 if a slave acknowledged
+ */
+static int SlaveStart(uint8_t addr)
+{
+    _slave = (addr == EE_ADDR || addr == SENSOR_ADDR) ? addr : -1;
+    _first = 1;
+    return _slave >= 0;
+}
+
+/**
+ * @brief Byte written by the master
+ *
+ * @return int 1 for ACK
+ */
+static int SlaveWrite(uint8_t b)
+{
+    if (_slave == EE_ADDR) {
+        if (_first)
+            _eePtr = b;
+        else
+            _ee[_eePtr++] = b;
+    } else if (_slave == SENSOR_ADDR) {
+        if (!_first)
+            return 0;
+        _sensorPtr = b & 3;
+    }
+    _first = 0;
+    return 1;
+}
+
+/**
+ * @brief Byte read by the master
+ */
+static uint8_t SlaveRead(void)
+{
+    if (_slave == EE_ADDR)
+        return _ee[_eePtr++];
+    return _sensor[_sensorPtr++ & 3];
+}
+
+/* Peripheral model ------------------------------------------------------- */
+
+enum { BUS_IDLE, BUS_ADDR, BUS_TX, BUS_RX };
+
+static int _phase = BUS_IDLE;
+static int _shifting, _loaded, _rxActive;
+static uint8_t _shiftByte, _txBuf, _rxData;
+static int _dead;               // No START is ever generated (stuck bus)
+static unsigned _starts, _stops;
+
+/**
+ * @brief Check if the I2C interrupt is pending
+ *
+ * @return int Non-zero if pending
+ */
+static int I2cPending(void)
+{
+    uint8_t itr = I2C->ITR, sr1 = I2C->SR1;
+
+    if ((itr & I2C_ITR_ITERREN) && (I2C->SR2 & (I2C_SR2_AF | I2C_SR2_ARLO | I2C_SR2_BERR)))
+        return 1;
+    if (!(itr & I2C_ITR_ITEVTEN))
+        return 0;
+    if (sr1 & (I2C_SR1_SB | I2C_SR1_ADDR | I2C_SR1_BTF))
+        return 1;
+    return (itr & I2C_ITR_ITBUFEN) && (sr1 & (I2C_SR1_TXE | I2C_SR1_RXNE));
+}
+
+/**
+ * @brief Generate a STOP condition
+ */
+static void I2cStop(void)
+{
+    I2C->CR2 &= (uint8_t)~I2C_CR2_STOP;
+    I2C->SR1 &= I2C_SR1_RXNE;
+    I2C->SR3 = 0;
+    _phase = BUS_IDLE;
+    _shifting = _loaded = _rxActive = 0;
+    _slave = -1;
+    ++_stops;
+}
+
+/**
+ * @brief Call the ISR and apply its register accesses
+ */
+static void I2cIsr(void)
+{
+    uint8_t sr1 = I2C->SR1;
+    uint8_t b;
+
+    I2C->DR = 0x100 | _rxData;
+    Mock_Irq(IRQ_I2C);
+
+    // Reading SR3 after SR1 clears ADDR, reading DR clears RXNE; the driver
+    // does both whenever it sees the flag
+    if (sr1 & I2C_SR1_ADDR) {
+        I2C->SR1 &= (uint8_t)~I2C_SR1_ADDR;
+        if (_phase == BUS_TX)
+            I2C->SR1 |= I2C_SR1_TXE;
+        else
+            _rxActive = 1;
+    }
+    if (sr1 & I2C_SR1_RXNE)
+        I2C->SR1 &= (uint8_t)~I2C_SR1_RXNE;
+
+    if (I2C->DR & 0x100)
+        return;
+    b = (uint8_t)I2C->DR;
+
+    if (_phase == BUS_ADDR) {
+        I2C->SR1 &= (uint8_t)~I2C_SR1_SB;
+        if (SlaveStart(b >> 1)) {
+            I2C->SR1 |= I2C_SR1_ADDR;
+            _phase = (b & 1) ? BUS_RX : BUS_TX;
+            I2C->SR3 = (uint8_t)((I2C->SR3 & ~I2C_SR3_TRA) | ((b & 1) ? 0 : I2C_SR3_TRA));
+        } else {
+            I2C->SR2 |= I2C_SR2_AF;
+            _phase = BUS_IDLE;
+        }
+    } else if (_phase == BUS_TX) {
+        CHECK(!_loaded);
+        I2C->SR1 &= (uint8_t)~I2C_SR1_BTF;
+        if (_shifting) {
+            _txBuf = b;
+            _loaded = 1;
+            I2C->SR1 &= (uint8_t)~I2C_SR1_TXE;
+        } else {
+            _shiftByte = b;
+            _shifting = 1;
+        }
+    } else {
+        CHECK(0);
+    }
+}
+
+/**
+ * @brief Generate a requested START or STOP if the bus is between bytes
+ *
+ * @return int 0 if nothing happened
+ */
+static int I2cCondition(void)
+{
+    if (!(I2C->CR1 & I2C_CR1_PE))
+        return 0;
+
+    if ((I2C->CR2 & I2C_CR2_START) && !_dead &&
+        (_phase == BUS_IDLE || (_phase == BUS_TX && !_shifting && !_loaded))) {
+        I2C->CR2 &= (uint8_t)~I2C_CR2_START;
+        I2C->SR1 = I2C_SR1_SB;
+        I2C->SR3 |= I2C_SR3_MSL | I2C_SR3_BUSY;
+        _phase = BUS_ADDR;
+        ++_starts;
+        return 1;
+    }
+
+    if (I2C->CR2 & I2C_CR2_STOP) {
+        if (_phase == BUS_IDLE || _phase == BUS_ADDR ||
+            (_phase == BUS_TX && !_shifting && !_loaded) ||
+            (_phase == BUS_RX && !_rxActive)) {
+            I2cStop();
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Advance the bus by one byte
+ *
+ * @return int 0 if nothing happened
+ */
+static int I2cStep(void)
+{
+    if (!(I2C->CR1 & I2C_CR1_PE))
+        return 0;
+
+    if (_phase == BUS_TX && _shifting) {
+        if (!SlaveWrite(_shiftByte)) {
+            I2C->SR2 |= I2C_SR2_AF;
+            _shifting = _loaded = 0;
+            I2C->SR1 &= (uint8_t)~I2C_SR1_TXE;
+            return 1;
+        }
+        _shifting = 0;
+        if (_loaded) {
+            _shiftByte = _txBuf;
+            _shifting = 1;
+            _loaded = 0;
+            I2C->SR1 |= I2C_SR1_TXE;
+        } else {
+            I2C->SR1 |= I2C_SR1_BTF;
+        }
+        return 1;
+    }
+
+    if (_phase == BUS_RX && _rxActive && !(I2C->SR1 & I2C_SR1_RXNE)) {
+        _rxData = SlaveRead();
+        I2C->SR1 |= I2C_SR1_RXNE;
+        // NACKed byte: the slave lets go, a pending STOP follows
+        if (!(I2C->CR2 & I2C_CR2_ACK))
+            _rxActive = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Run bus, interrupts and the main loop poll until nothing moves
+ */
+static void I2cRun(void)
+{
+    int guard = 0;
+
+    while (++guard < 100000) {
+        if (I2cCondition())
+            continue;
+        if (I2cPending()) {
+            I2cIsr();
+            continue;
+        }
+        if (I2cStep())
+            continue;
+        I2C_Poll();
+        if (!I2cCondition() && !I2cPending() && !I2cStep())
+            return;
+    }
+    CHECK(0);
+}
+
+/* Stuck bus -------------------------------------------------------------- */
+
+static int _sdaHeld;            // SCL clocks until the slave releases SDA
+static unsigned _sclClocks;
+
+/**
+ * @brief Model the open-drain lines during bus recovery
+ *
+ * @param port Changed port
+ */
+static void BusHook(GPIO_TypeDef *port)
+{
+    static uint8_t lastScl = SCL_PIN;
+    uint8_t scl, sda;
+
+    if (port != GPIOB)
+        return;
+
+    scl = (port->DDR & SCL_PIN) ? (port->ODR & SCL_PIN) : SCL_PIN;
+    if (!lastScl && scl) {
+        ++_sclClocks;
+        if (_sdaHeld)
+            --_sdaHeld;
+    }
+    lastScl = scl;
+
+    sda = (port->DDR & SDA_PIN) ? (port->ODR & SDA_PIN) : SDA_PIN;
+    if (_sdaHeld)
+        sda = 0;
+    port->IDR = (uint8_t)((port->IDR & ~(SCL_PIN | SDA_PIN)) | scl | sda);
+}
+
+/* Tests ------------------------------------------------------------------ */
+
+static I2C_Xfer *_order[4];
+static unsigned _nDone;
+
+/**
+ * @brief Record the completion order
+ *
+ * @param x Finished transaction
+ */
+static void Done(I2C_Xfer *x)
+{
+    if (_nDone < 4)
+        _order[_nDone] = x;
+    ++_nDone;
+}
+
+/**
+ * @brief Fill a descriptor
+ */
+static void Xfer(I2C_Xfer *x, uint8_t addr, const uint8_t *w, uint8_t wlen,
+                 uint8_t *r, uint8_t rlen, I2C_Callback done)
+{
+    memset(x, 0, sizeof(*x));
+    x->addr = addr;
+    x->wdata = w;
+    x->wlen = wlen;
+    x->rdata = r;
+    x->rlen = rlen;
+    x->done = done;
+}
+
+/**
+ * @brief Run one transaction to completion
+ *
+ * @return I2C_Result Result of the transaction
+ */
+static I2C_Result Run(uint8_t addr, const uint8_t *w, uint8_t wlen, uint8_t *r, uint8_t rlen)
+{
+    I2C_Xfer x;
+
+    Xfer(&x, addr, w, wlen, r, rlen, NULL);
+    CHECK(I2C_Submit(&x) == I2C_RESULT_OK);
+    I2cRun();
+    CHECK(!x.busy && !I2C_Busy());
+    CHECK(!(I2C->SR3 & I2C_SR3_BUSY));
+    return x.result;
+}
+
+int main(void)
+{
+    static const uint8_t page[] = { 0x10, 'h', 'e', 'l', 'l', 'o', '!', 0x00, 0xFF };
+    uint8_t buf[16], reg = 1;
+    I2C_Xfer a, b, c, d;
+    int i;
+
+    Mock_Reset();
+    Mock_GpioHook = BusHook;
+    GPIOB->IDR = SCL_PIN | SDA_PIN;
+
+    // Registers for standard and fast mode at 16 MHz
+    CHECK(I2C_MasterInit(100000, 3) == I2C_RESULT_OK);
+    CHECK(I2C->FREQR == 16 && I2C->CCRL == 80 && I2C->CCRH == 0 && I2C->TRISER == 17);
+    CHECK(I2C->CR1 & I2C_CR1_PE);
+    CHECK(Mock_Handler(IRQ_I2C) == I2C_Isr);
+    CHECK(I2C_MasterInit(400000, 3) == I2C_RESULT_OK);
+    CHECK(I2C->CCRL == 13 && I2C->CCRH == 0x80 && I2C->TRISER == 5);
+    CHECK(I2C_MasterInit(400001, 3) == I2C_RESULT_INVALID_PARAM);
+
+    // Fast mode needs 4 MHz: the peripheral is off at 2 MHz and comes back
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV8, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(!(I2C->CR1 & I2C_CR1_PE));
+    CHECK(I2C_MasterInit(400000, 3) == I2C_RESULT_INVALID_PARAM);
+    CHECK(I2C_MasterInit(100000, 3) == I2C_RESULT_OK);
+    CHECK(I2C->FREQR == 2 && I2C->CCRL == 10 && (I2C->CR1 & I2C_CR1_PE));
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV1, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(I2C->FREQR == 16 && I2C->CCRL == 80);
+
+    // EEPROM write, then read back with a repeated start
+    CHECK(Run(EE_ADDR, page, sizeof(page), NULL, 0) == I2C_RESULT_OK);
+    CHECK(memcmp(&_ee[0x10], page + 1, sizeof(page) - 1) == 0);
+    for (i = 1; i <= 8; ++i) {
+        memset(buf, 0xAA, sizeof(buf));
+        CHECK(Run(EE_ADDR, page, 1, buf, (uint8_t)i) == I2C_RESULT_OK);
+        CHECK(memcmp(buf, page + 1, (size_t)i) == 0 && buf[i] == 0xAA);
+    }
+
+    // Read without a write phase continues at the EEPROM's pointer
+    CHECK(Run(EE_ADDR, page, 1, buf, 2) == I2C_RESULT_OK);
+    CHECK(Run(EE_ADDR, NULL, 0, buf, 2) == I2C_RESULT_OK);
+    CHECK(buf[0] == 'l' && buf[1] == 'l');
+
+    // Probes and NACKs
+    CHECK(Run(EE_ADDR, NULL, 0, NULL, 0) == I2C_RESULT_OK);
+    CHECK(Run(0x33, NULL, 0, NULL, 0) == I2C_RESULT_NACK);
+    CHECK(Run(0x33, page, 2, buf, 2) == I2C_RESULT_NACK);
+    CHECK(Run(SENSOR_ADDR, &reg, 1, buf, 2) == I2C_RESULT_OK);
+    CHECK(buf[0] == 0x34 && buf[1] == 0x56);
+    CHECK(Run(SENSOR_ADDR, page, 3, NULL, 0) == I2C_RESULT_NACK);
+
+    // Queue: three slots, completed in order; each START after the STOP
+    _nDone = 0;
+    _starts = _stops = 0;
+    Xfer(&a, EE_ADDR, page, 3, NULL, 0, Done);
+    Xfer(&b, SENSOR_ADDR, &reg, 1, buf, 1, Done);
+    Xfer(&c, EE_ADDR, page, 1, buf + 1, 4, Done);
+    Xfer(&d, EE_ADDR, NULL, 0, NULL, 0, Done);
+    CHECK(I2C_Submit(&a) == I2C_RESULT_OK);
+    CHECK(I2C_Submit(&b) == I2C_RESULT_OK);
+    CHECK(I2C_Submit(&c) == I2C_RESULT_OK);
+    CHECK(I2C_Submit(&d) == I2C_RESULT_QUEUE_FULL);
+    CHECK(I2C_Submit(&a) == I2C_RESULT_BUSY);
+    I2cRun();
+    CHECK(_nDone == 3 && _order[0] == &a && _order[1] == &b && _order[2] == &c);
+    CHECK(a.result == I2C_RESULT_OK && b.result == I2C_RESULT_OK && c.result == I2C_RESULT_OK);
+    CHECK(buf[0] == 0x34 && buf[1] == 'h' && buf[2] == 'e');
+    CHECK(_starts == 5 && _stops == 3);  // b and c have a repeated start
+
+    // Invalid descriptors
+    Xfer(&a, 0x80, NULL, 0, NULL, 0, NULL);
+    CHECK(I2C_Submit(&a) == I2C_RESULT_INVALID_PARAM);
+    Xfer(&a, EE_ADDR, NULL, 1, NULL, 0, NULL);
+    CHECK(I2C_Submit(&a) == I2C_RESULT_INVALID_PARAM);
+
+    // Stuck bus: times out after I2C_TIMEOUT_MS, recovery clocks SDA free
+    _dead = 1;
+    _sdaHeld = 3;
+    _sclClocks = 0;
+    BusHook(GPIOB);
+    Xfer(&a, EE_ADDR, page, 2, NULL, 0, NULL);
+    CHECK(I2C_Submit(&a) == I2C_RESULT_OK);
+    for (i = 0; i < I2C_TIMEOUT_MS - 1; ++i) {
+        Sys_ClockTick();
+        I2cRun();
+    }
+    CHECK(a.busy);
+    Sys_ClockTick();
+    I2cRun();
+    CHECK(!a.busy && a.result == I2C_RESULT_TIMEOUT && !I2C_Busy());
+    CHECK(_sdaHeld == 0 && _sclClocks >= 3 && (GPIOB->IDR & SDA_PIN));
+    CHECK(I2C->CR1 & I2C_CR1_PE);
+
+    _dead = 0;
+    I2cStop();
+    CHECK(Run(EE_ADDR, page, 1, buf, 3) == I2C_RESULT_OK);
+    CHECK(memcmp(buf, page + 1, 3) == 0);
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,754 @@
+/**
+ * @file mock.c
+ * @brief Host implementation of the SPL subset used by the drivers
+ *
+ * The functions write the peripheral registers the way the real library
+ * does, so tests can check the register values a driver programs. Interrupt
+ * registration and locking (interrupt.h) are replaced as well: handlers are
+ * stored and the tests call them through Mock_Irq.
+ */
+
+#include <string.h>
+#include "stm8s.h"
+#include "mock.h"
+
+GPIO_TypeDef Mock_GPIOA, Mock_GPIOB, Mock_GPIOC, Mock_GPIOD, Mock_GPIOE;
+TIM1_TypeDef Mock_TIM1;
+TIM2_TypeDef Mock_TIM2;
+TIM4_TypeDef Mock_TIM4;
+SPI_TypeDef Mock_SPI;
+I2C_TypeDef Mock_I2C;
+UART1_TypeDef Mock_UART1;
+ADC1_TypeDef Mock_ADC1;
+CLK_TypeDef Mock_CLK;
+
+uint8_t Mock_Eeprom[FLASH_DATA_BLOCKS_NUMBER * FLASH_BLOCK_SIZE];
+uint8_t Mock_Flash[FLASH_PROG_BLOCKS_NUMBER * FLASH_BLOCK_SIZE];
+int Mock_FlashCut = -1;
+unsigned Mock_FlashWrites = 0;
+
+uint8_t Mock_CC = 0x28;
+uint8_t Mock_Priority[32];
+uint8_t Mock_ExtiSens[5];
+void (*Mock_GpioHook)(GPIO_TypeDef *port) = NULL;
+uint16_t (*Mock_AdcInput)(uint8_t ch) = NULL;
+void (*Mock_Tim1Hook)(void) = NULL;
+void (*Mock_Tim2Hook)(void) = NULL;
+
+static IRQ_Handler _handlers[IRQ_IDX_MAX];
+
+void Mock_Reset(void)
+{
+  memset(&Mock_GPIOA, 0, sizeof(GPIO_TypeDef));
+  memset(&Mock_GPIOB, 0, sizeof(GPIO_TypeDef));
+  memset(&Mock_GPIOC, 0, sizeof(GPIO_TypeDef));
+  memset(&Mock_GPIOD, 0, sizeof(GPIO_TypeDef));
+  memset(&Mock_GPIOE, 0, sizeof(GPIO_TypeDef));
+  memset(&Mock_TIM1, 0, sizeof(Mock_TIM1));
+  memset(&Mock_TIM2, 0, sizeof(Mock_TIM2));
+  memset(&Mock_TIM4, 0, sizeof(Mock_TIM4));
+  memset(&Mock_SPI, 0, sizeof(Mock_SPI));
+  memset(&Mock_I2C, 0, sizeof(Mock_I2C));
+  memset(&Mock_UART1, 0, sizeof(Mock_UART1));
+  memset(&Mock_ADC1, 0, sizeof(Mock_ADC1));
+  memset(&Mock_CLK, 0, sizeof(Mock_CLK));
+  memset(_handlers, 0, sizeof(_handlers));
+
+  Mock_TIM1.ARRH = Mock_TIM1.ARRL = 0xFF;
+  Mock_TIM2.ARRH = Mock_TIM2.ARRL = 0xFF;
+  Mock_TIM4.ARR = 0xFF;
+  Mock_SPI.SR = SPI_SR_TXE;
+  Mock_UART1.SR = UART1_SR_TXE | UART1_SR_TC;
+  Mock_CLK.CKDIVR = 0x18;
+  Mock_CC = 0x28;
+}
+
+uint32_t Mock_MasterClock(void)
+{
+  return 16000000UL >> ((Mock_CLK.CKDIVR >> 3) & 0x03);
+}
+
+void Mock_Irq(IRQ_IDX idx)
+{
+  if (_handlers[idx])
+    _handlers[idx]();
+}
+
+IRQ_Handler Mock_Handler(IRQ_IDX idx)
+{
+  return _handlers[idx];
+}
+
+TIM1_TypeDef *Mock_Tim1(void)
+{
+  if (Mock_Tim1Hook)
+    Mock_Tim1Hook();
+  return &Mock_TIM1;
+}
+
+TIM2_TypeDef *Mock_Tim2(void)
+{
+  if (Mock_Tim2Hook)
+    Mock_Tim2Hook();
+  return &Mock_TIM2;
+}
+
+/* Interrupt module ------------------------------------------------------- */
+
+IRQ_Result IRQ_Register(IRQ_IDX idx, IRQ_Handler handler)
+{
+  if (idx >= IRQ_IDX_MAX)
+    return IRQ_RESULT_INVALID_IRQ;
+  _handlers[idx] = handler;
+  return IRQ_RESULT_OK;
+}
+
+IRQ_State IRQ_Lock(void)
+{
+  IRQ_State s = Mock_CC;
+  Mock_CC |= 0x28;
+  return s;
+}
+
+void IRQ_Unlock(IRQ_State s)
+{
+  Mock_CC = s;
+}
+
+void Mock_EnableInterrupts(void)
+{
+  Mock_CC &= (uint8_t)~0x28;
+}
+
+void Mock_DisableInterrupts(void)
+{
+  Mock_CC |= 0x28;
+}
+
+uint8_t ITC_GetCPUCC(void)
+{
+  return Mock_CC;
+}
+
+void ITC_SetSoftwarePriority(ITC_Irq_TypeDef IrqNum, ITC_PriorityLevel_TypeDef PriorityValue)
+{
+  Mock_Priority[IrqNum & 31] = (uint8_t)PriorityValue;
+}
+
+void EXTI_SetExtIntSensitivity(EXTI_Port_TypeDef Port, EXTI_Sensitivity_TypeDef SensitivityValue)
+{
+  Mock_ExtiSens[Port] = (uint8_t)SensitivityValue;
+}
+
+/* CLK -------------------------------------------------------------------- */
+
+void CLK_DeInit(void)
+{
+  Mock_CLK.CKDIVR = 0x18;
+}
+
+void CLK_HSIPrescalerConfig(CLK_Prescaler_TypeDef HSIPrescaler)
+{
+  Mock_CLK.CKDIVR = (uint8_t)((Mock_CLK.CKDIVR & ~0x18) | HSIPrescaler);
+}
+
+void CLK_SYSCLKConfig(CLK_Prescaler_TypeDef CLK_Prescaler)
+{
+  if (CLK_Prescaler & 0x80)
+    Mock_CLK.CKDIVR = (uint8_t)((Mock_CLK.CKDIVR & ~0x07) | (CLK_Prescaler & 0x07));
+  else
+    Mock_CLK.CKDIVR = (uint8_t)((Mock_CLK.CKDIVR & ~0x18) | (CLK_Prescaler & 0x18));
+}
+
+void CLK_PeripheralClockConfig(CLK_Peripheral_TypeDef CLK_Peripheral, FunctionalState NewState)
+{
+  uint8_t bit = (uint8_t)(1 << (CLK_Peripheral & 0x0F));
+  __IO uint8_t *reg = (CLK_Peripheral & 0x10) ? &Mock_CLK.PCKENR2 : &Mock_CLK.PCKENR1;
+
+  if (NewState)
+    *reg |= bit;
+  else
+    *reg &= (uint8_t)~bit;
+}
+
+/* GPIO ------------------------------------------------------------------- */
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef GPIO_Pin, GPIO_Mode_TypeDef GPIO_Mode)
+{
+  GPIOx->CR2 &= (uint8_t)~GPIO_Pin;
+  if (GPIO_Mode & 0x80) {
+    if (GPIO_Mode & 0x10)
+      GPIOx->ODR |= GPIO_Pin;
+    else
+      GPIOx->ODR &= (uint8_t)~GPIO_Pin;
+    GPIOx->DDR |= GPIO_Pin;
+  } else {
+    GPIOx->DDR &= (uint8_t)~GPIO_Pin;
+  }
+  if (GPIO_Mode & 0x40)
+    GPIOx->CR1 |= GPIO_Pin;
+  else
+    GPIOx->CR1 &= (uint8_t)~GPIO_Pin;
+  if (GPIO_Mode & 0x20)
+    GPIOx->CR2 |= GPIO_Pin;
+
+  if (Mock_GpioHook)
+    Mock_GpioHook(GPIOx);
+}
+
+void GPIO_WriteHigh(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef PortPins)
+{
+  GPIOx->ODR |= PortPins;
+  if (Mock_GpioHook)
+    Mock_GpioHook(GPIOx);
+}
+
+void GPIO_WriteLow(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef PortPins)
+{
+  GPIOx->ODR &= (uint8_t)~PortPins;
+  if (Mock_GpioHook)
+    Mock_GpioHook(GPIOx);
+}
+
+BitStatus GPIO_ReadInputPin(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef GPIO_Pin)
+{
+  return (GPIOx->IDR & GPIO_Pin) ? SET : RESET;
+}
+
+/* TIM1 ------------------------------------------------------------------- */
+
+void TIM1_TimeBaseInit(uint16_t TIM1_Prescaler, TIM1_CounterMode_TypeDef TIM1_CounterMode,
+                       uint16_t TIM1_Period, uint8_t TIM1_RepetitionCounter)
+{
+  Mock_TIM1.ARRH = (uint8_t)(TIM1_Period >> 8);
+  Mock_TIM1.ARRL = (uint8_t)TIM1_Period;
+  Mock_TIM1.PSCRH = (uint8_t)(TIM1_Prescaler >> 8);
+  Mock_TIM1.PSCRL = (uint8_t)TIM1_Prescaler;
+  Mock_TIM1.CR1 = (uint8_t)((Mock_TIM1.CR1 & 0x8F) | TIM1_CounterMode);
+  Mock_TIM1.RCR = TIM1_RepetitionCounter;
+}
+
+void TIM1_Cmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM1.CR1 |= TIM1_CR1_CEN;
+  else
+    Mock_TIM1.CR1 &= (uint8_t)~TIM1_CR1_CEN;
+}
+
+void TIM1_PrescalerConfig(uint16_t Prescaler, TIM1_PSCReloadMode_TypeDef TIM1_PSCReloadMode)
+{
+  Mock_TIM1.PSCRH = (uint8_t)(Prescaler >> 8);
+  Mock_TIM1.PSCRL = (uint8_t)Prescaler;
+  Mock_TIM1.EGR = (uint8_t)TIM1_PSCReloadMode;
+}
+
+void TIM1_SetAutoreload(uint16_t Autoreload)
+{
+  Mock_TIM1.ARRH = (uint8_t)(Autoreload >> 8);
+  Mock_TIM1.ARRL = (uint8_t)Autoreload;
+}
+
+void TIM1_SetCounter(uint16_t Counter)
+{
+  Mock_TIM1.CNTRH = (uint8_t)(Counter >> 8);
+  Mock_TIM1.CNTRL = (uint8_t)Counter;
+}
+
+uint16_t TIM1_GetCounter(void)
+{
+  return (uint16_t)((Mock_TIM1.CNTRH << 8) | Mock_TIM1.CNTRL);
+}
+
+void TIM1_ARRPreloadConfig(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM1.CR1 |= TIM1_CR1_ARPE;
+  else
+    Mock_TIM1.CR1 &= (uint8_t)~TIM1_CR1_ARPE;
+}
+
+void TIM1_ITConfig(TIM1_IT_TypeDef TIM1_IT, FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM1.IER |= (uint8_t)TIM1_IT;
+  else
+    Mock_TIM1.IER &= (uint8_t)~TIM1_IT;
+}
+
+void TIM1_ClearITPendingBit(TIM1_IT_TypeDef TIM1_IT)
+{
+  Mock_TIM1.SR1 &= (uint8_t)~TIM1_IT;
+}
+
+void TIM1_OC1Init(TIM1_OCMode_TypeDef TIM1_OCMode, TIM1_OutputState_TypeDef TIM1_OutputState,
+                  TIM1_OutputNState_TypeDef TIM1_OutputNState, uint16_t TIM1_Pulse,
+                  TIM1_OCPolarity_TypeDef TIM1_OCPolarity, TIM1_OCNPolarity_TypeDef TIM1_OCNPolarity,
+                  TIM1_OCIdleState_TypeDef TIM1_OCIdleState, TIM1_OCNIdleState_TypeDef TIM1_OCNIdleState)
+{
+  (void)TIM1_OutputNState; (void)TIM1_OCNPolarity;
+  (void)TIM1_OCIdleState; (void)TIM1_OCNIdleState;
+  Mock_TIM1.CCMR1 = (uint8_t)((Mock_TIM1.CCMR1 & ~0x70) | TIM1_OCMode);
+  Mock_TIM1.CCER1 = (uint8_t)((Mock_TIM1.CCER1 & ~0x03) |
+                              (TIM1_OutputState & 0x01) | (TIM1_OCPolarity & 0x02));
+  Mock_TIM1.CCR1H = (uint8_t)(TIM1_Pulse >> 8);
+  Mock_TIM1.CCR1L = (uint8_t)TIM1_Pulse;
+}
+
+void TIM1_OC2Init(TIM1_OCMode_TypeDef TIM1_OCMode, TIM1_OutputState_TypeDef TIM1_OutputState,
+                  TIM1_OutputNState_TypeDef TIM1_OutputNState, uint16_t TIM1_Pulse,
+                  TIM1_OCPolarity_TypeDef TIM1_OCPolarity, TIM1_OCNPolarity_TypeDef TIM1_OCNPolarity,
+                  TIM1_OCIdleState_TypeDef TIM1_OCIdleState, TIM1_OCNIdleState_TypeDef TIM1_OCNIdleState)
+{
+  (void)TIM1_OutputNState; (void)TIM1_OCNPolarity;
+  (void)TIM1_OCIdleState; (void)TIM1_OCNIdleState;
+  Mock_TIM1.CCMR2 = (uint8_t)((Mock_TIM1.CCMR2 & ~0x70) | TIM1_OCMode);
+  Mock_TIM1.CCER1 = (uint8_t)((Mock_TIM1.CCER1 & ~0x30) |
+                              ((TIM1_OutputState & 0x01) << 4) | ((TIM1_OCPolarity & 0x02) << 4));
+  Mock_TIM1.CCR2H = (uint8_t)(TIM1_Pulse >> 8);
+  Mock_TIM1.CCR2L = (uint8_t)TIM1_Pulse;
+}
+
+void TIM1_OC1PreloadConfig(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM1.CCMR1 |= 0x08;
+  else
+    Mock_TIM1.CCMR1 &= (uint8_t)~0x08;
+}
+
+void TIM1_OC2PreloadConfig(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM1.CCMR2 |= 0x08;
+  else
+    Mock_TIM1.CCMR2 &= (uint8_t)~0x08;
+}
+
+void TIM1_SelectOutputTrigger(TIM1_TRGOSource_TypeDef TIM1_TRGOSource)
+{
+  Mock_TIM1.CR2 = (uint8_t)((Mock_TIM1.CR2 & ~0x70) | TIM1_TRGOSource);
+}
+
+/* TIM2 ------------------------------------------------------------------- */
+
+void TIM2_TimeBaseInit(TIM2_Prescaler_TypeDef TIM2_Prescaler, uint16_t TIM2_Period)
+{
+  Mock_TIM2.PSCR = (uint8_t)TIM2_Prescaler;
+  Mock_TIM2.ARRH = (uint8_t)(TIM2_Period >> 8);
+  Mock_TIM2.ARRL = (uint8_t)TIM2_Period;
+}
+
+void TIM2_Cmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM2.CR1 |= TIM2_CR1_CEN;
+  else
+    Mock_TIM2.CR1 &= (uint8_t)~TIM2_CR1_CEN;
+}
+
+void TIM2_PrescalerConfig(TIM2_Prescaler_TypeDef Prescaler, TIM2_PSCReloadMode_TypeDef TIM2_PSCReloadMode)
+{
+  Mock_TIM2.PSCR = (uint8_t)Prescaler;
+  Mock_TIM2.EGR = (uint8_t)TIM2_PSCReloadMode;
+}
+
+void TIM2_SetAutoreload(uint16_t Autoreload)
+{
+  Mock_TIM2.ARRH = (uint8_t)(Autoreload >> 8);
+  Mock_TIM2.ARRL = (uint8_t)Autoreload;
+}
+
+void TIM2_SetCounter(uint16_t Counter)
+{
+  Mock_TIM2.CNTRH = (uint8_t)(Counter >> 8);
+  Mock_TIM2.CNTRL = (uint8_t)Counter;
+}
+
+uint16_t TIM2_GetCounter(void)
+{
+  return (uint16_t)((Mock_TIM2.CNTRH << 8) | Mock_TIM2.CNTRL);
+}
+
+void TIM2_ARRPreloadConfig(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM2.CR1 |= TIM2_CR1_ARPE;
+  else
+    Mock_TIM2.CR1 &= (uint8_t)~TIM2_CR1_ARPE;
+}
+
+void TIM2_ITConfig(TIM2_IT_TypeDef TIM2_IT, FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM2.IER |= (uint8_t)TIM2_IT;
+  else
+    Mock_TIM2.IER &= (uint8_t)~TIM2_IT;
+}
+
+void TIM2_ClearITPendingBit(TIM2_IT_TypeDef TIM2_IT)
+{
+  Mock_TIM2.SR1 &= (uint8_t)~TIM2_IT;
+}
+
+void TIM2_OC1Init(TIM2_OCMode_TypeDef TIM2_OCMode, TIM2_OutputState_TypeDef TIM2_OutputState,
+                  uint16_t TIM2_Pulse, TIM2_OCPolarity_TypeDef TIM2_OCPolarity)
+{
+  Mock_TIM2.CCMR1 = (uint8_t)((Mock_TIM2.CCMR1 & ~0x70) | TIM2_OCMode);
+  Mock_TIM2.CCER1 = (uint8_t)((Mock_TIM2.CCER1 & ~0x03) |
+                              (TIM2_OutputState & 0x01) | (TIM2_OCPolarity & 0x02));
+  Mock_TIM2.CCR1H = (uint8_t)(TIM2_Pulse >> 8);
+  Mock_TIM2.CCR1L = (uint8_t)TIM2_Pulse;
+}
+
+void TIM2_OC2Init(TIM2_OCMode_TypeDef TIM2_OCMode, TIM2_OutputState_TypeDef TIM2_OutputState,
+                  uint16_t TIM2_Pulse, TIM2_OCPolarity_TypeDef TIM2_OCPolarity)
+{
+  Mock_TIM2.CCMR2 = (uint8_t)((Mock_TIM2.CCMR2 & ~0x70) | TIM2_OCMode);
+  Mock_TIM2.CCER1 = (uint8_t)((Mock_TIM2.CCER1 & ~0x30) |
+                              ((TIM2_OutputState & 0x01) << 4) | ((TIM2_OCPolarity & 0x02) << 4));
+  Mock_TIM2.CCR2H = (uint8_t)(TIM2_Pulse >> 8);
+  Mock_TIM2.CCR2L = (uint8_t)TIM2_Pulse;
+}
+
+void TIM2_OC3Init(TIM2_OCMode_TypeDef TIM2_OCMode, TIM2_OutputState_TypeDef TIM2_OutputState,
+                  uint16_t TIM2_Pulse, TIM2_OCPolarity_TypeDef TIM2_OCPolarity)
+{
+  Mock_TIM2.CCMR3 = (uint8_t)((Mock_TIM2.CCMR3 & ~0x70) | TIM2_OCMode);
+  Mock_TIM2.CCER2 = (uint8_t)((Mock_TIM2.CCER2 & ~0x03) |
+                              (TIM2_OutputState & 0x01) | (TIM2_OCPolarity & 0x02));
+  Mock_TIM2.CCR3H = (uint8_t)(TIM2_Pulse >> 8);
+  Mock_TIM2.CCR3L = (uint8_t)TIM2_Pulse;
+}
+
+void TIM2_OC1PreloadConfig(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM2.CCMR1 |= 0x08;
+  else
+    Mock_TIM2.CCMR1 &= (uint8_t)~0x08;
+}
+
+void TIM2_OC2PreloadConfig(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM2.CCMR2 |= 0x08;
+  else
+    Mock_TIM2.CCMR2 &= (uint8_t)~0x08;
+}
+
+void TIM2_OC3PreloadConfig(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM2.CCMR3 |= 0x08;
+  else
+    Mock_TIM2.CCMR3 &= (uint8_t)~0x08;
+}
+
+/* TIM4 ------------------------------------------------------------------- */
+
+void TIM4_DeInit(void)
+{
+  memset(&Mock_TIM4, 0, sizeof(Mock_TIM4));
+  Mock_TIM4.ARR = 0xFF;
+}
+
+void TIM4_TimeBaseInit(TIM4_Prescaler_TypeDef TIM4_Prescaler, uint8_t TIM4_Period)
+{
+  Mock_TIM4.PSCR = (uint8_t)TIM4_Prescaler;
+  Mock_TIM4.ARR = TIM4_Period;
+}
+
+void TIM4_Cmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM4.CR1 |= TIM4_CR1_CEN;
+  else
+    Mock_TIM4.CR1 &= (uint8_t)~TIM4_CR1_CEN;
+}
+
+void TIM4_ITConfig(TIM4_IT_TypeDef TIM4_IT, FunctionalState NewState)
+{
+  if (NewState)
+    Mock_TIM4.IER |= (uint8_t)TIM4_IT;
+  else
+    Mock_TIM4.IER &= (uint8_t)~TIM4_IT;
+}
+
+void TIM4_ClearFlag(TIM4_FLAG_TypeDef TIM4_FLAG)
+{
+  Mock_TIM4.SR1 = (uint8_t)~TIM4_FLAG;
+}
+
+/* SPI -------------------------------------------------------------------- */
+
+void SPI_DeInit(void)
+{
+  memset(&Mock_SPI, 0, sizeof(Mock_SPI));
+  Mock_SPI.SR = SPI_SR_TXE;
+  Mock_SPI.CRCPR = 0x07;
+}
+
+void SPI_Init(SPI_FirstBit_TypeDef FirstBit, SPI_BaudRatePrescaler_TypeDef BaudRatePrescaler,
+              SPI_Mode_TypeDef Mode, SPI_ClockPolarity_TypeDef ClockPolarity,
+              SPI_ClockPhase_TypeDef ClockPhase, SPI_DataDirection_TypeDef Data_Direction,
+              SPI_NSS_TypeDef Slave_Management, uint8_t CRCPolynomial)
+{
+  Mock_SPI.CR1 = (uint8_t)(FirstBit | BaudRatePrescaler | ClockPolarity | ClockPhase | Mode);
+  Mock_SPI.CR2 = (uint8_t)(Data_Direction | Slave_Management);
+  Mock_SPI.CRCPR = CRCPolynomial;
+}
+
+void SPI_Cmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_SPI.CR1 |= SPI_CR1_SPE;
+  else
+    Mock_SPI.CR1 &= (uint8_t)~SPI_CR1_SPE;
+}
+
+void SPI_NSSInternalSoftwareCmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_SPI.CR2 |= 0x01;
+  else
+    Mock_SPI.CR2 &= (uint8_t)~0x01;
+}
+
+/* I2C -------------------------------------------------------------------- */
+
+void I2C_DeInit(void)
+{
+  memset(&Mock_I2C, 0, sizeof(Mock_I2C));
+  Mock_I2C.TRISER = 0x02;
+}
+
+void I2C_Init(uint32_t OutputClockFrequencyHz, uint16_t OwnAddress,
+              I2C_DutyCycle_TypeDef I2C_DutyCycle, I2C_Ack_TypeDef Ack,
+              I2C_AddMode_TypeDef AddMode, uint8_t InputClockFrequencyMHz)
+{
+  uint32_t ccr;
+  uint8_t ccrh = 0;
+
+  Mock_I2C.FREQR = InputClockFrequencyMHz;
+  Mock_I2C.CR1 &= (uint8_t)~I2C_CR1_PE;
+
+  if (OutputClockFrequencyHz > 100000) {
+    if (I2C_DutyCycle == I2C_DUTYCYCLE_2)
+      ccr = (uint32_t)InputClockFrequencyMHz * 1000000 / (OutputClockFrequencyHz * 3);
+    else
+      ccr = (uint32_t)InputClockFrequencyMHz * 1000000 / (OutputClockFrequencyHz * 25);
+    if (ccr < 1)
+      ccr = 1;
+    ccrh = (uint8_t)(0x80 | I2C_DutyCycle);
+    Mock_I2C.TRISER = (uint8_t)((InputClockFrequencyMHz * 3) / 10 + 1);
+  } else {
+    ccr = (uint32_t)InputClockFrequencyMHz * 1000000 / (OutputClockFrequencyHz << 1);
+    if (ccr < 4)
+      ccr = 4;
+    Mock_I2C.TRISER = (uint8_t)(InputClockFrequencyMHz + 1);
+  }
+
+  Mock_I2C.CCRL = (uint8_t)ccr;
+  Mock_I2C.CCRH = (uint8_t)(ccrh | ((ccr >> 8) & 0x0F));
+  Mock_I2C.CR1 |= I2C_CR1_PE;
+
+  if (Ack == I2C_ACK_NONE)
+    Mock_I2C.CR2 &= (uint8_t)~I2C_CR2_ACK;
+  else
+    Mock_I2C.CR2 |= I2C_CR2_ACK;
+
+  Mock_I2C.OARL = (uint8_t)OwnAddress;
+  Mock_I2C.OARH = (uint8_t)(AddMode | 0x40 | ((OwnAddress >> 7) & 0x06));
+}
+
+void I2C_Cmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_I2C.CR1 |= I2C_CR1_PE;
+  else
+    Mock_I2C.CR1 &= (uint8_t)~I2C_CR1_PE;
+}
+
+/* UART1 ------------------------------------------------------------------ */
+
+void UART1_DeInit(void)
+{
+  memset(&Mock_UART1, 0, sizeof(Mock_UART1));
+  Mock_UART1.SR = UART1_SR_TXE | UART1_SR_TC;
+}
+
+void UART1_Init(uint32_t BaudRate, UART1_WordLength_TypeDef WordLength,
+                UART1_StopBits_TypeDef StopBits, UART1_Parity_TypeDef Parity,
+                UART1_SyncMode_TypeDef SyncMode, UART1_Mode_TypeDef Mode)
+{
+  uint32_t mant = Mock_MasterClock() / (BaudRate << 4);
+  uint32_t mant100 = Mock_MasterClock() * 100 / (BaudRate << 4);
+
+  Mock_UART1.CR1 = (uint8_t)(WordLength | Parity);
+  Mock_UART1.CR3 = (uint8_t)(StopBits | (SyncMode & 0x0F));
+  Mock_UART1.BRR2 = (uint8_t)(((((mant100 - mant * 100) << 4) / 100) & 0x0F) |
+                              ((mant >> 4) & 0xF0));
+  Mock_UART1.BRR1 = (uint8_t)mant;
+  Mock_UART1.CR2 = (uint8_t)Mode;
+}
+
+void UART1_Cmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_UART1.CR1 &= (uint8_t)~0x20;
+  else
+    Mock_UART1.CR1 |= 0x20;
+}
+
+FlagStatus UART1_GetFlagStatus(UART1_Flag_TypeDef UART1_FLAG)
+{
+  return (Mock_UART1.SR & UART1_FLAG) ? SET : RESET;
+}
+
+void UART1_SendData8(uint8_t Data)
+{
+  Mock_UART1.DR = Data;
+}
+
+uint8_t UART1_ReceiveData8(void)
+{
+  return (uint8_t)Mock_UART1.DR;
+}
+
+/* ADC1 ------------------------------------------------------------------- */
+
+void ADC1_DeInit(void)
+{
+  memset(&Mock_ADC1, 0, sizeof(Mock_ADC1));
+}
+
+void ADC1_Init(ADC1_ConvMode_TypeDef ADC1_ConversionMode, ADC1_Channel_TypeDef ADC1_Channel,
+               ADC1_PresSel_TypeDef ADC1_PrescalerSelection, ADC1_ExtTrig_TypeDef ADC1_ExtTrigger,
+               FunctionalState ADC1_ExtTriggerState, ADC1_Align_TypeDef ADC1_Align,
+               ADC1_SchmittTrigg_TypeDef ADC1_SchmittTriggerChannel,
+               FunctionalState ADC1_SchmittTriggerState)
+{
+  (void)ADC1_SchmittTriggerChannel; (void)ADC1_SchmittTriggerState;
+  ADC1_ConversionConfig(ADC1_ConversionMode, ADC1_Channel, ADC1_Align);
+  Mock_ADC1.CR1 = (uint8_t)((Mock_ADC1.CR1 & ~0x70) | ADC1_PrescalerSelection);
+  Mock_ADC1.CR2 = (uint8_t)((Mock_ADC1.CR2 & ~0x30) | ADC1_ExtTrigger |
+                            (ADC1_ExtTriggerState ? 0x40 : 0));
+}
+
+void ADC1_Cmd(FunctionalState NewState)
+{
+  if (NewState)
+    Mock_ADC1.CR1 |= ADC1_CR1_ADON;
+  else
+    Mock_ADC1.CR1 &= (uint8_t)~ADC1_CR1_ADON;
+}
+
+void ADC1_ITConfig(ADC1_IT_TypeDef ADC1_IT, FunctionalState NewState)
+{
+  if (NewState)
+    Mock_ADC1.CSR |= (uint8_t)ADC1_IT;
+  else
+    Mock_ADC1.CSR &= (uint8_t)~ADC1_IT;
+}
+
+void ADC1_ConversionConfig(ADC1_ConvMode_TypeDef ADC1_ConversionMode,
+                           ADC1_Channel_TypeDef ADC1_Channel, ADC1_Align_TypeDef ADC1_Align)
+{
+  Mock_ADC1.CR2 = (uint8_t)((Mock_ADC1.CR2 & ~0x08) | ADC1_Align);
+  Mock_ADC1.CR1 = (uint8_t)((Mock_ADC1.CR1 & ~0x02) | (ADC1_ConversionMode << 1));
+  Mock_ADC1.CSR = (uint8_t)((Mock_ADC1.CSR & ~0x0F) | ADC1_Channel);
+}
+
+void ADC1_StartConversion(void)
+{
+  uint16_t v;
+
+  Mock_ADC1.CR1 |= ADC1_CR1_ADON;
+  if (Mock_AdcInput == NULL)
+    return;
+
+  // Convert at once: data registers per alignment, then EOC
+  v = (uint16_t)(Mock_AdcInput(Mock_ADC1.CSR & 0x0F) & 0x3FF);
+  if (Mock_ADC1.CR2 & ADC1_ALIGN_RIGHT) {
+    Mock_ADC1.DRH = (uint8_t)(v >> 8);
+    Mock_ADC1.DRL = (uint8_t)v;
+  } else {
+    Mock_ADC1.DRH = (uint8_t)(v >> 2);
+    Mock_ADC1.DRL = (uint8_t)(v & 0x03);
+  }
+  Mock_ADC1.CSR |= ADC1_CSR_EOC;
+}
+
+uint16_t ADC1_GetConversionValue(void)
+{
+  if (Mock_ADC1.CR2 & ADC1_ALIGN_RIGHT)
+    return (uint16_t)(Mock_ADC1.DRL | (Mock_ADC1.DRH << 8));
+  return (uint16_t)((Mock_ADC1.DRL & 0x03) | (Mock_ADC1.DRH << 2));
+}
+
+FlagStatus ADC1_GetFlagStatus(ADC1_Flag_TypeDef Flag)
+{
+  return (Mock_ADC1.CSR & Flag) ? SET : RESET;
+}
+
+void ADC1_ClearFlag(ADC1_Flag_TypeDef Flag)
+{
+  Mock_ADC1.CSR &= (uint8_t)~Flag;
+}
+
+/* FLASH ------------------------------------------------------------------ */
+
+void FLASH_Unlock(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  (void)FLASH_MemType;
+}
+
+void FLASH_Lock(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  (void)FLASH_MemType;
+}
+
+void FLASH_ProgramBlock(uint16_t BlockNum, FLASH_MemType_TypeDef FLASH_MemType,
+                        FLASH_ProgramMode_TypeDef FLASH_ProgMode, uint8_t *Buffer)
+{
+  uint8_t *dst;
+  int n = FLASH_BLOCK_SIZE;
+
+  if (FLASH_MemType == FLASH_MEMTYPE_DATA) {
+    if (BlockNum >= FLASH_DATA_BLOCKS_NUMBER)
+      return;
+    dst = &Mock_Eeprom[BlockNum * FLASH_BLOCK_SIZE];
+  } else {
+    if (BlockNum >= FLASH_PROG_BLOCKS_NUMBER)
+      return;
+    dst = &Mock_Flash[BlockNum * FLASH_BLOCK_SIZE];
+  }
+
+  ++Mock_FlashWrites;
+
+  // Power loss: the erased block is only partly programmed
+  if (Mock_FlashCut >= 0) {
+    if (Mock_FlashCut < n)
+      n = Mock_FlashCut;
+    Mock_FlashCut = -1;
+    if (FLASH_ProgMode == FLASH_PROGRAMMODE_STANDARD)
+      memset(dst, 0, FLASH_BLOCK_SIZE);
+  }
+
+  memcpy(dst, Buffer, (size_t)n);
+}
+
+void FLASH_EraseBlock(uint16_t BlockNum, FLASH_MemType_TypeDef FLASH_MemType)
+{
+  if (FLASH_MemType == FLASH_MEMTYPE_DATA && BlockNum < FLASH_DATA_BLOCKS_NUMBER)
+    memset(&Mock_Eeprom[BlockNum * FLASH_BLOCK_SIZE], 0, FLASH_BLOCK_SIZE);
+  else if (BlockNum < FLASH_PROG_BLOCKS_NUMBER)
+    memset(&Mock_Flash[BlockNum * FLASH_BLOCK_SIZE], 0, FLASH_BLOCK_SIZE);
+}
+
+uint8_t FLASH_WaitForLastOperation(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  (void)FLASH_MemType;
+  return FLASH_STATUS_SUCCESSFUL_OPERATION;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file mock.h
+ * @brief Test controls of the host SPL stand-in (stm8s.h, mock.c)
+ */
+
+#ifndef __MOCK_H
+#define __MOCK_H
+
+#include "stm8s.h"
+#include "interrupt.h"
+
+// Program flash behind FLASH_ProgramBlock(FLASH_MEMTYPE_PROG)
+extern uint8_t Mock_Flash[FLASH_PROG_BLOCKS_NUMBER * FLASH_BLOCK_SIZE];
+
+// Power loss on the next block program: only this many bytes are written
+// (the rest of the block stays erased); -1 for none
+extern int Mock_FlashCut;
+
+// Number of block programs so far
+extern unsigned Mock_FlashWrites;
+
+// Condition code register (I1/I0 = 0x28 while interrupts are masked)
+extern uint8_t Mock_CC;
+
+// Software priority per ITC_IRQ_xxx, EXTI sensitivity per port
+extern uint8_t Mock_Priority[32];
+extern uint8_t Mock_ExtiSens[5];
+
+// Called after GPIO_Init/WriteHigh/WriteLow changed a port, may be NULL
+extern void (*Mock_GpioHook)(GPIO_TypeDef *port);
+
+// Input of ADC1_StartConversion, which then completes at once (DR, EOC);
+// may be NULL
+extern uint16_t (*Mock_AdcInput)(uint8_t ch);
+
+// Called on every register access through TIM1 / TIM2, e.g. to let simulated
+// time pass while a driver polls the counter; may be NULL. Use Mock_TIM1 /
+// Mock_TIM2 inside.
+extern void (*Mock_Tim1Hook)(void);
+extern void (*Mock_Tim2Hook)(void);
+
+// Registers to their reset values, handlers unregistered
+void Mock_Reset(void);
+
+// Master clock selected by the CLK registers
+uint32_t Mock_MasterClock(void);
+
+// Call the handler registered for an interrupt source
+void Mock_Irq(IRQ_IDX idx);
+
+// Handler registered for an interrupt source, NULL if none
+IRQ_Handler Mock_Handler(IRQ_IDX idx);
+
+#endif // __MOCK_H
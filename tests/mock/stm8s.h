@@ -0,0 +1,467 @@
+/**
+ * @file stm8s.h
+ * @brief Host stand-in for the STM8S standard peripheral library
+ *
+ * This file lets the drivers build on a development PC for the host tests.
+ * Peripheral registers are plain RAM that the tests read and write to model
+ * the hardware; the SPL functions the drivers call are implemented in
+ * mock.c with the register effects of the real library.
+ *
+ * Data registers (SPI, I2C, UART1) are 16 bits wide here. A test loads them
+ * with a value above 0xFF before calling an interrupt handler: the driver
+ * still reads the low byte, and a value of 0xFF or less afterwards means the
+ * driver wrote the register.
+ *
+ * STM8 compilers do not pad structures. Packing is switched on here and left
+ * on for the driver headers that follow, so records that must fill a flash
+ * block have their target size; include the C library headers first.
+ */
+
+#ifndef __STM8S_H
+#define __STM8S_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#pragma pack(1)
+
+#define STM8S003
+
+typedef enum { FALSE = 0, TRUE = !FALSE } bool_t;
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus, BitStatus;
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+typedef enum { ERROR = 0, SUCCESS = !ERROR } ErrorStatus;
+
+#define __IO volatile
+
+/* Registers -------------------------------------------------------------- */
+
+typedef struct {
+  __IO uint8_t ODR, IDR, DDR, CR1, CR2;
+} GPIO_TypeDef;
+
+typedef struct {
+  __IO uint8_t CR1, CR2, SMCR, ETR, IER, SR1, SR2, EGR;
+  __IO uint8_t CCMR1, CCMR2, CCMR3, CCMR4, CCER1, CCER2;
+  __IO uint8_t CNTRH, CNTRL, PSCRH, PSCRL, ARRH, ARRL, RCR;
+  __IO uint8_t CCR1H, CCR1L, CCR2H, CCR2L, CCR3H, CCR3L, CCR4H, CCR4L;
+  __IO uint8_t BKR, DTR, OISR;
+} TIM1_TypeDef;
+
+typedef struct {
+  __IO uint8_t CR1, IER, SR1, SR2, EGR, CCMR1, CCMR2, CCMR3, CCER1, CCER2;
+  __IO uint8_t CNTRH, CNTRL, PSCR, ARRH, ARRL;
+  __IO uint8_t CCR1H, CCR1L, CCR2H, CCR2L, CCR3H, CCR3L;
+} TIM2_TypeDef;
+
+typedef struct {
+  __IO uint8_t CR1, IER, SR1, EGR, CNTR, PSCR, ARR;
+} TIM4_TypeDef;
+
+typedef struct {
+  __IO uint8_t CR1, CR2, ICR, SR;
+  __IO uint16_t DR;
+  __IO uint8_t CRCPR, RXCRCR, TXCRCR;
+} SPI_TypeDef;
+
+typedef struct {
+  __IO uint8_t CR1, CR2, FREQR, OARL, OARH;
+  __IO uint16_t DR;
+  __IO uint8_t SR1, SR2, SR3, ITR, CCRL, CCRH, TRISER, PECR;
+} I2C_TypeDef;
+
+typedef struct {
+  __IO uint8_t SR;
+  __IO uint16_t DR;
+  __IO uint8_t BRR1, BRR2, CR1, CR2, CR3, CR4, CR5, GTR, PSCR;
+} UART1_TypeDef;
+
+typedef struct {
+  __IO uint8_t CSR, CR1, CR2, CR3, DRH, DRL, TDRH, TDRL;
+} ADC1_TypeDef;
+
+typedef struct {
+  __IO uint8_t ICKR, ECKR, CMSR, SWR, SWCR, CKDIVR, PCKENR1, CSSR, CCOR, PCKENR2;
+} CLK_TypeDef;
+
+extern GPIO_TypeDef Mock_GPIOA, Mock_GPIOB, Mock_GPIOC, Mock_GPIOD, Mock_GPIOE;
+extern TIM1_TypeDef Mock_TIM1;
+extern TIM2_TypeDef Mock_TIM2;
+extern TIM4_TypeDef Mock_TIM4;
+extern SPI_TypeDef Mock_SPI;
+extern I2C_TypeDef Mock_I2C;
+extern UART1_TypeDef Mock_UART1;
+extern ADC1_TypeDef Mock_ADC1;
+extern CLK_TypeDef Mock_CLK;
+
+// TIM1 and TIM2 go through functions so tests can hook their accesses (mock.h)
+TIM1_TypeDef *Mock_Tim1(void);
+TIM2_TypeDef *Mock_Tim2(void);
+
+#define GPIOA   (&Mock_GPIOA)
+#define GPIOB   (&Mock_GPIOB)
+#define GPIOC   (&Mock_GPIOC)
+#define GPIOD   (&Mock_GPIOD)
+#define GPIOE   (&Mock_GPIOE)
+#define TIM1    (Mock_Tim1())
+#define TIM2    (Mock_Tim2())
+#define TIM4    (&Mock_TIM4)
+#define SPI     (&Mock_SPI)
+#define I2C     (&Mock_I2C)
+#define UART1   (&Mock_UART1)
+#define ADC1    (&Mock_ADC1)
+#define CLK     (&Mock_CLK)
+
+/* Register bits ---------------------------------------------------------- */
+
+#define TIM1_CR1_CEN        0x01
+#define TIM1_CR1_ARPE       0x80
+#define TIM1_IER_UIE        0x01
+#define TIM1_IER_CC1IE      0x02
+#define TIM1_IER_CC2IE      0x04
+#define TIM1_SR1_UIF        0x01
+#define TIM1_SR1_CC1IF      0x02
+#define TIM1_SR1_CC2IF      0x04
+
+#define TIM2_CR1_CEN        0x01
+#define TIM2_CR1_ARPE       0x80
+#define TIM2_IER_UIE        0x01
+#define TIM2_IER_CC1IE      0x02
+#define TIM2_SR1_UIF        0x01
+#define TIM2_SR1_CC1IF      0x02
+
+#define TIM4_CR1_CEN        0x01
+#define TIM4_IER_UIE        0x01
+#define TIM4_SR1_UIF        0x01
+
+#define SPI_CR1_SPE         0x40
+#define SPI_ICR_TXEI        0x80
+#define SPI_ICR_RXEI        0x40
+#define SPI_ICR_ERRIE       0x20
+#define SPI_SR_BSY          0x80
+#define SPI_SR_OVR          0x40
+#define SPI_SR_MODF         0x20
+#define SPI_SR_TXE          0x02
+#define SPI_SR_RXNE         0x01
+
+#define I2C_CR1_PE          0x01
+#define I2C_CR2_SWRST       0x80
+#define I2C_CR2_ACK         0x04
+#define I2C_CR2_STOP        0x02
+#define I2C_CR2_START       0x01
+#define I2C_SR1_TXE         0x80
+#define I2C_SR1_RXNE        0x40
+#define I2C_SR1_STOPF       0x10
+#define I2C_SR1_BTF         0x04
+#define I2C_SR1_ADDR        0x02
+#define I2C_SR1_SB          0x01
+#define I2C_SR2_OVR         0x08
+#define I2C_SR2_AF          0x04
+#define I2C_SR2_ARLO        0x02
+#define I2C_SR2_BERR        0x01
+#define I2C_SR3_TRA         0x04
+#define I2C_SR3_BUSY        0x02
+#define I2C_SR3_MSL         0x01
+#define I2C_ITR_ITBUFEN     0x04
+#define I2C_ITR_ITEVTEN     0x02
+#define I2C_ITR_ITERREN     0x01
+
+#define UART1_SR_TXE        0x80
+#define UART1_SR_TC         0x40
+#define UART1_SR_RXNE       0x20
+#define UART1_SR_IDLE       0x10
+#define UART1_SR_OR         0x08
+#define UART1_SR_NF         0x04
+#define UART1_SR_FE         0x02
+#define UART1_SR_PE         0x01
+
+#define ADC1_CSR_EOC        0x80
+#define ADC1_CSR_EOCIE      0x20
+#define ADC1_CR1_ADON       0x01
+
+/* Memory ----------------------------------------------------------------- */
+
+#define FLASH_BLOCK_SIZE                    64
+#define FLASH_PROG_BLOCKS_NUMBER            128
+#define FLASH_DATA_BLOCKS_NUMBER            10
+#define FLASH_PROG_START_PHYSICAL_ADDRESS   0x8000
+#define FLASH_PROG_END_PHYSICAL_ADDRESS     0x9FFF
+#define FLASH_DATA_END_PHYSICAL_ADDRESS     0x427F
+
+// Data EEPROM as host memory, so drivers can read it through pointers
+extern uint8_t Mock_Eeprom[FLASH_DATA_BLOCKS_NUMBER * FLASH_BLOCK_SIZE];
+#define FLASH_DATA_START_PHYSICAL_ADDRESS   ((uintptr_t)Mock_Eeprom)
+
+/* Core ------------------------------------------------------------------- */
+
+void Mock_EnableInterrupts(void);
+void Mock_DisableInterrupts(void);
+
+#define enableInterrupts()  Mock_EnableInterrupts()
+#define disableInterrupts() Mock_DisableInterrupts()
+#define nop()               ((void)0)
+#define INTERRUPT_HANDLER(a, b) void a(void)
+
+/* CLK -------------------------------------------------------------------- */
+
+typedef enum {
+  CLK_PRESCALER_HSIDIV1 = 0x00, CLK_PRESCALER_HSIDIV2 = 0x08,
+  CLK_PRESCALER_HSIDIV4 = 0x10, CLK_PRESCALER_HSIDIV8 = 0x18,
+  CLK_PRESCALER_CPUDIV1 = 0x80, CLK_PRESCALER_CPUDIV2 = 0x81,
+  CLK_PRESCALER_CPUDIV4 = 0x82, CLK_PRESCALER_CPUDIV8 = 0x83,
+  CLK_PRESCALER_CPUDIV16 = 0x84, CLK_PRESCALER_CPUDIV32 = 0x85,
+  CLK_PRESCALER_CPUDIV64 = 0x86, CLK_PRESCALER_CPUDIV128 = 0x87
+} CLK_Prescaler_TypeDef;
+
+typedef enum {
+  CLK_PERIPHERAL_I2C = 0x00, CLK_PERIPHERAL_SPI = 0x01,
+  CLK_PERIPHERAL_UART1 = 0x02, CLK_PERIPHERAL_TIMER4 = 0x04,
+  CLK_PERIPHERAL_TIMER2 = 0x05, CLK_PERIPHERAL_TIMER1 = 0x07,
+  CLK_PERIPHERAL_ADC = 0x13
+} CLK_Peripheral_TypeDef;
+
+void CLK_DeInit(void);
+void CLK_HSIPrescalerConfig(CLK_Prescaler_TypeDef HSIPrescaler);
+void CLK_SYSCLKConfig(CLK_Prescaler_TypeDef CLK_Prescaler);
+void CLK_PeripheralClockConfig(CLK_Peripheral_TypeDef CLK_Peripheral, FunctionalState NewState);
+
+/* GPIO ------------------------------------------------------------------- */
+
+typedef enum {
+  GPIO_PIN_0 = 0x01, GPIO_PIN_1 = 0x02, GPIO_PIN_2 = 0x04, GPIO_PIN_3 = 0x08,
+  GPIO_PIN_4 = 0x10, GPIO_PIN_5 = 0x20, GPIO_PIN_6 = 0x40, GPIO_PIN_7 = 0x80
+} GPIO_Pin_TypeDef;
+
+typedef enum {
+  GPIO_MODE_IN_FL_NO_IT = 0x00, GPIO_MODE_IN_PU_NO_IT = 0x40,
+  GPIO_MODE_IN_FL_IT = 0x20, GPIO_MODE_IN_PU_IT = 0x60,
+  GPIO_MODE_OUT_OD_LOW_FAST = 0xA0, GPIO_MODE_OUT_PP_LOW_FAST = 0xE0,
+  GPIO_MODE_OUT_OD_LOW_SLOW = 0x80, GPIO_MODE_OUT_PP_LOW_SLOW = 0xC0,
+  GPIO_MODE_OUT_OD_HIZ_FAST = 0xB0, GPIO_MODE_OUT_PP_HIGH_FAST = 0xF0,
+  GPIO_MODE_OUT_OD_HIZ_SLOW = 0x90, GPIO_MODE_OUT_PP_HIGH_SLOW = 0xD0
+} GPIO_Mode_TypeDef;
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef GPIO_Pin, GPIO_Mode_TypeDef GPIO_Mode);
+void GPIO_WriteHigh(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef PortPins);
+void GPIO_WriteLow(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef PortPins);
+BitStatus GPIO_ReadInputPin(GPIO_TypeDef *GPIOx, GPIO_Pin_TypeDef GPIO_Pin);
+
+/* ITC / EXTI ------------------------------------------------------------- */
+
+typedef enum {
+  ITC_IRQ_PORTA = 3, ITC_IRQ_PORTB = 4, ITC_IRQ_PORTC = 5, ITC_IRQ_PORTD = 6,
+  ITC_IRQ_PORTE = 7, ITC_IRQ_SPI = 10, ITC_IRQ_TIM1_OVF = 11,
+  ITC_IRQ_TIM1_CAPCOM = 12, ITC_IRQ_TIM2_OVF = 13, ITC_IRQ_TIM2_CAPCOM = 14,
+  ITC_IRQ_UART1_TX = 17, ITC_IRQ_UART1_RX = 18, ITC_IRQ_I2C = 19,
+  ITC_IRQ_ADC1 = 22, ITC_IRQ_TIM4_OVF = 23
+} ITC_Irq_TypeDef;
+
+typedef enum {
+  ITC_PRIORITYLEVEL_0 = 0x02, ITC_PRIORITYLEVEL_1 = 0x01,
+  ITC_PRIORITYLEVEL_2 = 0x00, ITC_PRIORITYLEVEL_3 = 0x03
+} ITC_PriorityLevel_TypeDef;
+
+typedef enum {
+  EXTI_PORT_GPIOA = 0, EXTI_PORT_GPIOB, EXTI_PORT_GPIOC, EXTI_PORT_GPIOD,
+  EXTI_PORT_GPIOE
+} EXTI_Port_TypeDef;
+
+typedef enum {
+  EXTI_SENSITIVITY_FALL_LOW = 0, EXTI_SENSITIVITY_RISE_ONLY = 1,
+  EXTI_SENSITIVITY_FALL_ONLY = 2, EXTI_SENSITIVITY_RISE_FALL = 3
+} EXTI_Sensitivity_TypeDef;
+
+uint8_t ITC_GetCPUCC(void);
+void ITC_SetSoftwarePriority(ITC_Irq_TypeDef IrqNum, ITC_PriorityLevel_TypeDef PriorityValue);
+void EXTI_SetExtIntSensitivity(EXTI_Port_TypeDef Port, EXTI_Sensitivity_TypeDef SensitivityValue);
+
+/* TIM1 ------------------------------------------------------------------- */
+
+typedef enum { TIM1_COUNTERMODE_UP = 0x00 } TIM1_CounterMode_TypeDef;
+typedef enum { TIM1_PSCRELOADMODE_UPDATE = 0, TIM1_PSCRELOADMODE_IMMEDIATE = 1 } TIM1_PSCReloadMode_TypeDef;
+typedef enum { TIM1_OCMODE_TIMING = 0x00, TIM1_OCMODE_PWM1 = 0x60 } TIM1_OCMode_TypeDef;
+typedef enum { TIM1_OUTPUTSTATE_DISABLE = 0x00, TIM1_OUTPUTSTATE_ENABLE = 0x11 } TIM1_OutputState_TypeDef;
+typedef enum { TIM1_OUTPUTNSTATE_DISABLE = 0x00, TIM1_OUTPUTNSTATE_ENABLE = 0x44 } TIM1_OutputNState_TypeDef;
+typedef enum { TIM1_OCPOLARITY_HIGH = 0x00, TIM1_OCPOLARITY_LOW = 0x22 } TIM1_OCPolarity_TypeDef;
+typedef enum { TIM1_OCNPOLARITY_HIGH = 0x00, TIM1_OCNPOLARITY_LOW = 0x88 } TIM1_OCNPolarity_TypeDef;
+typedef enum { TIM1_OCIDLESTATE_RESET = 0x00, TIM1_OCIDLESTATE_SET = 0x55 } TIM1_OCIdleState_TypeDef;
+typedef enum { TIM1_OCNIDLESTATE_RESET = 0x00, TIM1_OCNIDLESTATE_SET = 0x2A } TIM1_OCNIdleState_TypeDef;
+typedef enum { TIM1_IT_UPDATE = 0x01, TIM1_IT_CC1 = 0x02, TIM1_IT_CC2 = 0x04 } TIM1_IT_TypeDef;
+typedef enum { TIM1_TRGOSOURCE_RESET = 0x00, TIM1_TRGOSOURCE_UPDATE = 0x20 } TIM1_TRGOSource_TypeDef;
+
+void TIM1_TimeBaseInit(uint16_t TIM1_Prescaler, TIM1_CounterMode_TypeDef TIM1_CounterMode,
+                       uint16_t TIM1_Period, uint8_t TIM1_RepetitionCounter);
+void TIM1_Cmd(FunctionalState NewState);
+void TIM1_PrescalerConfig(uint16_t Prescaler, TIM1_PSCReloadMode_TypeDef TIM1_PSCReloadMode);
+void TIM1_SetAutoreload(uint16_t Autoreload);
+void TIM1_SetCounter(uint16_t Counter);
+uint16_t TIM1_GetCounter(void);
+void TIM1_ARRPreloadConfig(FunctionalState NewState);
+void TIM1_ITConfig(TIM1_IT_TypeDef TIM1_IT, FunctionalState NewState);
+void TIM1_ClearITPendingBit(TIM1_IT_TypeDef TIM1_IT);
+void TIM1_OC1Init(TIM1_OCMode_TypeDef TIM1_OCMode, TIM1_OutputState_TypeDef TIM1_OutputState,
+                  TIM1_OutputNState_TypeDef TIM1_OutputNState, uint16_t TIM1_Pulse,
+                  TIM1_OCPolarity_TypeDef TIM1_OCPolarity, TIM1_OCNPolarity_TypeDef TIM1_OCNPolarity,
+                  TIM1_OCIdleState_TypeDef TIM1_OCIdleState, TIM1_OCNIdleState_TypeDef TIM1_OCNIdleState);
+void TIM1_OC2Init(TIM1_OCMode_TypeDef TIM1_OCMode, TIM1_OutputState_TypeDef TIM1_OutputState,
+                  TIM1_OutputNState_TypeDef TIM1_OutputNState, uint16_t TIM1_Pulse,
+                  TIM1_OCPolarity_TypeDef TIM1_OCPolarity, TIM1_OCNPolarity_TypeDef TIM1_OCNPolarity,
+                  TIM1_OCIdleState_TypeDef TIM1_OCIdleState, TIM1_OCNIdleState_TypeDef TIM1_OCNIdleState);
+void TIM1_OC1PreloadConfig(FunctionalState NewState);
+void TIM1_OC2PreloadConfig(FunctionalState NewState);
+void TIM1_SelectOutputTrigger(TIM1_TRGOSource_TypeDef TIM1_TRGOSource);
+
+/* TIM2 ------------------------------------------------------------------- */
+
+typedef enum {
+  TIM2_PRESCALER_1 = 0, TIM2_PRESCALER_2, TIM2_PRESCALER_4, TIM2_PRESCALER_8,
+  TIM2_PRESCALER_16, TIM2_PRESCALER_32, TIM2_PRESCALER_64, TIM2_PRESCALER_128,
+  TIM2_PRESCALER_256, TIM2_PRESCALER_512, TIM2_PRESCALER_1024, TIM2_PRESCALER_2048,
+  TIM2_PRESCALER_4096, TIM2_PRESCALER_8192, TIM2_PRESCALER_16384, TIM2_PRESCALER_32768
+} TIM2_Prescaler_TypeDef;
+typedef enum { TIM2_PSCRELOADMODE_UPDATE = 0, TIM2_PSCRELOADMODE_IMMEDIATE = 1 } TIM2_PSCReloadMode_TypeDef;
+typedef enum { TIM2_OCMODE_TIMING = 0x00, TIM2_OCMODE_PWM1 = 0x60 } TIM2_OCMode_TypeDef;
+typedef enum { TIM2_OUTPUTSTATE_DISABLE = 0x00, TIM2_OUTPUTSTATE_ENABLE = 0x11 } TIM2_OutputState_TypeDef;
+typedef enum { TIM2_OCPOLARITY_HIGH = 0x00, TIM2_OCPOLARITY_LOW = 0x22 } TIM2_OCPolarity_TypeDef;
+typedef enum { TIM2_IT_UPDATE = 0x01, TIM2_IT_CC1 = 0x02 } TIM2_IT_TypeDef;
+
+void TIM2_TimeBaseInit(TIM2_Prescaler_TypeDef TIM2_Prescaler, uint16_t TIM2_Period);
+void TIM2_Cmd(FunctionalState NewState);
+void TIM2_PrescalerConfig(TIM2_Prescaler_TypeDef Prescaler, TIM2_PSCReloadMode_TypeDef TIM2_PSCReloadMode);
+void TIM2_SetAutoreload(uint16_t Autoreload);
+void TIM2_SetCounter(uint16_t Counter);
+uint16_t TIM2_GetCounter(void);
+void TIM2_ARRPreloadConfig(FunctionalState NewState);
+void TIM2_ITConfig(TIM2_IT_TypeDef TIM2_IT, FunctionalState NewState);
+void TIM2_ClearITPendingBit(TIM2_IT_TypeDef TIM2_IT);
+void TIM2_OC1Init(TIM2_OCMode_TypeDef TIM2_OCMode, TIM2_OutputState_TypeDef TIM2_OutputState,
+                  uint16_t TIM2_Pulse, TIM2_OCPolarity_TypeDef TIM2_OCPolarity);
+void TIM2_OC2Init(TIM2_OCMode_TypeDef TIM2_OCMode, TIM2_OutputState_TypeDef TIM2_OutputState,
+                  uint16_t TIM2_Pulse, TIM2_OCPolarity_TypeDef TIM2_OCPolarity);
+void TIM2_OC3Init(TIM2_OCMode_TypeDef TIM2_OCMode, TIM2_OutputState_TypeDef TIM2_OutputState,
+                  uint16_t TIM2_Pulse, TIM2_OCPolarity_TypeDef TIM2_OCPolarity);
+void TIM2_OC1PreloadConfig(FunctionalState NewState);
+void TIM2_OC2PreloadConfig(FunctionalState NewState);
+void TIM2_OC3PreloadConfig(FunctionalState NewState);
+
+/* TIM4 ------------------------------------------------------------------- */
+
+typedef enum {
+  TIM4_PRESCALER_1 = 0, TIM4_PRESCALER_2, TIM4_PRESCALER_4, TIM4_PRESCALER_8,
+  TIM4_PRESCALER_16, TIM4_PRESCALER_32, TIM4_PRESCALER_64, TIM4_PRESCALER_128
+} TIM4_Prescaler_TypeDef;
+typedef enum { TIM4_FLAG_UPDATE = 0x01 } TIM4_FLAG_TypeDef;
+typedef enum { TIM4_IT_UPDATE = 0x01 } TIM4_IT_TypeDef;
+
+void TIM4_DeInit(void);
+void TIM4_TimeBaseInit(TIM4_Prescaler_TypeDef TIM4_Prescaler, uint8_t TIM4_Period);
+void TIM4_Cmd(FunctionalState NewState);
+void TIM4_ITConfig(TIM4_IT_TypeDef TIM4_IT, FunctionalState NewState);
+void TIM4_ClearFlag(TIM4_FLAG_TypeDef TIM4_FLAG);
+
+/* SPI -------------------------------------------------------------------- */
+
+typedef enum { SPI_FIRSTBIT_MSB = 0x00, SPI_FIRSTBIT_LSB = 0x80 } SPI_FirstBit_TypeDef;
+typedef enum {
+  SPI_BAUDRATEPRESCALER_2 = 0x00, SPI_BAUDRATEPRESCALER_4 = 0x08,
+  SPI_BAUDRATEPRESCALER_8 = 0x10, SPI_BAUDRATEPRESCALER_16 = 0x18,
+  SPI_BAUDRATEPRESCALER_32 = 0x20, SPI_BAUDRATEPRESCALER_64 = 0x28,
+  SPI_BAUDRATEPRESCALER_128 = 0x30, SPI_BAUDRATEPRESCALER_256 = 0x38
+} SPI_BaudRatePrescaler_TypeDef;
+typedef enum { SPI_MODE_MASTER = 0x04, SPI_MODE_SLAVE = 0x00 } SPI_Mode_TypeDef;
+typedef enum { SPI_CLOCKPOLARITY_LOW = 0x00, SPI_CLOCKPOLARITY_HIGH = 0x02 } SPI_ClockPolarity_TypeDef;
+typedef enum { SPI_CLOCKPHASE_1EDGE = 0x00, SPI_CLOCKPHASE_2EDGE = 0x01 } SPI_ClockPhase_TypeDef;
+typedef enum { SPI_DATADIRECTION_2LINES_FULLDUPLEX = 0x00 } SPI_DataDirection_TypeDef;
+typedef enum { SPI_NSS_SOFT = 0x02, SPI_NSS_HARD = 0x00 } SPI_NSS_TypeDef;
+
+void SPI_DeInit(void);
+void SPI_Init(SPI_FirstBit_TypeDef FirstBit, SPI_BaudRatePrescaler_TypeDef BaudRatePrescaler,
+              SPI_Mode_TypeDef Mode, SPI_ClockPolarity_TypeDef ClockPolarity,
+              SPI_ClockPhase_TypeDef ClockPhase, SPI_DataDirection_TypeDef Data_Direction,
+              SPI_NSS_TypeDef Slave_Management, uint8_t CRCPolynomial);
+void SPI_Cmd(FunctionalState NewState);
+void SPI_NSSInternalSoftwareCmd(FunctionalState NewState);
+
+/* I2C -------------------------------------------------------------------- */
+
+typedef enum { I2C_DUTYCYCLE_2 = 0x00, I2C_DUTYCYCLE_16_9 = 0x40 } I2C_DutyCycle_TypeDef;
+typedef enum { I2C_ACK_NONE = 0, I2C_ACK_CURR = 1, I2C_ACK_NEXT = 2 } I2C_Ack_TypeDef;
+typedef enum { I2C_ADDMODE_7BIT = 0x00, I2C_ADDMODE_10BIT = 0x80 } I2C_AddMode_TypeDef;
+
+void I2C_DeInit(void);
+void I2C_Init(uint32_t OutputClockFrequencyHz, uint16_t OwnAddress,
+              I2C_DutyCycle_TypeDef I2C_DutyCycle, I2C_Ack_TypeDef Ack,
+              I2C_AddMode_TypeDef AddMode, uint8_t InputClockFrequencyMHz);
+void I2C_Cmd(FunctionalState NewState);
+
+/* UART1 ------------------------------------------------------------------ */
+
+typedef enum { UART1_WORDLENGTH_8D = 0x00 } UART1_WordLength_TypeDef;
+typedef enum { UART1_STOPBITS_1 = 0x00 } UART1_StopBits_TypeDef;
+typedef enum { UART1_PARITY_NO = 0x00 } UART1_Parity_TypeDef;
+typedef enum { UART1_SYNCMODE_CLOCK_DISABLE = 0x80 } UART1_SyncMode_TypeDef;
+typedef enum { UART1_MODE_TXRX_ENABLE = 0x0C } UART1_Mode_TypeDef;
+typedef enum {
+  UART1_FLAG_TXE = 0x80, UART1_FLAG_TC = 0x40, UART1_FLAG_RXNE = 0x20,
+  UART1_FLAG_OR = 0x08, UART1_FLAG_NF = 0x04, UART1_FLAG_FE = 0x02,
+  UART1_FLAG_PE = 0x01
+} UART1_Flag_TypeDef;
+
+void UART1_DeInit(void);
+void UART1_Init(uint32_t BaudRate, UART1_WordLength_TypeDef WordLength,
+                UART1_StopBits_TypeDef StopBits, UART1_Parity_TypeDef Parity,
+                UART1_SyncMode_TypeDef SyncMode, UART1_Mode_TypeDef Mode);
+void UART1_Cmd(FunctionalState NewState);
+FlagStatus UART1_GetFlagStatus(UART1_Flag_TypeDef UART1_FLAG);
+void UART1_SendData8(uint8_t Data);
+uint8_t UART1_ReceiveData8(void);
+
+/* ADC1 ------------------------------------------------------------------- */
+
+typedef enum { ADC1_CONVERSIONMODE_SINGLE = 0x00, ADC1_CONVERSIONMODE_CONTINUOUS = 0x01 } ADC1_ConvMode_TypeDef;
+typedef enum {
+  ADC1_CHANNEL_0 = 0, ADC1_CHANNEL_1, ADC1_CHANNEL_2, ADC1_CHANNEL_3,
+  ADC1_CHANNEL_4, ADC1_CHANNEL_5, ADC1_CHANNEL_6, ADC1_CHANNEL_7
+} ADC1_Channel_TypeDef;
+typedef enum { ADC1_PRESSEL_FCPU_D2 = 0x00, ADC1_PRESSEL_FCPU_D8 = 0x40, ADC1_PRESSEL_FCPU_D18 = 0x70 } ADC1_PresSel_TypeDef;
+typedef enum { ADC1_EXTTRIG_TIM = 0x00, ADC1_EXTTRIG_GPIO = 0x10 } ADC1_ExtTrig_TypeDef;
+typedef enum { ADC1_ALIGN_LEFT = 0x00, ADC1_ALIGN_RIGHT = 0x08 } ADC1_Align_TypeDef;
+typedef enum {
+  ADC1_SCHMITTTRIG_CHANNEL0 = 0, ADC1_SCHMITTTRIG_CHANNEL2 = 2,
+  ADC1_SCHMITTTRIG_CHANNEL6 = 6, ADC1_SCHMITTTRIG_ALL = 0x1F
+} ADC1_SchmittTrigg_TypeDef;
+typedef enum { ADC1_FLAG_EOC = 0x80 } ADC1_Flag_TypeDef;
+typedef enum { ADC1_IT_EOCIE = 0x20 } ADC1_IT_TypeDef;
+
+void ADC1_DeInit(void);
+void ADC1_Init(ADC1_ConvMode_TypeDef ADC1_ConversionMode, ADC1_Channel_TypeDef ADC1_Channel,
+               ADC1_PresSel_TypeDef ADC1_PrescalerSelection, ADC1_ExtTrig_TypeDef ADC1_ExtTrigger,
+               FunctionalState ADC1_ExtTriggerState, ADC1_Align_TypeDef ADC1_Align,
+               ADC1_SchmittTrigg_TypeDef ADC1_SchmittTriggerChannel,
+               FunctionalState ADC1_SchmittTriggerState);
+void ADC1_Cmd(FunctionalState NewState);
+void ADC1_ITConfig(ADC1_IT_TypeDef ADC1_IT, FunctionalState NewState);
+void ADC1_ConversionConfig(ADC1_ConvMode_TypeDef ADC1_ConversionMode,
+                           ADC1_Channel_TypeDef ADC1_Channel, ADC1_Align_TypeDef ADC1_Align);
+void ADC1_StartConversion(void);
+uint16_t ADC1_GetConversionValue(void);
+FlagStatus ADC1_GetFlagStatus(ADC1_Flag_TypeDef Flag);
+void ADC1_ClearFlag(ADC1_Flag_TypeDef Flag);
+
+/* FLASH ------------------------------------------------------------------ */
+
+typedef enum { FLASH_MEMTYPE_PROG = 0xFD, FLASH_MEMTYPE_DATA = 0xF7 } FLASH_MemType_TypeDef;
+typedef enum { FLASH_PROGRAMMODE_STANDARD = 0x00, FLASH_PROGRAMMODE_FAST = 0x10 } FLASH_ProgramMode_TypeDef;
+typedef enum {
+  FLASH_STATUS_END_HIGH_VOLTAGE = 0x40, FLASH_STATUS_SUCCESSFUL_OPERATION = 0x04,
+  FLASH_STATUS_TIMEOUT = 0x02, FLASH_STATUS_WRITE_PROTECTION_ERROR = 0x01
+} FLASH_Status_TypeDef;
+
+void FLASH_Unlock(FLASH_MemType_TypeDef FLASH_MemType);
+void FLASH_Lock(FLASH_MemType_TypeDef FLASH_MemType);
+void FLASH_ProgramBlock(uint16_t BlockNum, FLASH_MemType_TypeDef FLASH_MemType,
+                        FLASH_ProgramMode_TypeDef FLASH_ProgMode, uint8_t *Buffer);
+void FLASH_EraseBlock(uint16_t BlockNum, FLASH_MemType_TypeDef FLASH_MemType);
+uint8_t FLASH_WaitForLastOperation(FLASH_MemType_TypeDef FLASH_MemType);
+
+#endif // __STM8S_H
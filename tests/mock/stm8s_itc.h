@@ -0,0 +1,11 @@
+/**
+ * @file stm8s_itc.h
+ * @brief Host stand-in for the STM8S ITC header, see stm8s.h
+ */
+
+#ifndef __STM8S_ITC_H
+#define __STM8S_ITC_H
+
+#include "stm8s.h"
+
+#endif // __STM8S_ITC_H
@@ -0,0 +1,222 @@
+/**
+ * @file motion_test.c
+ * @brief Host simulation of the stepper pulse timing against the ideal ramp
+ *
+ * TIM2 is modelled as a 16-bit counter at MOT_TICK_HZ running from compare
+ * match to compare match. On a match the ISR runs after a configurable
+ * latency, i.e. with the counter that much further on, and the match time
+ * is recorded as the step time. Step intervals are compared with the ideal
+ * constant-acceleration profile v = min(vmax, sqrt(2 a s), sqrt(2 a (n - s))),
+ * and with an ISR slower than the step period the steps must keep coming
+ * instead of waiting for the counter to wrap.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Imotion -Itimer -Igpio -Isystem -Iinterrupt -Iqueue tests/motion_test.c \
+ *      motion/motion.c timer/timer.c gpio/io.c system/system.c tests/mock/mock.c -lm \
+ *      -o motion_test && ./motion_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "system.h"
+#include "motion.h"
+
+#define MAX_STEPS   20000
+
+IO_PIN _ios[IO_IDX_MAX] = {
+    [IOP_STEP] = { GPIOD, GPIO_PIN_2 },
+    [IOP_DIR]  = { GPIOD, GPIO_PIN_3 },
+};
+
+static unsigned long long _now;             // Simulated time, ticks
+static unsigned _latency;                   // Compare match to ISR, ticks
+static unsigned long long _t[MAX_STEPS + 1];    // Step times, ticks
+static unsigned _steps;
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/**
+ * @brief Load the simulated time into the TIM2 counter
+ */
+static void SetCounter(void)
+{
+    TIM2->CNTRH = (uint8_t)(_now >> 8);
+    TIM2->CNTRL = (uint8_t)_now;
+}
+
+/**
+ * @brief Run the timer until the motor is idle, recording the step times
+ *
+ * @return unsigned long long Longest interval between two steps, ticks
+ */
+static unsigned long long Run(void)
+{
+    unsigned long long gap = 0, last = 0;
+    uint16_t ccr, d;
+    int32_t pos;
+
+    _steps = 0;
+    while (MOT_Busy() && (TIM2->IER & TIM2_IER_CC1IE)) {
+        // Jump to the next compare match; a compare at the counter itself
+        // only matches again after a full wrap
+        ccr = (uint16_t)((TIM2->CCR1H << 8) | TIM2->CCR1L);
+        d = (uint16_t)(ccr - (uint16_t)_now);
+        _now += d ? d : 0x10000;
+
+        if (_steps && _now - last > gap)
+            gap = _now - last;
+        if (_steps <= MAX_STEPS)
+            _t[_steps] = _now;
+
+        _now += _latency;
+        SetCounter();
+        TIM2->SR1 |= TIM2_SR1_CC1IF;
+        pos = MOT_Position();
+        Mock_Irq(IRQ_TIM2_CC);
+        if (MOT_Position() != pos) {
+            last = _now - _latency;
+            ++_steps;
+        }
+    }
+    return gap;
+}
+
+/**
+ * @brief Ideal step speed of a move
+ *
+ * The first step is taken at the first-step speed sqrt(2 a), so the ramp up
+ * is half a step ahead of one from standstill.
+ *
+ * @param i Steps taken before the interval (1 to n - 1)
+ * @return double Speed between steps i and i + 1, steps/s
+ */
+static double Ideal(uint32_t accel, uint16_t speed, uint32_t n, unsigned i)
+{
+    double v = fmin(speed, fmin(sqrt(2.0 * accel * (i - 0.5)), sqrt(2.0 * accel * (n - i))));
+
+    return fmax(v, sqrt(2.0 * accel));
+}
+
+/**
+ * @brief Move from standstill and compare the steps with the ideal ramp
+ *
+ * Speed errors are expressed as the distance along the ramp at which the
+ * ideal profile has that speed, |v^2 - v_ideal^2| / 2a; it may not exceed
+ * one step plus 2 % of the ramp length (the recurrence drifts slowly on long
+ * ramps). The time of every step may not be off the ideal by more than 1 %
+ * of the move time plus two first-step periods for the slow steps at the
+ * ends.
+ *
+ * @param accel Acceleration, steps/s^2
+ * @param speed Cruise speed, steps/s
+ * @param n Steps to move
+ */
+static void Profile(uint32_t accel, uint16_t speed, uint32_t n)
+{
+    double ramp = (double)speed * speed / (2.0 * accel), v, ideal, d, dMax = 0, t = 0, tMax = 0;
+    int32_t start = MOT_Position();
+    unsigned i;
+
+    CHECK(MOT_SetAccel(accel) == MOT_RESULT_OK);
+    CHECK(MOT_SetSpeed(speed) == MOT_RESULT_OK);
+    SetCounter();
+    CHECK(MOT_MoveTo(start + (int32_t)n) == MOT_RESULT_OK);
+    Run();
+    CHECK(_steps == n && MOT_Position() == start + (int32_t)n);
+
+    for (i = 1; i < n; ++i) {
+        ideal = Ideal(accel, speed, n, i);
+        v = (double)MOT_TICK_HZ / (double)(_t[i] - _t[i - 1]);
+        d = fabs(v * v - ideal * ideal) / (2.0 * accel);
+        if (i >= 4 && i + 4 < n && d > dMax)
+            dMax = d;
+
+        t += MOT_TICK_HZ / ideal;
+        if (fabs((double)(_t[i] - _t[0]) - t) > tMax)
+            tMax = fabs((double)(_t[i] - _t[0]) - t);
+    }
+
+    if (dMax > 1 + ramp / 50) {
+        printf("FAIL: a %u v %u n %u: speed %.1f steps along the ramp off\n", accel, speed, n, dMax);
+        ++_failed;
+    }
+    if (tMax > t / 100 + 2 * MOT_TICK_HZ / sqrt(2.0 * accel)) {
+        printf("FAIL: a %u v %u n %u: step %.0f ticks off in %.0f\n", accel, speed, n, tMax, t);
+        ++_failed;
+    }
+}
+
+int main(void)
+{
+    static const struct { uint32_t accel; uint16_t speed; uint32_t n; } moves[] = {
+        { 4000, 1000, 2000 }, { 4000, 1000, 100 }, { 100, 16, 20 },
+        { 20000, 5000, 10000 }, { 100000, MOT_SPEED_MAX, 10000 }, { 100000, MOT_SPEED_MAX, 300 },
+    };
+    static unsigned long long t0[MAX_STEPS + 1];
+    unsigned long long gap;
+    unsigned i, j;
+
+    Mock_Reset();
+    Sys_ClockInit();
+    Sys_TickInit();
+    CHECK(MOT_Init(1) == MOT_RESULT_OK);
+    CHECK(TIM2->PSCR == 4);     // 16 MHz / 2^4 = MOT_TICK_HZ
+
+    // Step intervals follow the ideal profile, with and without latency
+    for (i = 0; i < sizeof(moves) / sizeof(moves[0]); ++i) {
+        _latency = 0;
+        Profile(moves[i].accel, moves[i].speed, moves[i].n);
+        memcpy(t0, _t, sizeof(t0));
+
+        // An ISR well within the step period does not move the steps
+        _latency = 60;
+        Profile(moves[i].accel, moves[i].speed, moves[i].n);
+        for (j = 0; j < moves[i].n && _t[j] - _t[0] == t0[j] - t0[0]; ++j);
+        CHECK(j == moves[i].n);
+    }
+
+    // Back to 0: DIR low
+    _latency = 0;
+    CHECK(MOT_MoveTo(0) == MOT_RESULT_OK);
+    Run();
+    CHECK(MOT_Position() == 0 && !(GPIOD->ODR & GPIO_PIN_3));
+
+    // Queued moves in the same direction keep the cruise speed
+    CHECK(MOT_SetAccel(4000) == MOT_RESULT_OK && MOT_SetSpeed(1000) == MOT_RESULT_OK);
+    CHECK(MOT_MoveTo(1000) == MOT_RESULT_OK && MOT_MoveTo(2000) == MOT_RESULT_OK);
+    Run();
+    CHECK(_steps == 2000 && MOT_Position() == 2000 && (GPIOD->ODR & GPIO_PIN_3));
+    for (i = 990; i < 1010; ++i)
+        CHECK(_t[i] - _t[i - 1] <= MOT_TICK_HZ / 1000 + 1);
+
+    // ISR slower than the 100 us step period at MOT_SPEED_MAX: steps come
+    // at the ISR rate instead of after a counter wrap
+    CHECK(MOT_SetAccel(100000) == MOT_RESULT_OK && MOT_SetSpeed(MOT_SPEED_MAX) == MOT_RESULT_OK);
+    CHECK(MOT_SetPosition(0) == MOT_RESULT_OK);
+    for (_latency = 90; _latency <= 400; _latency += 31) {
+        CHECK(MOT_MoveTo(MOT_Position() + 5000) == MOT_RESULT_OK);
+        gap = Run();
+        CHECK(_steps == 5000);
+        if (gap > MOT_TICK_HZ / 447 + _latency) {     // First step at sqrt(2a)
+            printf("FAIL: ISR of %u ticks: %llu ticks between steps\n", _latency, gap);
+            ++_failed;
+        }
+    }
+    CHECK(MOT_Position() == 5000 * 11);
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
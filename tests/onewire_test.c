@@ -0,0 +1,616 @@
+/**
+ * @file onewire_test.c
+ * @brief Host simulation of the 1-Wire master against virtual devices
+ *
+ * Time runs in quarter microseconds. Every TIM1 access of the driver costs a
+ * quarter microsecond (through Mock_Tim1Hook), so the inline-timed parts of
+ * a slot take simulated time, and between interrupts the simulation jumps
+ * to the channel 1 compare match plus an optional ISR latency.
+ *
+ * The bus is the master's open-drain output AND the devices pulling low.
+ * Each virtual device has a 64-bit ROM and a DS18B20-like scratchpad; it
+ * answers a reset with a presence pulse, decodes the ROM commands (READ,
+ * MATCH, SKIP, SEARCH, ALARM SEARCH) and the read/write scratchpad function
+ * commands, samples write slots and holds the bus low for a 0 in read slots.
+ * The master's waveform is checked against the 1-Wire timing limits.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Ionewire -Itimer -Igpio -Isystem -Iinterrupt tests/onewire_test.c \
+ *      onewire/onewire.c timer/timer.c gpio/io.c system/system.c tests/mock/mock.c \
+ *      -o onewire_test && ./onewire_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "system.h"
+#include "onewire.h"
+
+#define US(t)       ((unsigned long long)(t) * 4)     // Microseconds to time units
+#define NDEV        5
+
+IO_PIN _ios[IO_IDX_MAX] = {
+    [IOP_OW] = { GPIOD, GPIO_PIN_3 },
+};
+
+/**
+ * @brief Device states
+ */
+typedef enum {
+    D_IDLE,         // Not selected: wait for a reset
+    D_ROMCMD,       // Receive the ROM command
+    D_READROM,      // Send the ROM
+    D_MATCH,        // Receive a ROM and compare
+    D_SEARCH,       // Send bit, send complement, receive direction
+    D_FUNC,         // Receive the function command
+    D_READSP,       // Send the scratchpad
+    D_WRITESP,      // Receive 3 scratchpad bytes
+} DEV_STATE;
+
+typedef struct {
+    uint8_t rom[8];
+    uint8_t sp[9];                  // Scratchpad, CRC in the last byte
+    uint8_t alarm;                  // Answers ALARM SEARCH
+    uint8_t present;                // Connected to the bus
+    DEV_STATE st;
+    uint8_t buf[9];                 // Bits received
+    unsigned pos;                   // Bit position within the state
+    uint8_t sub;                    // Search step
+    unsigned long long pullFrom, pullUntil, sampleAt;
+} Dev;
+
+static Dev _dev[NDEV];
+
+// Device timing: presence wait and length, read slot hold, write sample
+static unsigned _presWait, _presLow, _hold, _sample;
+
+static unsigned long long _now;     // Simulated time, quarter microseconds
+static unsigned _latency;           // Compare match to ISR, microseconds
+static uint8_t _master;             // Master output released
+static uint8_t _stuck;              // Bus shorted to ground
+static unsigned long long _lastFall, _lastRise;
+static uint8_t _prevReset;          // Last low pulse was a reset
+static unsigned _violations;
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/**
+ * @brief Reference CRC-8, bit by bit over the polynomial x^8 + x^5 + x^4 + 1
+ */
+static uint8_t Crc8(const uint8_t *data, unsigned len)
+{
+    uint8_t crc = 0, b, mix;
+    unsigned i;
+
+    for (i = 0; i < len * 8; ++i) {
+        b = (uint8_t)((data[i >> 3] >> (i & 7)) & 1);
+        mix = (uint8_t)((crc ^ b) & 1);
+        crc >>= 1;
+        if (mix)
+            crc ^= 0x8C;
+    }
+    return crc;
+}
+
+/**
+ * @brief Timing limit violation of the master's waveform
+ */
+static void Violation(const char *what, unsigned long long t)
+{
+    if (_violations++ < 5)
+        printf("FAIL: %s: %.2f us\n", what, t / 4.0);
+}
+
+/**
+ * @brief Enter a device state
+ */
+static void Enter(Dev *d, DEV_STATE st)
+{
+    d->st = st;
+    d->pos = 0;
+    d->sub = 0;
+    memset(d->buf, 0, sizeof(d->buf));
+}
+
+/**
+ * @brief Bit a device sends in the next slot
+ *
+ * @return int 0 or 1, -1 to receive, -2 if not taking part
+ */
+static int TxBit(const Dev *d)
+{
+    uint8_t b;
+
+    switch (d->st) {
+    case D_READROM:
+        return (d->rom[d->pos >> 3] >> (d->pos & 7)) & 1;
+    case D_READSP:
+        return (d->sp[d->pos >> 3] >> (d->pos & 7)) & 1;
+    case D_SEARCH:
+        b = (uint8_t)((d->rom[d->pos >> 3] >> (d->pos & 7)) & 1);
+        return d->sub == 0 ? b : d->sub == 1 ? !b : -1;
+    case D_IDLE:
+        return -2;
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief Advance a device by the bit of a slot, sent or received
+ */
+static void Bit(Dev *d, uint8_t b)
+{
+    uint8_t rb;
+
+    if (d->st == D_SEARCH) {
+        if (d->sub < 2) {
+            ++d->sub;
+            return;
+        }
+        rb = (uint8_t)((d->rom[d->pos >> 3] >> (d->pos & 7)) & 1);
+        d->sub = 0;
+        if (b != rb)
+            Enter(d, D_IDLE);       // Lost this branch
+        else if (++d->pos == 64)
+            Enter(d, D_FUNC);
+        return;
+    }
+
+    if (b)
+        d->buf[d->pos >> 3] |= (uint8_t)(1 << (d->pos & 7));
+    ++d->pos;
+
+    switch (d->st) {
+    case D_ROMCMD:
+        if (d->pos < 8)
+            break;
+        switch (d->buf[0]) {
+        case OW_CMD_READ_ROM:     Enter(d, D_READROM); break;
+        case OW_CMD_MATCH_ROM:    Enter(d, D_MATCH); break;
+        case OW_CMD_SKIP_ROM:     Enter(d, D_FUNC); break;
+        case OW_CMD_SEARCH_ROM:   Enter(d, D_SEARCH); break;
+        case OW_CMD_ALARM_SEARCH: Enter(d, d->alarm ? D_SEARCH : D_IDLE); break;
+        default:                  Enter(d, D_IDLE); break;
+        }
+        break;
+    case D_READROM:
+        if (d->pos == 64)
+            Enter(d, D_FUNC);
+        break;
+    case D_MATCH:
+        if (d->pos == 64)
+            Enter(d, memcmp(d->buf, d->rom, 8) == 0 ? D_FUNC : D_IDLE);
+        break;
+    case D_FUNC:
+        if (d->pos < 8)
+            break;
+        Enter(d, d->buf[0] == 0xBE ? D_READSP : d->buf[0] == 0x4E ? D_WRITESP : D_IDLE);
+        break;
+    case D_READSP:
+        if (d->pos == 72)
+            Enter(d, D_IDLE);
+        break;
+    case D_WRITESP:
+        if (d->pos == 24) {
+            memcpy(&d->sp[2], d->buf, 3);
+            d->sp[8] = Crc8(d->sp, 8);
+            Enter(d, D_IDLE);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Bus level: released by the master and by every device
+ */
+static uint8_t Level(void)
+{
+    unsigned i;
+
+    if (_stuck || !_master)
+        return 0;
+    for (i = 0; i < NDEV; ++i) {
+        if (_dev[i].present && _now >= _dev[i].pullFrom && _now < _dev[i].pullUntil)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Master pulled the bus low: start of a slot or a reset
+ */
+static void Fall(void)
+{
+    unsigned i;
+    int b;
+
+    if (_lastRise) {
+        if (_now - _lastRise < US(1))
+            Violation("recovery", _now - _lastRise);
+        if (_prevReset && _now - _lastRise < US(480))
+            Violation("reset high time", _now - _lastRise);
+        if (!_prevReset && _now - _lastFall < US(60))
+            Violation("slot", _now - _lastFall);
+    }
+    _lastFall = _now;
+
+    for (i = 0; i < NDEV; ++i) {
+        Dev *d = &_dev[i];
+
+        if (!d->present || (b = TxBit(d)) == -2)
+            continue;
+        if (b == -1) {
+            d->sampleAt = _now + US(_sample);
+        } else {
+            if (b == 0) {
+                d->pullFrom = _now;
+                d->pullUntil = _now + US(_hold);
+            }
+            Bit(d, (uint8_t)b);
+        }
+    }
+}
+
+/**
+ * @brief Master released the bus: end of a slot or a reset
+ */
+static void Rise(void)
+{
+    unsigned long long low = _now - _lastFall;
+    unsigned i;
+
+    _lastRise = _now;
+    _prevReset = low >= US(480);
+    if (low < US(1) || (low > US(15) && low < US(60)) || (low > US(120) && low < US(480)))
+        Violation("low time", low);
+    if (!_prevReset)
+        return;
+
+    for (i = 0; i < NDEV; ++i) {
+        _dev[i].sampleAt = 0;
+        _dev[i].pullFrom = _now + US(_presWait);
+        _dev[i].pullUntil = _now + US(_presWait + _presLow);
+        Enter(&_dev[i], D_ROMCMD);
+    }
+}
+
+/**
+ * @brief Advance the simulation by one time unit
+ *
+ * The master output is taken from ODR, the counter registers and IDR are
+ * updated. CNTRH shows the counter one step ahead, so the CNTRH, CNTRL read
+ * pair of the driver always sees one consistent value, as with the latch of
+ * the real timer.
+ */
+static void Step(void)
+{
+    uint8_t m = (GPIOD->ODR & GPIO_PIN_3) ? 1 : 0;
+    unsigned i;
+
+    if (m != _master) {
+        _master = m;
+        if (m)
+            Rise();
+        else
+            Fall();
+    }
+
+    ++_now;
+    for (i = 0; i < NDEV; ++i) {
+        if (_dev[i].sampleAt && _now >= _dev[i].sampleAt) {
+            _dev[i].sampleAt = 0;
+            Bit(&_dev[i], Level());
+        }
+    }
+
+    if (Level())
+        GPIOD->IDR |= GPIO_PIN_3;
+    else
+        GPIOD->IDR &= (uint8_t)~GPIO_PIN_3;
+    Mock_TIM1.CNTRH = (uint8_t)((_now + 1) >> 10);
+    Mock_TIM1.CNTRL = (uint8_t)(_now >> 2);
+}
+
+/**
+ * @brief Counter in microseconds
+ */
+static uint16_t Counter(void)
+{
+    return (uint16_t)(_now >> 2);
+}
+
+/**
+ * @brief Run the compare interrupts until a transaction has completed
+ */
+static void Run(OW_Xfer *x)
+{
+    uint16_t ccr;
+    unsigned long n;
+    unsigned i;
+
+    while (x->busy) {
+        if (!(Mock_TIM1.IER & TIM1_IER_CC1IE)) {
+            printf("FAIL: transaction pending with the interrupt off\n");
+            ++_failed;
+            return;
+        }
+        ccr = (uint16_t)((Mock_TIM1.CCR1H << 8) | Mock_TIM1.CCR1L);
+        for (n = 0; Counter() != ccr && n < US(0x10000); ++n)
+            Step();
+        for (i = 0; i < US(_latency); ++i)
+            Step();
+        Mock_TIM1.SR1 |= TIM1_SR1_CC1IF;
+        Mock_Irq(IRQ_TIM1_CC);
+    }
+    for (i = 0; i < US(10); ++i)
+        Step();
+}
+
+/**
+ * @brief Submit a transaction and run it to completion
+ *
+ * @return OW_Result Result of the transaction
+ */
+static OW_Result Xfer(uint8_t reset, const uint8_t *w, uint8_t wlen, uint8_t *r, uint8_t rlen,
+                      OW_SearchState *s)
+{
+    OW_Xfer x;
+
+    memset(&x, 0, sizeof(x));
+    x.reset = reset;
+    x.wdata = w;
+    x.wlen = wlen;
+    x.rdata = r;
+    x.rlen = rlen;
+    x.search = s;
+    if (OW_Submit(&x) != OW_RESULT_OK)
+        return OW_RESULT_ERROR;
+    Run(&x);
+    return x.result;
+}
+
+/**
+ * @brief Enumerate the bus with SEARCH ROM or ALARM SEARCH
+ *
+ * @param cmd Search command
+ * @param found Devices found, as a bit mask of _dev indices
+ * @return int Number of searches that found a device, -1 on an error
+ */
+static int Enumerate(uint8_t cmd, unsigned *found)
+{
+    OW_SearchState s;
+    OW_Result r;
+    int n = 0;
+    unsigned i;
+
+    *found = 0;
+    OW_SearchReset(&s);
+    while (n <= NDEV) {
+        r = Xfer(1, &cmd, 1, NULL, 0, &s);
+        if (r == OW_RESULT_NO_DEVICE)
+            return s.lastDevice || n == 0 ? n : -1;
+        if (r != OW_RESULT_OK)
+            return -1;
+        ++n;
+        for (i = 0; i < NDEV; ++i) {
+            if (_dev[i].present && memcmp(s.rom, _dev[i].rom, 8) == 0) {
+                if (*found & (1U << i))
+                    return -1;
+                *found |= 1U << i;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Read a scratchpad through MATCH ROM
+ *
+ * @return int 1 if it matches the device's scratchpad and its CRC is valid
+ */
+static int ReadScratchpad(unsigned i)
+{
+    uint8_t cmd[10], sp[9];
+
+    cmd[0] = OW_CMD_MATCH_ROM;
+    memcpy(&cmd[1], _dev[i].rom, 8);
+    cmd[9] = 0xBE;
+    memset(sp, 0, sizeof(sp));
+    return Xfer(1, cmd, 10, sp, 9, NULL) == OW_RESULT_OK &&
+           memcmp(sp, _dev[i].sp, 9) == 0 && OW_Crc8(0, sp, 9) == 0;
+}
+
+/**
+ * @brief Set up the devices, all on the bus
+ */
+static void Devices(void)
+{
+    static const uint8_t serial[NDEV][7] = {
+        { 0x28, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x28, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x28, 0x03, 0xA5, 0x00, 0x00, 0x00, 0x80 },
+        { 0x28, 0x01, 0x00, 0x00, 0x00, 0x00, 0x80 },
+        { 0x10, 0xFF, 0x5A, 0x3C, 0x12, 0x34, 0x56 },
+    };
+    unsigned i, j;
+
+    memset(_dev, 0, sizeof(_dev));
+    for (i = 0; i < NDEV; ++i) {
+        memcpy(_dev[i].rom, serial[i], 7);
+        _dev[i].rom[7] = Crc8(_dev[i].rom, 7);
+        for (j = 0; j < 8; ++j)
+            _dev[i].sp[j] = (uint8_t)(0x10 * i + j);
+        _dev[i].sp[8] = Crc8(_dev[i].sp, 8);
+        _dev[i].present = 1;
+    }
+}
+
+/**
+ * @brief Run the transactions with one device timing and ISR latency
+ */
+static void Scenario(unsigned presWait, unsigned presLow, unsigned hold, unsigned sample,
+                     unsigned latency)
+{
+    static const uint8_t readRom = OW_CMD_READ_ROM;
+    uint8_t cmd[14], rom[8];
+    unsigned found, i;
+
+    _presWait = presWait;
+    _presLow = presLow;
+    _hold = hold;
+    _sample = sample;
+    _latency = latency;
+    _violations = 0;
+    Devices();
+
+    // All devices found once, the last one flagged
+    CHECK(Enumerate(OW_CMD_SEARCH_ROM, &found) == NDEV && found == (1U << NDEV) - 1);
+
+    // Only the devices in alarm
+    _dev[1].alarm = _dev[4].alarm = 1;
+    CHECK(Enumerate(OW_CMD_ALARM_SEARCH, &found) == 2 && found == ((1U << 1) | (1U << 4)));
+
+    // MATCH ROM selects one device
+    for (i = 0; i < NDEV; ++i)
+        CHECK(ReadScratchpad(i));
+
+    // Write scratchpad reaches only the matched device
+    cmd[0] = OW_CMD_MATCH_ROM;
+    memcpy(&cmd[1], _dev[2].rom, 8);
+    cmd[9] = 0x4E;
+    cmd[10] = 0x7F;
+    cmd[11] = 0x80;
+    cmd[12] = 0x1F;
+    CHECK(Xfer(1, cmd, 13, NULL, 0, NULL) == OW_RESULT_OK);
+    CHECK(_dev[2].sp[2] == 0x7F && _dev[2].sp[3] == 0x80 && _dev[2].sp[4] == 0x1F);
+    CHECK(_dev[1].sp[2] == 0x12 && _dev[3].sp[2] == 0x32);
+    CHECK(ReadScratchpad(2));
+
+    // READ ROM with a single device on the bus
+    for (i = 0; i < NDEV; ++i)
+        _dev[i].present = i == 3;
+    memset(rom, 0, sizeof(rom));
+    CHECK(Xfer(1, &readRom, 1, rom, 8, NULL) == OW_RESULT_OK);
+    CHECK(memcmp(rom, _dev[3].rom, 8) == 0 && OW_Crc8(0, rom, 8) == 0);
+    CHECK(Enumerate(OW_CMD_SEARCH_ROM, &found) == 1 && found == (1U << 3));
+
+    // SKIP ROM: the only device answers
+    cmd[0] = OW_CMD_SKIP_ROM;
+    cmd[1] = 0xBE;
+    memset(rom, 0, sizeof(rom));
+    CHECK(Xfer(1, cmd, 2, rom, 8, NULL) == OW_RESULT_OK && memcmp(rom, _dev[3].sp, 8) == 0);
+
+    // Nobody there
+    _dev[3].present = 0;
+    CHECK(Xfer(1, &readRom, 1, rom, 8, NULL) == OW_RESULT_NO_DEVICE);
+    CHECK(Enumerate(OW_CMD_SEARCH_ROM, &found) == 0 && found == 0);
+
+    if (_violations) {
+        printf("FAIL: presence %u+%u hold %u sample %u latency %u: %u timing violation(s)\n",
+               presWait, presLow, hold, sample, latency, _violations);
+        ++_failed;
+    }
+}
+
+static unsigned _order[4], _done;
+
+static void Done(OW_Xfer *x)
+{
+    _order[_done++] = (unsigned)x->rlen;
+}
+
+int main(void)
+{
+    static const uint8_t readRom = OW_CMD_READ_ROM, search = OW_CMD_SEARCH_ROM;
+    OW_Xfer q[4];
+    OW_SearchState s;
+    uint8_t rom[3][8];
+    unsigned i;
+
+    Mock_Reset();
+    Sys_ClockInit();
+    Sys_TickInit();
+    CHECK(OW_Init(4) == OW_RESULT_INVALID_PARAM);
+    CHECK(OW_Init(3) == OW_RESULT_OK);
+    CHECK(((Mock_TIM1.PSCRH << 8) | Mock_TIM1.PSCRL) == 15);
+    CHECK(Mock_Priority[ITC_IRQ_TIM1_CAPCOM] == 3);
+
+    _now = US(1000);
+    _master = (GPIOD->ODR & GPIO_PIN_3) ? 1 : 0;
+    CHECK(_master);
+    Mock_Tim1Hook = Step;
+
+    // Fastest and slowest devices, with and without ISR latency; the
+    // presence window closes 90 us after release, so the latency has to
+    // stay below 15 us for a device whose pulse ends at 75 us
+    Scenario(15, 60, 15, 15, 0);
+    Scenario(60, 240, 60, 45, 0);
+    Scenario(15, 60, 15, 15, 12);
+    Scenario(60, 240, 60, 45, 12);
+    Scenario(60, 240, 60, 45, 40);
+
+    // A ROM with a bad CRC
+    _latency = 0;
+    Devices();
+    for (i = 1; i < NDEV; ++i)
+        _dev[i].present = 0;
+    _dev[0].rom[7] ^= 0x01;
+    OW_SearchReset(&s);
+    CHECK(Xfer(1, &search, 1, NULL, 0, &s) == OW_RESULT_CRC);
+
+    // A shorted bus is reported without a reset pulse
+    _dev[0].present = 0;
+    _stuck = 1;
+    i = _violations;
+    CHECK(Xfer(1, &readRom, 1, rom[0], 8, NULL) == OW_RESULT_BUS_ERROR);
+    CHECK(_violations == i && _master);
+    _stuck = 0;
+
+    // Queued transactions run in order, one at a time
+    Devices();
+    for (i = 1; i < NDEV; ++i)
+        _dev[i].present = 0;
+    _done = 0;
+    memset(q, 0, sizeof(q));
+    for (i = 0; i < 4; ++i) {
+        q[i].reset = 1;
+        q[i].wdata = &readRom;
+        q[i].wlen = 1;
+        q[i].rdata = rom[i % 3];
+        q[i].rlen = (uint8_t)(8 - i);
+        q[i].done = Done;
+    }
+    CHECK(OW_Submit(&q[0]) == OW_RESULT_OK);
+    CHECK(OW_Submit(&q[0]) == OW_RESULT_BUSY);
+    CHECK(OW_Submit(&q[1]) == OW_RESULT_OK);
+    CHECK(OW_Submit(&q[2]) == OW_RESULT_OK);
+    CHECK(OW_Submit(&q[3]) == OW_RESULT_QUEUE_FULL);
+    CHECK(OW_Busy());
+    Run(&q[2]);
+    CHECK(!OW_Busy() && _done == 3);
+    CHECK(_order[0] == 8 && _order[1] == 7 && _order[2] == 6);
+    for (i = 0; i < 3; ++i) {
+        CHECK(q[i].result == OW_RESULT_OK);
+        CHECK(memcmp(rom[i], _dev[0].rom, 8 - i) == 0);
+    }
+
+    CHECK(_violations == 0);
+    Mock_Tim1Hook = NULL;
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
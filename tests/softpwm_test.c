@@ -0,0 +1,275 @@
+/**
+ * @file softpwm_test.c
+ * @brief Host test of the software PWM waveform and interrupt load
+ *
+ * TIM1 is modelled count by count: the counter runs up to the active
+ * reload value, then an update event restarts it, loads the ARR preload
+ * register (when ARPE is set) and calls SPWM_Isr after a configurable
+ * latency. The pin levels are sampled every count, so the high time of each
+ * channel per frame can be compared with duty * unit, and the ISR calls per
+ * frame are counted (SPWM_BITS, independent of the number of channels).
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Isoftpwm -Itimer -Igpio -Isystem -Iinterrupt tests/softpwm_test.c \
+ *      softpwm/softpwm.c timer/timer.c gpio/io.c system/system.c tests/mock/mock.c \
+ *      -o softpwm_test && ./softpwm_test
+ */
+
+#include <stdio.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "system.h"
+#include "softpwm.h"
+
+#define NCH     12
+
+// 12 channels on three ports, next to pins that are not PWM
+IO_PIN _ios[IO_IDX_MAX] = {
+    [0] = { GPIOA, GPIO_PIN_1 }, [1] = { GPIOA, GPIO_PIN_2 }, [2] = { GPIOA, GPIO_PIN_3 },
+    [3] = { GPIOC, GPIO_PIN_3 }, [4] = { GPIOC, GPIO_PIN_4 }, [5] = { GPIOC, GPIO_PIN_5 },
+    [6] = { GPIOC, GPIO_PIN_6 }, [7] = { GPIOC, GPIO_PIN_7 }, [8] = { GPIOD, GPIO_PIN_1 },
+    [9] = { GPIOD, GPIO_PIN_2 }, [10] = { GPIOD, GPIO_PIN_3 }, [11] = { GPIOD, GPIO_PIN_4 },
+};
+
+static const IO_IDX _pins[NCH] = {
+    (IO_IDX)0, (IO_IDX)1, (IO_IDX)2, (IO_IDX)3, (IO_IDX)4, (IO_IDX)5,
+    (IO_IDX)6, (IO_IDX)7, (IO_IDX)8, (IO_IDX)9, (IO_IDX)10, (IO_IDX)11,
+};
+
+static uint16_t _cnt, _shadow;      // Counter and active auto-reload
+static uint16_t _maxCnt;            // Highest count reached
+static unsigned _latency;           // Counts from update event to ISR
+static unsigned _pending;           // Counts until the ISR runs, 0 if none
+static unsigned long _isrs;         // ISR calls so far
+static unsigned long _high[NCH];    // Counts each channel was high
+
+static int _failed = 0;
+
+static void Tim1Count(void);
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/**
+ * @brief Start the counter model from the registers left by SPWM_Init
+ *
+ * Runs up to the first ISR call, which starts the first frame.
+ */
+static void Tim1Start(void)
+{
+    _cnt = 0;
+    _shadow = (uint16_t)((TIM1->ARRH << 8) | TIM1->ARRL);
+    _maxCnt = 0;
+    _latency = 0;
+    _pending = 0;
+    _isrs = 0;
+    while (!_isrs)
+        Tim1Count();
+}
+
+/**
+ * @brief Advance TIM1 by one count and sample the pins
+ */
+static void Tim1Count(void)
+{
+    uint16_t arr = (uint16_t)((TIM1->ARRH << 8) | TIM1->ARRL);
+    unsigned i;
+
+    if (!(TIM1->CR1 & TIM1_CR1_ARPE))
+        _shadow = arr;
+
+    if (_cnt == _shadow) {
+        _cnt = 0;
+        _shadow = arr;
+        TIM1->SR1 |= TIM1_SR1_UIF;
+        if (!_pending)                  // Already waiting: UIF just stays set
+            _pending = _latency + 1;
+    } else {
+        ++_cnt;
+    }
+    if (_cnt > _maxCnt)
+        _maxCnt = _cnt;
+
+    if (_pending && --_pending == 0 && (TIM1->SR1 & TIM1_SR1_UIF)) {
+        Mock_Irq(IRQ_TIM1_UPD);
+        ++_isrs;
+    }
+
+    for (i = 0; i < NCH; ++i) {
+        if (_ios[_pins[i]].port->ODR & _ios[_pins[i]].pin)
+            ++_high[i];
+    }
+}
+
+/**
+ * @brief Run the timer until a number of ISR calls have been made
+ *
+ * @param n ISR calls to wait for
+ * @return unsigned long Counts elapsed
+ */
+static unsigned long RunIsrs(unsigned long n)
+{
+    unsigned long end = _isrs + n, counts = 0;
+
+    while (_isrs < end) {
+        Tim1Count();
+        ++counts;
+    }
+    return counts;
+}
+
+/**
+ * @brief Run up to the start of the next frame (just after the slot 0 ISR)
+ */
+static void NextFrame(void)
+{
+    RunIsrs(SPWM_BITS - (_isrs - 1) % SPWM_BITS);
+}
+
+/**
+ * @brief Set and commit duties, then run up to the frame that uses them
+ *
+ * @param duty Duty per channel
+ */
+static void Apply(const uint8_t *duty)
+{
+    unsigned i;
+
+    for (i = 0; i < NCH; ++i)
+        CHECK(SPWM_Set((uint8_t)i, duty[i]) == SPWM_RESULT_OK);
+    CHECK(SPWM_Commit() == SPWM_RESULT_OK);
+    CHECK(SPWM_Commit() == SPWM_RESULT_BUSY);
+
+    // The slot 0 ISR of the next frame swaps in the new table
+    NextFrame();
+    CHECK(SPWM_Commit() == SPWM_RESULT_OK);
+}
+
+/**
+ * @brief Check the high time of every channel over a number of frames
+ *
+ * Starts at a frame start.
+ *
+ * @param duty Duty per channel
+ * @param unit Counts per time unit
+ * @param frames Frames to measure
+ * @return int Number of channels off
+ */
+static int CheckFrames(const uint8_t *duty, unsigned unit, unsigned frames)
+{
+    unsigned long counts;
+    unsigned i, f, bad = 0;
+
+    for (f = 0; f < frames; ++f) {
+        for (i = 0; i < NCH; ++i)
+            _high[i] = 0;
+
+        counts = RunIsrs(SPWM_BITS);
+        if (counts != 255UL * unit) {
+            printf("FAIL: frame of %lu counts, %u expected\n", counts, 255 * unit);
+            ++bad;
+        }
+        for (i = 0; i < NCH; ++i) {
+            if (_high[i] != (unsigned long)duty[i] * unit) {
+                printf("FAIL: ch %u duty %u: high %lu counts, %lu expected\n",
+                       i, duty[i], _high[i], (unsigned long)duty[i] * unit);
+                ++bad;
+            }
+        }
+    }
+    _failed += (int)bad;
+    return (int)bad;
+}
+
+int main(void)
+{
+    static const uint8_t d1[NCH] = { 0, 1, 2, 3, 127, 128, 129, 200, 254, 255, 85, 170 };
+    static const uint8_t d2[NCH] = { 255, 254, 128, 127, 1, 0, 64, 32, 16, 8, 4, 2 };
+    unsigned unit, lat, i;
+    unsigned long counts;
+
+    Mock_Reset();
+    Sys_ClockInit();
+    Sys_TickInit();
+
+    // Invalid configurations
+    CHECK(SPWM_Init(NULL, 1, 100, 1) == SPWM_RESULT_INVALID_PARAM);
+    CHECK(SPWM_Init(_pins, 0, 100, 1) == SPWM_RESULT_INVALID_PARAM);
+    CHECK(SPWM_Init(_pins, NCH, 19, 1) == SPWM_RESULT_INVALID_PARAM);
+    CHECK(SPWM_Init(_pins, NCH, 201, 1) == SPWM_RESULT_INVALID_PARAM);
+    CHECK(SPWM_Init(_pins, NCH, 100, 4) == SPWM_RESULT_INVALID_PARAM);
+
+    // 200 Hz needs the full 16 MHz for the shortest slot
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV2, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(SPWM_Init(_pins, NCH, 200, 1) == SPWM_RESULT_INVALID_PARAM);
+    CHECK(SPWM_Init(_pins, NCH, 100, 1) == SPWM_RESULT_OK);
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV1, CLK_PRESCALER_CPUDIV1) == 0);
+
+    // Pins next to the channels are left alone
+    GPIOA->ODR = 0x01;
+    GPIOD->ODR = 0x80;
+
+    // 200 Hz: 16 MHz / 8 / (200 * 255) = 39 counts per unit
+    CHECK(SPWM_Init(_pins, NCH, 200, 2) == SPWM_RESULT_OK);
+    unit = 39;
+    CHECK(TIM1->CR1 & TIM1_CR1_ARPE);
+    CHECK(TIM1->PSCRL == 7 && ((TIM1->ARRH << 8) | TIM1->ARRL) == (int)unit - 1);
+    CHECK(Mock_Priority[ITC_IRQ_TIM1_OVF] == 2);
+
+    // Exact high time per frame, with and without ISR latency
+    Tim1Start();
+    for (lat = 0; lat < unit; lat += 19) {
+        _latency = lat;
+        Apply(d1);
+        CheckFrames(d1, unit, 3);
+        Apply(d2);
+        CheckFrames(d2, unit, 3);
+    }
+    CHECK(GPIOA->ODR & 0x01);
+    CHECK(GPIOD->ODR & 0x80);
+
+    // An ISR later than the shortest slot stretches slots but the counter
+    // never passes the longest one
+    _latency = unit + 10;
+    RunIsrs(SPWM_BITS * 20);
+    CHECK(_maxCnt < 128 * unit);
+    _latency = 0;
+    NextFrame();
+    Apply(d1);
+    CheckFrames(d1, unit, 2);
+
+    // A frame never mixes two tables: commit mid-frame, slots 3-7 keep the
+    // old duties (give or take the count at either end)
+    RunIsrs(3);
+    for (i = 0; i < NCH; ++i)
+        SPWM_Set((uint8_t)i, d2[i]);
+    CHECK(SPWM_Commit() == SPWM_RESULT_OK);
+    for (i = 0; i < NCH; ++i)
+        _high[i] = 0;
+    NextFrame();
+    for (i = 0; i < NCH; ++i)
+        CHECK(_high[i] + 1 >= (d1[i] & 0xF8) * unit && _high[i] <= (d1[i] & 0xF8) * unit + 1);
+    CheckFrames(d2, unit, 2);
+
+    // Interrupt load: SPWM_BITS calls per frame, whatever the channel count
+    counts = RunIsrs(SPWM_BITS * 100);
+    CHECK(counts == 100UL * 255 * unit);
+    CHECK(SPWM_Init(_pins, 1, 200, 2) == SPWM_RESULT_OK);
+    Tim1Start();
+    counts = RunIsrs(SPWM_BITS * 100);
+    CHECK(counts == 100UL * 255 * unit);
+
+    printf("load: %d interrupts per frame, %u per second at 200 Hz, "
+           "shortest slot %u master clock cycles\n",
+           SPWM_BITS, SPWM_BITS * 200, unit * 8);
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
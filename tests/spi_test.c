@@ -0,0 +1,309 @@
+/**
+ * @file spi_test.c
+ * @brief Host test and benchmark of the SPI master driver
+ *
+ * The SPI peripheral is modelled on the mock registers: a transmit buffer
+ * (DR) in front of a shift register, TXE/RXNE/OVR flags and the interrupt
+ * enables in ICR. MISO is wired to MOSI (loopback), or to a slave that
+ * answers with a counter restarted by each chip-select assertion. The model
+ * services pending interrupts before the shift register completes a byte,
+ * as the driver requires.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Ispi -Igpio -Iinterrupt tests/spi_test.c spi/spi.c \
+ *      gpio/io.c tests/mock/mock.c -o spi_test && ./spi_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "spi.h"
+
+#define BENCH_BYTES     2000000UL
+
+IO_PIN _ios[IO_IDX_MAX] = {
+    [IOP_SPI_CS] = { GPIOA, GPIO_PIN_3 },
+};
+
+static int _loopback = 1;       // MISO = MOSI, else the counting slave
+static uint8_t _slaveCnt;
+static unsigned _csEdges;       // Chip-select assertions
+static unsigned long _isrCalls;
+static unsigned long _bytes;
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/**
+ * @brief Track chip-select edges, restart the slave on assertion
+ *
+ * @param port Changed port
+ */
+static void CsHook(GPIO_TypeDef *port)
+{
+    static uint8_t last = GPIO_PIN_3;
+    uint8_t cs = port->ODR & GPIO_PIN_3;
+
+    if (port != GPIOA)
+        return;
+    if (last && !cs) {
+        ++_csEdges;
+        _slaveCnt = 0;
+    }
+    last = cs;
+}
+
+/**
+ * @brief Check if the SPI interrupt is pending
+ *
+ * @return int Non-zero if pending
+ */
+static int SpiPending(void)
+{
+    uint8_t sr = SPI->SR, icr = SPI->ICR;
+
+    return ((icr & SPI_ICR_TXEI) && (sr & SPI_SR_TXE)) ||
+           ((icr & SPI_ICR_RXEI) && (sr & SPI_SR_RXNE)) ||
+           ((icr & SPI_ICR_ERRIE) && (sr & SPI_SR_OVR));
+}
+
+/**
+ * @brief Run the peripheral until it is idle with no interrupt pending
+ *
+ * @return unsigned Bytes clocked
+ */
+static unsigned SpiRun(void)
+{
+    static int shifting = 0, loaded = 0;
+    static uint8_t shiftByte, txBuf, rxData;
+    unsigned n = 0;
+
+    for (;;) {
+        while (SpiPending()) {
+            uint8_t rxne = SPI->SR & (SPI_SR_RXNE | SPI_SR_OVR);
+
+            SPI->DR = 0x100 | rxData;
+            Mock_Irq(IRQ_SPI);
+            ++_isrCalls;
+
+            // The driver always reads DR when it sees RXNE or OVR
+            if (rxne)
+                SPI->SR &= (uint8_t)~(SPI_SR_RXNE | SPI_SR_OVR);
+            if (!(SPI->DR & 0x100)) {
+                CHECK(!loaded);
+                txBuf = (uint8_t)SPI->DR;
+                loaded = 1;
+                SPI->SR &= (uint8_t)~SPI_SR_TXE;
+            }
+            if (!loaded)
+                SPI->SR |= SPI_SR_TXE;
+            if (!shifting && loaded) {
+                shiftByte = txBuf;
+                shifting = 1;
+                loaded = 0;
+                SPI->SR |= SPI_SR_TXE;
+            }
+            if (!SpiPending())
+                break;
+        }
+
+        if (!shifting)
+            return n;
+
+        // Shift register completes a byte
+        rxData = _loopback ? shiftByte : _slaveCnt++;
+        if (SPI->SR & SPI_SR_RXNE)
+            SPI->SR |= SPI_SR_OVR;
+        SPI->SR |= SPI_SR_RXNE;
+        shifting = 0;
+        ++n;
+        if (loaded) {
+            shiftByte = txBuf;
+            shifting = 1;
+            loaded = 0;
+            SPI->SR |= SPI_SR_TXE;
+        }
+    }
+}
+
+static SPI_Xfer *_order[8];
+static unsigned _nDone;
+
+/**
+ * @brief Record the completion order
+ *
+ * @param x Finished transaction
+ */
+static void Done(SPI_Xfer *x)
+{
+    if (_nDone < 8)
+        _order[_nDone] = x;
+    ++_nDone;
+}
+
+static SPI_Xfer _chain;
+
+/**
+ * @brief Completion callback that submits a follow-up transaction
+ *
+ * @param x Finished transaction
+ */
+static void Resubmit(SPI_Xfer *x)
+{
+    Done(x);
+    CHECK(SPI_Submit(&_chain) == SPI_RESULT_OK);
+}
+
+/**
+ * @brief Fill a descriptor
+ */
+static void Xfer(SPI_Xfer *x, IO_IDX cs, const uint8_t *tx, uint8_t *rx, uint16_t len,
+                 SPI_Callback done)
+{
+    memset(x, 0, sizeof(*x));
+    x->cs = cs;
+    x->tx = tx;
+    x->rx = rx;
+    x->len = len;
+    x->done = done;
+}
+
+/**
+ * @brief Get a monotonic time stamp
+ *
+ * @return double Seconds
+ */
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+    static uint8_t tx[300], rx[300];
+    SPI_Xfer a, b, c, d;
+    unsigned i, ok;
+    double t0, t1;
+
+    Mock_Reset();
+    Mock_GpioHook = CsHook;
+
+    // Registers
+    CHECK(SPI_MasterInit(SPI_CLK_DIV4, (SPI_MODE)4, 3) == SPI_RESULT_INVALID_PARAM);
+    CHECK(SPI_MasterInit(SPI_CLK_DIV4, SPI_MODE3, 2) == SPI_RESULT_OK);
+    CHECK(SPI->CR1 == (SPI_CR1_SPE | SPI_BAUDRATEPRESCALER_4 | SPI_MODE_MASTER |
+                       SPI_CLOCKPOLARITY_HIGH | SPI_CLOCKPHASE_2EDGE));
+    CHECK(SPI->CR2 == (SPI_NSS_SOFT | 0x01));
+    CHECK(Mock_Priority[ITC_IRQ_SPI] == 2);
+    CHECK(Mock_Handler(IRQ_SPI) == SPI_Isr);
+    CHECK(SPI_CSInit(IOP_SPI_CS) == SPI_RESULT_OK);
+    CHECK((GPIOA->ODR & GPIOA->DDR & GPIO_PIN_3) != 0);
+
+    // Loopback block transfer with chip select
+    for (i = 0; i < sizeof(tx); ++i)
+        tx[i] = (uint8_t)(i * 7 + 1);
+    Xfer(&a, IOP_SPI_CS, tx, rx, sizeof(tx), NULL);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_OK);
+    CHECK(a.busy && SPI_Busy());
+    CHECK(SPI_Submit(&a) == SPI_RESULT_BUSY);
+    CHECK(SpiRun() == sizeof(tx));
+    CHECK(!a.busy && a.result == SPI_RESULT_OK && !SPI_Busy());
+    CHECK(memcmp(tx, rx, sizeof(tx)) == 0);
+    CHECK(_csEdges == 1 && (GPIOA->ODR & GPIO_PIN_3));
+    CHECK((SPI->ICR & (SPI_ICR_TXEI | SPI_ICR_RXEI)) == 0);
+
+    // Dummy bytes without a transmit buffer, no receive buffer
+    memset(rx, 0, sizeof(rx));
+    Xfer(&a, SPI_NO_CS, NULL, rx, 5, NULL);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_OK);
+    SpiRun();
+    CHECK(a.result == SPI_RESULT_OK && rx[0] == SPI_DUMMY_BYTE && rx[4] == SPI_DUMMY_BYTE);
+    CHECK(_csEdges == 1);
+    Xfer(&a, SPI_NO_CS, tx, NULL, 5, NULL);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_OK);
+    CHECK(SpiRun() == 5 && a.result == SPI_RESULT_OK);
+
+    // Single byte
+    Xfer(&a, IOP_SPI_CS, tx, rx, 1, NULL);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_OK);
+    CHECK(SpiRun() == 1 && rx[0] == tx[0]);
+
+    // Invalid descriptors
+    CHECK(SPI_Submit(NULL) == SPI_RESULT_INVALID_PARAM);
+    Xfer(&a, IOP_SPI_CS, tx, rx, 0, NULL);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_INVALID_PARAM);
+
+    // Queue: three slots, completed in order, chip select per transaction
+    _loopback = 0;
+    _csEdges = 0;
+    _nDone = 0;
+    Xfer(&a, IOP_SPI_CS, NULL, rx, 10, Done);
+    Xfer(&b, IOP_SPI_CS, NULL, rx + 10, 20, Done);
+    Xfer(&c, IOP_SPI_CS, NULL, rx + 30, 30, Done);
+    Xfer(&d, IOP_SPI_CS, NULL, rx + 60, 5, Done);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_OK);
+    CHECK(SPI_Submit(&b) == SPI_RESULT_OK);
+    CHECK(SPI_Submit(&c) == SPI_RESULT_OK);
+    CHECK(SPI_Submit(&d) == SPI_RESULT_QUEUE_FULL);
+    CHECK(!d.busy);
+    CHECK(SpiRun() == 60);
+    CHECK(_nDone == 3 && _order[0] == &a && _order[1] == &b && _order[2] == &c);
+    CHECK(_csEdges == 3);
+    for (ok = 1, i = 0; i < 30; ++i)
+        ok &= rx[30 + i] == i;
+    CHECK(ok && rx[0] == 0 && rx[9] == 9 && rx[10] == 0 && rx[29] == 19);
+
+    // A transaction submitted from the callback runs after the queued ones
+    _nDone = 0;
+    Xfer(&a, IOP_SPI_CS, NULL, rx, 4, Resubmit);
+    Xfer(&b, IOP_SPI_CS, NULL, rx, 4, Done);
+    Xfer(&_chain, IOP_SPI_CS, NULL, rx, 4, Done);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_OK);
+    CHECK(SPI_Submit(&b) == SPI_RESULT_OK);
+    CHECK(SpiRun() == 12);
+    CHECK(_nDone == 3 && _order[0] == &a && _order[1] == &b && _order[2] == &_chain);
+    CHECK(!_chain.busy && _chain.result == SPI_RESULT_OK);
+
+    // Overrun ends the transaction with an error, the next one still runs
+    _loopback = 1;
+    _nDone = 0;
+    Xfer(&a, IOP_SPI_CS, tx, rx, 50, Done);
+    Xfer(&b, IOP_SPI_CS, tx, rx + 50, 50, Done);
+    CHECK(SPI_Submit(&a) == SPI_RESULT_OK);
+    CHECK(SPI_Submit(&b) == SPI_RESULT_OK);
+    SPI->SR |= SPI_SR_OVR;
+    SpiRun();
+    CHECK(a.result == SPI_RESULT_ERROR && b.result == SPI_RESULT_OK);
+    CHECK(_nDone == 2 && memcmp(rx + 50, tx, 50) == 0);
+    CHECK((GPIOA->ODR & GPIO_PIN_3) && !SPI_Busy());
+
+    // Benchmark: host time through driver and model
+    _isrCalls = 0;
+    _bytes = 0;
+    t0 = Now();
+    while (_bytes < BENCH_BYTES) {
+        Xfer(&a, IOP_SPI_CS, tx, rx, sizeof(tx), NULL);
+        SPI_Submit(&a);
+        _bytes += SpiRun();
+    }
+    t1 = Now();
+    CHECK(memcmp(tx, rx, sizeof(tx)) == 0);
+    printf("bench: %lu bytes, %.2f interrupts/byte, %.1f Mbytes/s on the host\n",
+           _bytes, (double)_isrCalls / _bytes, _bytes / (t1 - t0) * 1e-6);
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
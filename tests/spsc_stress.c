@@ -0,0 +1,154 @@
+/**
+ * @file spsc_stress.c
+ * @brief Host stress test for the SPSC ring queue
+ *
+ * A producer thread stands in for the interrupt handler and pushes a running
+ * sequence number, mixing single and bulk pushes; the main thread pops with
+ * single and bulk pops and checks that every value arrives once and in order.
+ * Both sides yield when they cannot make progress, so the test also runs on
+ * a single core. A second, single-threaded pass measures the cost per
+ * element.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -pthread -Iqueue tests/spsc_stress.c -o spsc_stress && ./spsc_stress
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// Hosts may reorder stores between cores, unlike the STM8
+#define SPSC_BARRIER()  __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#include "spsc.h"
+
+#define STRESS_COUNT    2000000UL
+#define BENCH_COUNT     20000000UL
+
+SPSC_DEFINE(TestQ, uint32_t, 16)
+SPSC_DEFINE(BenchQ, uint32_t, 128)
+
+static TestQ_t _q;
+
+/**
+ * @brief Producer thread, pushes 0 .. STRESS_COUNT-1
+ *
+ * @param arg Unused
+ * @return void* NULL
+ */
+static void *Producer(void *arg)
+{
+    uint32_t next = 0, blk[5];
+    uint8_t i, n;
+
+    (void)arg;
+    while (next < STRESS_COUNT) {
+        if (next & 1) {
+            if (TestQ_Push(&_q, &next))
+                ++next;
+            else
+                sched_yield();
+        } else {
+            n = (uint8_t)(1 + (next >> 3) % 5);
+            for (i = 0; i < n; ++i)
+                blk[i] = next + i;
+            if (next + n > STRESS_COUNT)
+                n = (uint8_t)(STRESS_COUNT - next);
+            n = TestQ_PushN(&_q, blk, n);
+            if (n == 0)
+                sched_yield();
+            next += n;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Get a monotonic time stamp
+ *
+ * @return double Seconds
+ */
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+    pthread_t th;
+    uint32_t expect = 0, v, blk[7];
+    uint32_t sum = 0;
+    uint8_t i, n;
+    unsigned long k;
+    double t0, t1;
+    BenchQ_t *bq;
+
+    TestQ_Init(&_q);
+    t0 = Now();
+    if (pthread_create(&th, NULL, Producer, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+
+    while (expect < STRESS_COUNT) {
+        if (TestQ_Count(&_q) > 16) {
+            printf("FAIL: count %u out of range\n", TestQ_Count(&_q));
+            return 1;
+        }
+        if (expect & 4) {
+            n = TestQ_PopN(&_q, blk, (uint8_t)(1 + expect % 7));
+            if (n == 0)
+                sched_yield();
+            for (i = 0; i < n; ++i) {
+                if (blk[i] != expect) {
+                    printf("FAIL: got %u, expected %u\n", blk[i], expect);
+                    return 1;
+                }
+                ++expect;
+            }
+        } else if (TestQ_Pop(&_q, &v)) {
+            if (v != expect) {
+                printf("FAIL: got %u, expected %u\n", v, expect);
+                return 1;
+            }
+            ++expect;
+        } else {
+            sched_yield();
+        }
+    }
+    pthread_join(th, NULL);
+    t1 = Now();
+
+    if (TestQ_Count(&_q) != 0) {
+        printf("FAIL: %u elements left over\n", TestQ_Count(&_q));
+        return 1;
+    }
+    printf("stress: %lu elements in order, %.1f ns/element across threads\n",
+           STRESS_COUNT, (t1 - t0) * 1e9 / STRESS_COUNT);
+
+    // Single-threaded push/pop pairs
+    bq = malloc(sizeof(*bq));
+    if (bq == NULL)
+        return 1;
+    BenchQ_Init(bq);
+    t0 = Now();
+    for (k = 0; k < BENCH_COUNT; ++k) {
+        v = (uint32_t)k;
+        BenchQ_Push(bq, &v);
+        BenchQ_Pop(bq, &v);
+        sum += v;
+    }
+    t1 = Now();
+    printf("bench: %.2f ns per push+pop (checksum %u)\n",
+           (t1 - t0) * 1e9 / BENCH_COUNT, sum);
+    free(bq);
+
+    printf("PASS\n");
+    return 0;
+}
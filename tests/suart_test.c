@@ -0,0 +1,538 @@
+/**
+ * @file suart_test.c
+ * @brief Host simulation of the software UART bit timing, loopback and errors
+ *
+ * Time runs in quarter microseconds and every TIM1 access of the driver costs
+ * one unit (through Mock_Tim1Hook). TIM1 counts at 1 MHz and sets CC1IF or
+ * CC2IF when it reaches CCR1 or CCR2. The start bit interrupt goes pending on
+ * a falling edge of the RX pin while its CR2 bit is set. Pending interrupts
+ * are served after a configurable latency, and can be held off for a time
+ * window to make the bit interrupts late.
+ *
+ * Every TX edge is logged, so the waveform can be checked against the ideal
+ * bit grid and decoded. The RX pin is driven by a frame generator with a
+ * skewed baud rate and a selectable stop bit level, or looped back from TX.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -Itests/mock -Iuart -Iqueue -Itimer -Igpio -Isystem -Iinterrupt tests/suart_test.c \
+ *      uart/suart.c timer/timer.c gpio/io.c system/system.c tests/mock/mock.c \
+ *      -o suart_test && ./suart_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "system.h"
+#include "suart.h"
+
+#define US(t)       ((unsigned long long)(t) * 4)     // Microseconds to time units
+#define MAX_EDGES   4096
+#define MAX_FRAMES  64
+
+IO_PIN _ios[IO_IDX_MAX] = {
+    [IOP_U2RX] = { GPIOD, GPIO_PIN_6 },
+    [IOP_U2TX] = { GPIOC, GPIO_PIN_5 },
+};
+
+static unsigned long long _now;             // Simulated time, quarter microseconds
+static unsigned _latency;                   // Interrupt request to ISR, microseconds
+static unsigned long long _blockFrom, _blockUntil;  // Interrupts held off
+static uint8_t _sr;                         // TIM1 SR1, writes only clear flags
+static unsigned long long _ccAt[2];         // CC1IF and CC2IF set at
+static uint8_t _exti;                       // Start bit interrupt pending
+static unsigned long long _extiAt;
+static uint8_t _tx, _rx;                    // Pin levels
+
+static unsigned long long _edge[MAX_EDGES]; // TX edges
+static uint8_t _edgeLevel[MAX_EDGES];
+static unsigned _nEdges;
+
+// RX frame generator, or TX looped back to RX
+static uint8_t _loop;
+static uint8_t _gByte[MAX_FRAMES], _gStop[MAX_FRAMES];
+static unsigned _gn, _gi, _gGap;            // Frames, current frame, idle bits between
+static double _gStart, _gBit;               // Current frame start, bit time
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+static double Abs(double x)
+{
+    return x < 0 ? -x : x;
+}
+
+/**
+ * @brief RX level of the frame generator
+ */
+static uint8_t GenLevel(void)
+{
+    double pos = 0;
+    unsigned bit;
+
+    while (_gi < _gn) {
+        pos = ((double)_now - _gStart) / _gBit;
+        if (pos < 10 + _gGap)
+            break;
+        _gStart += (10 + _gGap) * _gBit;
+        ++_gi;
+    }
+    if (_gi >= _gn || pos < 0)
+        return 1;
+
+    bit = (unsigned)pos;
+    if (bit == 0)
+        return 0;
+    if (bit <= 8)
+        return (uint8_t)((_gByte[_gi] >> (bit - 1)) & 1);
+    return bit == 9 ? _gStop[_gi] : 1;
+}
+
+/**
+ * @brief Advance the simulation by one time unit
+ *
+ * TX edges are logged, the RX pin and the compare flags are updated. The
+ * driver clears a flag by writing 0 to it and 1 to the others, so SR1 keeps
+ * only the flags that were set and not written 0. CNTRH shows the counter
+ * one step ahead, so the CNTRH, CNTRL read pair of the driver always sees
+ * one consistent value, as with the latch of the real timer.
+ */
+static void Step(void)
+{
+    uint8_t tx = (GPIOC->ODR & GPIO_PIN_5) ? 1 : 0, rx;
+    uint16_t cnt;
+
+    _sr &= Mock_TIM1.SR1;
+    if (tx != _tx) {
+        _tx = tx;
+        if (_nEdges < MAX_EDGES) {
+            _edge[_nEdges] = _now;
+            _edgeLevel[_nEdges] = tx;
+        }
+        ++_nEdges;
+    }
+
+    ++_now;
+    rx = _loop ? _tx : GenLevel();
+    if (_rx && !rx && (GPIOD->CR2 & GPIO_PIN_6) && !_exti) {
+        _exti = 1;
+        _extiAt = _now;
+    }
+    _rx = rx;
+    if (rx)
+        GPIOD->IDR |= GPIO_PIN_6;
+    else
+        GPIOD->IDR &= (uint8_t)~GPIO_PIN_6;
+
+    if (!(_now & 3)) {
+        cnt = (uint16_t)(_now >> 2);
+        if (cnt == ((Mock_TIM1.CCR1H << 8) | Mock_TIM1.CCR1L) && !(_sr & TIM1_SR1_CC1IF)) {
+            _sr |= TIM1_SR1_CC1IF;
+            _ccAt[0] = _now;
+        }
+        if (cnt == ((Mock_TIM1.CCR2H << 8) | Mock_TIM1.CCR2L) && !(_sr & TIM1_SR1_CC2IF)) {
+            _sr |= TIM1_SR1_CC2IF;
+            _ccAt[1] = _now;
+        }
+    }
+    Mock_TIM1.SR1 = _sr;
+    Mock_TIM1.CNTRH = (uint8_t)((_now + 1) >> 10);
+    Mock_TIM1.CNTRL = (uint8_t)(_now >> 2);
+}
+
+/**
+ * @brief Serve a pending interrupt whose latency has passed
+ */
+static void Dispatch(void)
+{
+    unsigned long long lat = US(_latency);
+    uint8_t pend;
+
+    if (_now >= _blockFrom && _now < _blockUntil)
+        return;
+    if (_exti && _now - _extiAt >= lat) {
+        _exti = 0;
+        Mock_Irq(IRQ_EXTI_D);
+        return;
+    }
+    pend = (uint8_t)(_sr & Mock_TIM1.IER & (TIM1_SR1_CC1IF | TIM1_SR1_CC2IF));
+    if (((pend & TIM1_SR1_CC1IF) && _now - _ccAt[0] >= lat) ||
+        ((pend & TIM1_SR1_CC2IF) && _now - _ccAt[1] >= lat))
+        Mock_Irq(IRQ_TIM1_CC);
+}
+
+/**
+ * @brief Run the simulation
+ *
+ * @param units Time to run, quarter microseconds
+ */
+static void Run(unsigned long long units)
+{
+    unsigned long long end = _now + units;
+
+    while (_now < end) {
+        Step();
+        Dispatch();
+    }
+}
+
+/**
+ * @brief Run until the transmitter is idle
+ *
+ * @return int 1 if it went idle within a second
+ */
+static int RunIdle(void)
+{
+    unsigned long long end = _now + US(1000000);
+
+    while ((Mock_TIM1.IER & TIM1_IER_CC1IE) && _now < end) {
+        Step();
+        Dispatch();
+    }
+    return !(Mock_TIM1.IER & TIM1_IER_CC1IE);
+}
+
+/**
+ * @brief Queue a byte from the main thread, interruptible after the call
+ */
+static void Send(uint8_t ch)
+{
+    CHECK(SUART_Send(ch) == UART_RESULT_OK);
+    Dispatch();
+}
+
+/**
+ * @brief Initialize the driver and clear the simulation state
+ */
+static void Begin(uint32_t baud, unsigned latency)
+{
+    _latency = latency;
+    _blockFrom = _blockUntil = 0;
+    _exti = 0;
+    _loop = 0;
+    _gn = _gi = 0;
+    GPIOD->IDR |= GPIO_PIN_6;
+    _rx = 1;
+    CHECK(SUART_Init(baud) == UART_RESULT_OK);
+    _tx = (GPIOC->ODR & GPIO_PIN_5) ? 1 : 0;
+    CHECK(_tx == 1);
+    Run(US(100));
+    _nEdges = 0;
+}
+
+/**
+ * @brief Queue frames on the generator
+ *
+ * @param data Bytes
+ * @param stop Stop bit level per byte, NULL for all 1
+ * @param n Number of bytes
+ * @param baud Baud rate of the sender
+ * @param skew Relative baud rate error of the sender
+ * @param gap Idle bits between frames
+ */
+static void Generate(const uint8_t *data, const uint8_t *stop, unsigned n, uint32_t baud,
+                     double skew, unsigned gap)
+{
+    memcpy(_gByte, data, n);
+    if (stop)
+        memcpy(_gStop, stop, n);
+    else
+        memset(_gStop, 1, n);
+    _gn = n;
+    _gi = 0;
+    _gGap = gap;
+    _gBit = US(1000000) / (double)baud / (1 + skew);
+    _gStart = (double)(_now + US(20));
+}
+
+/**
+ * @brief Run until the generator has sent every frame, plus a few bits
+ *
+ * Received bytes are taken as they come, as an application would, so errors
+ * are reported with the byte after them.
+ *
+ * @param got Receives the bytes, NULL to leave them in the buffer
+ * @param res Receives the result per byte
+ * @param max Size of got and res
+ * @return unsigned Number of bytes taken
+ */
+static unsigned RunGenerator(uint8_t *got, UART_Result *res, unsigned max)
+{
+    unsigned long long end = 0;
+    unsigned n = 0;
+
+    while (_gi < _gn || _now < end) {
+        if (_gi >= _gn && !end)
+            end = _now + (unsigned long long)(3 * _gBit);
+        Run(US(10));
+        while (got && n < max && SUART_RxCount() > 0) {
+            res[n] = SUART_Recv(&got[n]);
+            ++n;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief TX level at a time, from the edge log
+ */
+static uint8_t LevelAt(unsigned long long t)
+{
+    uint8_t lvl = 1;
+    unsigned i;
+
+    for (i = 0; i < _nEdges && _edge[i] <= t; ++i)
+        lvl = _edgeLevel[i];
+    return lvl;
+}
+
+/**
+ * @brief Check the TX waveform of back-to-back frames and decode it
+ *
+ * Every edge must lie on the bit grid of its frame, and the frames on the
+ * grid of the first one (the bit time does not drift).
+ *
+ * @param from First edge of the first frame
+ * @param data Expected bytes
+ * @param n Number of bytes
+ * @param baud Baud rate
+ * @return int Number of errors
+ */
+static int CheckTx(unsigned from, const uint8_t *data, unsigned n, uint32_t baud)
+{
+    double bit = US(1000000) / (double)baud, tol = (double)US(2) + US(_latency), d;
+    unsigned long long s0 = 0, s;
+    unsigned i = from, j, f, b, bad = 0;
+    uint8_t byte;
+
+    CHECK(_nEdges <= MAX_EDGES);
+    for (f = 0; f < n; ++f) {
+        while (i < _nEdges && _edgeLevel[i])
+            ++i;
+        if (i >= _nEdges) {
+            printf("FAIL: %u baud: frame %u not sent\n", baud, f);
+            ++bad;
+            break;
+        }
+        s = _edge[i];
+        if (f == 0)
+            s0 = s;
+        else if (Abs((double)(s - s0) - 10.0 * f * bit) > tol)
+            ++bad;
+
+        for (j = i; j < _nEdges && _edge[j] < s + 9.5 * bit; ++j) {
+            d = (double)(_edge[j] - s);
+            if (Abs(d - (unsigned)(d / bit + 0.5) * bit) > tol) {
+                printf("FAIL: %u baud: frame %u edge %.2f us off the grid\n",
+                       baud, f, (d - (unsigned)(d / bit + 0.5) * bit) / 4);
+                ++bad;
+            }
+        }
+
+        byte = 0;
+        for (b = 0; b < 8; ++b)
+            byte |= (uint8_t)(LevelAt(s + (unsigned long long)((b + 1.5) * bit)) << b);
+        if (byte != data[f] || !LevelAt(s + (unsigned long long)(9.5 * bit))) {
+            printf("FAIL: %u baud: frame %u sent as %02X, %02X expected\n", baud, f, byte, data[f]);
+            ++bad;
+        }
+        i = j;
+    }
+    _failed += (int)bad;
+    return (int)bad;
+}
+
+/**
+ * @brief Send bytes and check the waveform
+ */
+static void Transmit(const uint8_t *data, unsigned n, uint32_t baud)
+{
+    unsigned from = _nEdges, i;
+
+    for (i = 0; i < n; ++i)
+        Send(data[i]);
+    CHECK(RunIdle());
+    CheckTx(from, data, n, baud);
+}
+
+/**
+ * @brief Receive bytes from the generator and compare them
+ */
+static void Receive(const uint8_t *data, unsigned n, uint32_t baud, double skew)
+{
+    uint8_t c[MAX_FRAMES];
+    UART_Result res[MAX_FRAMES];
+    unsigned got, i;
+
+    Generate(data, NULL, n, baud, skew, 0);
+    got = RunGenerator(c, res, MAX_FRAMES);
+    if (got != n) {
+        printf("FAIL: %u baud skew %+.2f: %u bytes received, %u expected\n", baud, skew, got, n);
+        ++_failed;
+    }
+    for (i = 0; i < got && i < n; ++i) {
+        if (res[i] != UART_RESULT_OK || c[i] != data[i]) {
+            printf("FAIL: %u baud skew %+.2f: byte %u received as %02X (%d), %02X expected\n",
+                   baud, skew, i, c[i], res[i], data[i]);
+            ++_failed;
+        }
+    }
+}
+
+/**
+ * @brief Hold the bit interrupts off during a frame of the generator
+ *
+ * The frames are 0x11, 0x55, 0x33, 0x44 with two idle bits between them.
+ * The 0x55 frame must be dropped and reported as a framing error with the
+ * 0x33, and the receiver must be in step for the frames after it.
+ *
+ * @param from Start of the hold, bits from the start edge of 0x55
+ * @param len Length of the hold, bits
+ */
+static void LateRx(double from, double len)
+{
+    static const uint8_t data[4] = { 0x11, 0x55, 0x33, 0x44 };
+    UART_Result res[4];
+    uint8_t c[4];
+    double start;
+    unsigned n;
+
+    Begin(9600, 2);
+    Generate(data, NULL, 4, 9600, 0, 2);
+    start = _gStart + 12 * _gBit;
+    _blockFrom = (unsigned long long)(start + from * _gBit);
+    _blockUntil = (unsigned long long)(start + (from + len) * _gBit);
+    n = RunGenerator(c, res, 4);
+
+    if (n != 3) {
+        printf("FAIL: ISR held off %.1f-%.1f bits: %u bytes received\n", from, from + len, n);
+        ++_failed;
+        return;
+    }
+    CHECK(res[0] == UART_RESULT_OK && c[0] == 0x11);
+    CHECK(res[1] == UART_RESULT_FRAMING && c[1] == 0x33);
+    CHECK(res[2] == UART_RESULT_OK && c[2] == 0x44);
+}
+
+int main(void)
+{
+    static const uint32_t bauds[] = { 19200, 9600, 2400, 1200, 300 };
+    static const uint8_t stop[4] = { 1, 0, 1, 1 };
+    uint8_t data[MAX_FRAMES], got[4], c;
+    UART_Result res[4];
+    double bit, gap, grid;
+    unsigned long long s1;
+    unsigned i, j, k, lat, from;
+    int ok;
+
+    for (i = 0; i < MAX_FRAMES; ++i)
+        data[i] = (uint8_t)(i * 37 + (i >> 2));
+    data[0] = 0x00;
+    data[1] = 0xFF;
+    data[2] = 0x55;
+    data[3] = 0xAA;
+
+    Mock_Reset();
+    Mock_Tim1Hook = Step;
+    Sys_ClockInit();
+    Sys_TickInit();
+
+    // Invalid baud rates
+    CHECK(SUART_Init(SUART_BAUD_MIN - 1) == UART_RESULT_INVALID_PARAM);
+    CHECK(SUART_Init(SUART_BAUD_MAX + 1) == UART_RESULT_INVALID_PARAM);
+
+    // TX edges on the bit grid, RX within a 3 % baud rate error
+    for (i = 0; i < sizeof(bauds) / sizeof(bauds[0]); ++i) {
+        for (lat = 0; lat <= 5; lat += 5) {
+            Begin(bauds[i], lat);
+            CHECK(Mock_TIM1.PSCRL == 15 && Mock_Priority[ITC_IRQ_TIM1_CAPCOM] == SUART_PRIORITY);
+            Transmit(data, 16, bauds[i]);
+            Receive(data, 16, bauds[i], 0);
+            Receive(data + 16, 16, bauds[i], 0.03);
+            Receive(data + 32, 16, bauds[i], -0.03);
+        }
+    }
+
+    // Loopback: TX and RX at once on the same timer
+    for (i = 0; i < 2; ++i) {
+        Begin(i ? 2400 : 19200, 5);
+        _loop = 1;
+        for (j = 0; j < MAX_FRAMES; j += 16) {
+            from = _nEdges;
+            for (k = 0; k < 16; ++k)
+                Send(data[j + k]);
+            CHECK(RunIdle());
+            Run(US(1000));
+            CheckTx(from, data + j, 16, i ? 2400 : 19200);
+            CHECK(SUART_RxCount() == 16);
+            for (k = 0; k < 16 && SUART_RxCount() > 0; ++k)
+                CHECK(SUART_Recv(&c) == UART_RESULT_OK && c == data[j + k]);
+        }
+    }
+
+    // A stop bit of 0 drops the byte, reported with the next one
+    Begin(9600, 2);
+    Generate(data, stop, 4, 9600, 0, 2);
+    CHECK(RunGenerator(got, res, 4) == 3);
+    CHECK(res[0] == UART_RESULT_OK && got[0] == data[0]);
+    CHECK(res[1] == UART_RESULT_FRAMING && got[1] == data[2]);
+    CHECK(res[2] == UART_RESULT_OK && got[2] == data[3]);
+
+    // Bytes lost to a full buffer are reported with the next byte taken
+    Begin(19200, 2);
+    Generate(data, NULL, SUART_RX_SIZE + 2, 19200, 0, 0);
+    RunGenerator(NULL, NULL, 0);
+    CHECK(SUART_RxCount() == SUART_RX_SIZE);
+    CHECK(SUART_Recv(&c) == UART_RESULT_OVERRUN && c == data[0]);
+    for (i = 1; i < SUART_RX_SIZE; ++i)
+        CHECK(SUART_Recv(&c) == UART_RESULT_OK && c == data[i]);
+
+    // TX interrupt held off for 3 bits: the bit is stretched, the next ones
+    // keep their length on a new grid instead of waiting for a counter wrap
+    Begin(9600, 2);
+    bit = US(1000000) / 9600.0;
+    Send(0x55);
+    while (_nEdges == 0)
+        Run(1);
+    _blockFrom = _now + (unsigned long long)(2.3 * bit);
+    _blockUntil = _blockFrom + (unsigned long long)(3 * bit);
+    CHECK(RunIdle());
+    CHECK(_nEdges == 10);
+    ok = _nEdges == 10;
+    for (i = 1; ok && i < _nEdges; ++i) {
+        gap = (double)(_edge[i] - _edge[i - 1]);
+        if (gap > 4.5 * bit || gap < bit - US(1.5)) {
+            printf("FAIL: TX held off: %.1f us between edges\n", gap / 4);
+            ++_failed;
+        }
+    }
+    for (i = 0; ok && _edge[i] < _blockUntil; ++i);
+    if (ok && i < _nEdges) {
+        s1 = _edge[i];
+        CHECK(s1 - _blockUntil < US(8));
+        for (j = i; j < _nEdges; ++j) {
+            grid = (double)(_edge[j] - s1) - (j - i) * bit;
+            CHECK(Abs(grid) <= US(2) + US(_latency));
+        }
+    }
+    Transmit(data, 4, 9600);
+
+    // RX interrupts held off: one sample more than half a bit late, samples
+    // passed, the stop bit sample late, data and stop samples passed
+    LateRx(3.3, 0.8);
+    LateRx(3.2, 3.1);
+    LateRx(9.3, 1.7);
+    LateRx(8.2, 2.4);
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file timer_clock_test.c
+ * @brief Host test of the registers recomputed by Sys_ClockSet
+ *
+ * Switches through all HSI dividers and checks the TIM4 tick reload, the
+ * UART1 baud rate registers and the TIM1/TIM2 prescaler and reload values
+ * programmed by the clock hooks: the tick must stay at 1 kHz, the baud rate
+ * within 2 % and the timer periods constant in time. Periods that no longer
+ * fit the 16-bit counter must saturate.
+ *
+ * Build and run from the repository root:
+ *
+ *   cc -O2 -DUART_HW_ONLY -Itests/mock -Itimer -Iuart -Igpio -Isystem -Iinterrupt \
+ *      tests/timer_clock_test.c timer/timer.c uart/uart.c gpio/io.c system/system.c \
+ *      tests/mock/mock.c -o timer_clock_test && ./timer_clock_test
+ */
+
+#include <stdio.h>
+#include "stm8s.h"
+#include "mock.h"
+#include "io.h"
+#include "system.h"
+#include "timer.h"
+#include "uart.h"
+
+#define BAUD    9600UL
+
+IO_PIN _ios[IO_IDX_MAX] = {
+    [IOP_U1RX] = { GPIOD, GPIO_PIN_6 },
+    [IOP_U1TX] = { GPIOD, GPIO_PIN_5 },
+};
+
+static const CLK_Prescaler_TypeDef _hsiDiv[] = {
+    CLK_PRESCALER_HSIDIV1, CLK_PRESCALER_HSIDIV2,
+    CLK_PRESCALER_HSIDIV4, CLK_PRESCALER_HSIDIV8,
+};
+
+static int _failed = 0;
+
+#define CHECK(c) do { \
+    if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); ++_failed; } \
+} while (0)
+
+/**
+ * @brief Master clock cycles per TIM1 period
+ */
+static uint32_t Tim1Counts(void)
+{
+    return ((uint32_t)((TIM1->PSCRH << 8) | TIM1->PSCRL) + 1) *
+           ((uint32_t)((TIM1->ARRH << 8) | TIM1->ARRL) + 1);
+}
+
+/**
+ * @brief Master clock cycles per TIM2 period
+ */
+static uint32_t Tim2Counts(void)
+{
+    return ((uint32_t)1 << TIM2->PSCR) * ((uint32_t)((TIM2->ARRH << 8) | TIM2->ARRL) + 1);
+}
+
+/**
+ * @brief UART1 baud rate divider from BRR1/BRR2
+ */
+static uint16_t UartDiv(void)
+{
+    return (uint16_t)(((UART1->BRR2 & 0xF0) << 8) | (UART1->BRR1 << 4) | (UART1->BRR2 & 0x0F));
+}
+
+int main(void)
+{
+    uint32_t f, t1, t2;
+    unsigned i, j;
+
+    Mock_Reset();
+    Sys_ClockInit();
+    Sys_TickInit();
+    CHECK(UART_Init(UART_1, BAUD) == UART_RESULT_OK);
+
+    // TIM1: 1 ms with prescaler 16 (divisible), TIM2: 2^4 * 2000 = 2 ms
+    CHECK(Timer_Init(TIMER_1, 16, 1000, 1) == TIMER_RESULT_OK);
+    CHECK(Timer_Init(TIMER_2, 5, 2000, 1) == TIMER_RESULT_OK);
+    t1 = Tim1Counts();
+    t2 = Tim2Counts();
+    CHECK(t1 == 16000 && t2 == 32000);
+    CHECK(UartDiv() == 16000000 / BAUD);     // UART1_Init truncates
+
+    // Every divider, in both directions
+    for (j = 0; j < 2; ++j) {
+        for (i = 0; i < 4; ++i) {
+            unsigned n = j ? 3 - i : i;
+
+            CHECK(Sys_ClockSet(_hsiDiv[n], CLK_PRESCALER_CPUDIV1) == 0);
+            f = Sys_MasterClock();
+            CHECK(f == 16000000UL >> n && Mock_MasterClock() == f);
+
+            // 1 kHz tick
+            CHECK((f >> TIM4->PSCR) % 1000 == 0);
+            CHECK((f >> TIM4->PSCR) / 1000 == TIM4->ARR + 1UL);
+
+            // Baud rate within 2 %
+            CHECK(UartDiv() >= 16);
+            CHECK((f / UartDiv()) * 100 >= BAUD * 98 && (f / UartDiv()) * 100 <= BAUD * 102);
+
+            // Same time per period: counts scale with the clock
+            CHECK(Tim1Counts() * (16000000UL / f) == t1);
+            CHECK(Tim2Counts() * (16000000UL / f) == t2);
+            // TIM1 keeps its reload while the prescaler can absorb the change
+            CHECK(((TIM1->ARRH << 8) | TIM1->ARRL) == 999);
+        }
+    }
+
+    // A CPU divider leaves the peripheral clocks alone
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV1, CLK_PRESCALER_CPUDIV8) == 0);
+    CHECK(Sys_CpuClock() == 2000000 && Tim1Counts() == t1 && TIM4->ARR == 249);
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV1, (CLK_Prescaler_TypeDef)0x88) == -1);
+
+    // An odd prescaler moves the change into the period
+    CHECK(Timer_Init(TIMER_1, 5, 1000, 1) == TIMER_RESULT_OK);
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV4, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(TIM1->PSCRL == 4 && ((TIM1->ARRH << 8) | TIM1->ARRL) == 249);
+
+    // Saturation: set up at 2 MHz, then 8x faster
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV8, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(Timer_Init(TIMER_1, 40000, 60000, 1) == TIMER_RESULT_OK);
+    CHECK(Timer_Init(TIMER_2, 16, 40000, 1) == TIMER_RESULT_OK);
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV1, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(((TIM1->PSCRH << 8) | TIM1->PSCRL) == 39999);
+    CHECK(((TIM1->ARRH << 8) | TIM1->ARRL) == 0xFFFE);
+    CHECK(TIM2->PSCR == 15 && ((TIM2->ARRH << 8) | TIM2->ARRL) == 0xFFFE);
+
+    // ... and 8x slower from short periods: at least one count
+    CHECK(Timer_Init(TIMER_1, 1, 4, 1) == TIMER_RESULT_OK);
+    CHECK(Timer_Init(TIMER_2, 1, 4, 1) == TIMER_RESULT_OK);
+    CHECK(Sys_ClockSet(CLK_PRESCALER_HSIDIV8, CLK_PRESCALER_CPUDIV1) == 0);
+    CHECK(((TIM1->PSCRH << 8) | TIM1->PSCRL) == 0 && ((TIM1->ARRH << 8) | TIM1->ARRL) == 0);
+    CHECK(TIM2->PSCR == 0 && ((TIM2->ARRH << 8) | TIM2->ARRL) == 0);
+
+    if (_failed) {
+        printf("%d check(s) failed\n", _failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -11,6 +11,125 @@
 #include "stm8s_itc.h"
 #include "timer.h"
 #include "io.h"
+#include "system.h"
+#include "interrupt.h"
+
+/**
+ * @brief Timer configuration as passed to Timer_Init
+ */
+typedef struct {
+  uint16_t prescale;
+  uint16_t period;
+  uint8_t clkShift;   // Master clock was HSI_FREQUENCY >> clkShift
+  uint8_t valid;
+} TIMER_CFG;
+
+static TIMER_CFG _tmCfg[2];
+
+volatile uint32_t g_T1count = 0, g_T2count = 0;
+
+/**
+ * @brief TIM1 update interrupt handler
+ */
+static void Timer1_Isr(void)
+{
+    TIM1->SR1 = (uint8_t)~TIM1_SR1_UIF;
+    ++g_T1count;
+}
+
+/**
+ * @brief TIM2 update interrupt handler
+ */
+static void Timer2_Isr(void)
+{
+    TIM2->SR1 = (uint8_t)~TIM2_SR1_UIF;
+    ++g_T2count;
+}
+
+/**
+ * @brief Get the HSI divider exponent for a master clock
+ *
+ * @param fMaster Master clock in Hz
+ * @return uint8_t k such that fMaster == HSI_FREQUENCY >> k
+ */
+static uint8_t Timer_ClockShift(uint32_t fMaster)
+{
+    uint8_t k = 0;
+    while (k < 3 && (HSI_FREQUENCY >> k) > fMaster)
+        ++k;
+    return k;
+}
+
+/**
+ * @brief Scale a timer period by a power of two
+ *
+ * @param per Period in counts
+ * @param n Exponent, negative to divide
+ * @return uint16_t Scaled period, saturated to 1..0xFFFF
+ */
+static uint16_t Timer_ScalePeriod(uint16_t per, int8_t n)
+{
+    uint32_t p = n >= 0 ? (uint32_t)per << n : (uint32_t)per >> -n;
+
+    if (p == 0)
+        return 1;
+    if (p > 0xFFFF)
+        return 0xFFFF;
+    return (uint16_t)p;
+}
+
+/**
+ * @brief Clock change hook, keeps timer periods constant in time
+ *
+ * The prescaler absorbs the change as far as it can, so compare values stay
+ * valid; the rest is applied to the period. A period that no longer fits
+ * the counter saturates, so the timer runs as close to its rate as it can.
+ *
+ * @param fMaster New master clock in Hz
+ */
+static void Timer_ClockChanged(uint32_t fMaster)
+{
+    uint8_t k = Timer_ClockShift(fMaster);
+    int8_t d;
+    uint16_t psc, per;
+    uint8_t e;
+
+    if (_tmCfg[TIMER_1].valid) {
+        // Clock is 2^d times slower (d < 0: faster) than at Timer_Init
+        d = (int8_t)(k - _tmCfg[TIMER_1].clkShift);
+        psc = _tmCfg[TIMER_1].prescale;
+        per = _tmCfg[TIMER_1].period;
+        while (d > 0 && !(psc & 1)) {
+            psc >>= 1;
+            --d;
+        }
+        while (d < 0 && psc <= 0x7FFF) {
+            psc <<= 1;
+            ++d;
+        }
+        per = Timer_ScalePeriod(per, (int8_t)-d);
+        TIM1_PrescalerConfig(psc - 1, TIM1_PSCRELOADMODE_IMMEDIATE);
+        TIM1_SetAutoreload(per - 1);
+    }
+
+    if (_tmCfg[TIMER_2].valid) {
+        // TIM2 prescaler is a power of two, 2^(prescale - 1)
+        d = (int8_t)(k - _tmCfg[TIMER_2].clkShift);
+        e = (uint8_t)(_tmCfg[TIMER_2].prescale - 1);
+        per = _tmCfg[TIMER_2].period;
+        if (d > e) {
+            per = Timer_ScalePeriod(per, (int8_t)(e - d));
+            e = 0;
+        } else if (e - d > 15) {
+            per = Timer_ScalePeriod(per, (int8_t)(e - d - 15));
+            e = 15;
+        } else {
+            e = (uint8_t)(e - d);
+        }
+        TIM2_PrescalerConfig((TIM2_Prescaler_TypeDef)e, TIM2_PSCRELOADMODE_IMMEDIATE);
+        TIM2_SetAutoreload(per - 1);
+    }
+}
 
 /**
  * @brief Initialize a timer
@@ -23,6 +142,10 @@
  */
 TIMER_Result Timer_Init(TIMER_IDX tmNo, uint16_t prescale, uint16_t period, uint8_t repeat)
 {
+    if (Sys_ClockRegister(Timer_ClockChanged) != 0) {
+        return TIMER_RESULT_ERROR;
+    }
+
     switch(tmNo)
     {
     case TIMER_1:
@@ -38,6 +161,11 @@ TIMER_Result Timer_Init(TIMER_IDX tmNo, uint16_t prescale, uint16_t period, uint
         return TIMER_RESULT_INVALID_TIMER;
     }
     
+    _tmCfg[tmNo].prescale = prescale;
+    _tmCfg[tmNo].period = period;
+    _tmCfg[tmNo].clkShift = Timer_ClockShift(Sys_MasterClock());
+    _tmCfg[tmNo].valid = 1;
+    
     Timer_Reset(tmNo);
     return TIMER_RESULT_OK;
 }
@@ -126,11 +254,13 @@ TIMER_Result TimerIntConfig(TIMER_IDX tmNo, uint8_t priority)
     switch(tmNo)
     {
     case TIMER_1:
+        IRQ_Register(IRQ_TIM1_UPD, Timer1_Isr);
         TIM1_ClearITPendingBit(TIM1_IT_UPDATE);
         TIM1_ITConfig(TIM1_IT_UPDATE, ENABLE);
         ITC_SetSoftwarePriority(ITC_IRQ_TIM1_OVF, (ITC_PriorityLevel_TypeDef)priority);
         break;
     case TIMER_2:
+        IRQ_Register(IRQ_TIM2_UPD, Timer2_Isr);
         TIM2_ClearITPendingBit(TIM2_IT_UPDATE);
         TIM2_ITConfig(TIM2_IT_UPDATE, ENABLE);
         ITC_SetSoftwarePriority(ITC_IRQ_TIM2_OVF, (ITC_PriorityLevel_TypeDef)priority);
@@ -40,7 +40,8 @@ typedef enum {
 /**
  * @brief Timer counter variables
  * 
- * These variables are incremented in the respective timer interrupt handlers.
+ * These variables are incremented in the respective timer update interrupt
+ * handlers, enabled with TimerIntConfig.
  */
 extern volatile uint32_t g_T1count, g_T2count;
 
@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""
+@file boot_sim.py
+@brief Simulated bootloader target for host-side tests
+
+Serves the bootloader protocol (boot/boot.h) on a pseudo-terminal with the
+program memory held in a file, following boot.c step by step: the sync window
+after reset, byte timeouts, draining after a bad frame, the descriptor erase
+before the first block and the verification in BOOT_CMD_DONE. A jump to the
+application ends the simulation with exit status 0.
+
+  python3 tools/boot_sim.py --link /tmp/stm8boot --flash flash.bin &
+  python3 tools/boot_upload.py /tmp/stm8boot app.bin --run
+
+--noise N flips a bit in every Nth received byte to exercise the retries.
+"""
+
+import argparse
+import os
+import select
+import sys
+import termios
+import time
+import tty
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from boot_upload import (BOOT_APP_ADDR, BOOT_INFO_ADDR, BOOT_BLOCK_SIZE,
+                         BOOT_BYTE_MS, BOOT_SYNC_BYTE, BOOT_SOF, BOOT_ACK,
+                         BOOT_NAK, BOOT_CMD_SYNC, BOOT_CMD_WRITE,
+                         BOOT_CMD_DONE, BOOT_CMD_RUN, RESULTS, crc16)
+
+FLASH_START = 0x8000
+FLASH_SIZE = 8192
+BOOT_WAIT_MS = 500
+BOOT_MAGIC = 0xB007
+BOOT_APP_BLOCKS = (BOOT_INFO_ADDR - BOOT_APP_ADDR) // BOOT_BLOCK_SIZE
+
+(OK, INVALID_PARAM, TIMEOUT, CRC, UART, FLASH, NO_APP, ERROR) = range(8)
+
+
+class Timeout(Exception):
+    pass
+
+
+class Target:
+    def __init__(self, fd, flash, noise=0, verbose=False):
+        self.fd = fd
+        self.flash = flash
+        self.noise = noise
+        self.verbose = verbose
+        self.count = 0
+        self.erased = False
+
+    def log(self, msg):
+        if self.verbose:
+            print("sim: " + msg, file=sys.stderr)
+
+    def getc(self, ms):
+        """Boot_Getc: one byte, Timeout after ms (None waits forever)."""
+        r, _, _ = select.select([self.fd], [], [], None if ms is None else ms / 1000.0)
+        if not r:
+            raise Timeout()
+        try:
+            c = os.read(self.fd, 1)
+        except OSError:
+            c = b""
+        if not c:
+            # Host closed the port; wait for the next one to open it
+            time.sleep(0.05)
+            return self.getc(ms)
+        self.count += 1
+        if self.noise and self.count % self.noise == 0:
+            return c[0] ^ 0x10
+        return c[0]
+
+    def send(self, *data):
+        os.write(self.fd, bytes(data))
+
+    def drain(self):
+        try:
+            while True:
+                self.getc(BOOT_BYTE_MS)
+        except Timeout:
+            pass
+
+    def recv_frame(self):
+        """Boot_RecvFrame: return (result, cmd, payload)."""
+        while True:
+            c = self.getc(None)
+            if c == BOOT_SOF:
+                break
+            if c == BOOT_SYNC_BYTE:
+                self.send(BOOT_ACK)
+        try:
+            hdr = bytes([self.getc(BOOT_BYTE_MS), self.getc(BOOT_BYTE_MS)])
+            if hdr[1] > BOOT_BLOCK_SIZE + 1:
+                return INVALID_PARAM, 0, b""
+            payload = bytes(self.getc(BOOT_BYTE_MS) for _ in range(hdr[1]))
+            crc = self.getc(BOOT_BYTE_MS)
+            crc |= self.getc(BOOT_BYTE_MS) << 8
+        except Timeout:
+            return TIMEOUT, 0, b""
+        if crc16(payload, crc16(hdr)) != crc:
+            return CRC, 0, b""
+        return OK, hdr[0], payload
+
+    def program(self, addr, data):
+        """Boot_Program: a block operation always leaves exactly data."""
+        ofs = addr - FLASH_START
+        self.flash[ofs:ofs + BOOT_BLOCK_SIZE] = data or bytes(BOOT_BLOCK_SIZE)
+        return OK
+
+    def read16(self, addr):
+        """A uint16_t in flash: the STM8 is big-endian."""
+        ofs = addr - FLASH_START
+        return (self.flash[ofs] << 8) | self.flash[ofs + 1]
+
+    def image_crc(self, length):
+        ofs = BOOT_APP_ADDR - FLASH_START
+        return crc16(self.flash[ofs:ofs + length])
+
+    def check_app(self):
+        """Boot_CheckApp."""
+        magic, length, crc, ncrc = (self.read16(BOOT_INFO_ADDR + 2 * i) for i in range(4))
+        if (magic != BOOT_MAGIC or crc != (~ncrc & 0xFFFF) or length == 0 or
+                length > BOOT_APP_BLOCKS * BOOT_BLOCK_SIZE):
+            return NO_APP
+        if self.image_crc(length) != crc:
+            return CRC
+        return OK
+
+    def command(self, cmd, p):
+        """Boot_Command."""
+        if cmd in (BOOT_CMD_SYNC, BOOT_CMD_RUN):
+            if p:
+                return INVALID_PARAM
+            return self.check_app() if cmd == BOOT_CMD_RUN else OK
+
+        if cmd == BOOT_CMD_WRITE:
+            if len(p) != BOOT_BLOCK_SIZE + 1 or p[0] >= BOOT_APP_BLOCKS:
+                return INVALID_PARAM
+            if not self.erased:
+                self.program(BOOT_INFO_ADDR, None)
+                self.erased = True
+            return self.program(BOOT_APP_ADDR + p[0] * BOOT_BLOCK_SIZE, p[1:])
+
+        if cmd == BOOT_CMD_DONE:
+            if len(p) != 4:
+                return INVALID_PARAM
+            length = p[0] | (p[1] << 8)
+            crc = p[2] | (p[3] << 8)
+            if length == 0 or length > BOOT_APP_BLOCKS * BOOT_BLOCK_SIZE:
+                return INVALID_PARAM
+            if self.image_crc(length) != crc:
+                return CRC
+            info = bytearray(BOOT_BLOCK_SIZE)
+            # BOOT_Info as the big-endian target stores it
+            for i, v in enumerate((BOOT_MAGIC, length, crc, ~crc & 0xFFFF)):
+                info[2 * i:2 * i + 2] = v.to_bytes(2, "big")
+            self.program(BOOT_INFO_ADDR, bytes(info))
+            self.erased = False
+            return self.check_app()
+
+        return INVALID_PARAM
+
+    def run(self, hold):
+        """Boot_Main: return when the application would be started."""
+        try:
+            c = self.getc(None if hold else BOOT_WAIT_MS)
+        except Timeout:
+            c = None
+        if c == BOOT_SYNC_BYTE:
+            self.send(BOOT_ACK)
+        elif self.check_app() == OK:
+            self.log("no host, starting the application")
+            return
+
+        while True:
+            r, cmd, p = self.recv_frame()
+            if r == OK:
+                r = self.command(cmd, p)
+            else:
+                self.drain()
+            self.log("cmd %d len %d: %s" % (cmd, len(p), RESULTS[r]))
+            self.send(BOOT_ACK if r == OK else BOOT_NAK, r)
+            if r == OK and cmd == BOOT_CMD_RUN:
+                self.log("starting the application")
+                return
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Simulated bootloader target")
+    ap.add_argument("-f", "--flash", help="program memory file (8 KiB), "
+                    "created if missing and saved on exit")
+    ap.add_argument("-l", "--link", help="create a symlink to the pty here")
+    ap.add_argument("-n", "--noise", type=int, default=0,
+                    help="corrupt every Nth received byte")
+    ap.add_argument("--hold", action="store_true",
+                    help="wait for the host indefinitely after reset")
+    ap.add_argument("-v", "--verbose", action="store_true")
+    args = ap.parse_args()
+
+    flash = bytearray(FLASH_SIZE)
+    if args.flash and os.path.exists(args.flash):
+        with open(args.flash, "rb") as f:
+            flash[:] = f.read().ljust(FLASH_SIZE, b"\0")[:FLASH_SIZE]
+
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    path = os.ttyname(slave)
+    if args.link:
+        if os.path.lexists(args.link):
+            os.unlink(args.link)
+        os.symlink(path, args.link)
+    print(path, flush=True)
+
+    target = Target(master, flash, args.noise, args.verbose)
+    try:
+        target.run(args.hold)
+        # Let the last reply reach the host
+        termios.tcdrain(master)
+        time.sleep(0.1)
+    finally:
+        if args.flash:
+            with open(args.flash, "wb") as f:
+                f.write(flash)
+        if args.link:
+            os.unlink(args.link)
+        os.close(slave)
+        os.close(master)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        sys.exit(1)
@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""
+@file boot_upload.py
+@brief Host uploader for the UART bootloader (boot/boot.h)
+
+Sends an application image to the bootloader block by block, then the image
+length and CRC, and optionally starts it. The image is a raw binary linked at
+BOOT_APP_ADDR, an Intel HEX file (.hex, .ihx) or a Motorola S-record file
+(.s19, .s37, .srec). Only the standard library is used; the serial port is
+configured through termios, so this runs on Linux and macOS.
+
+Reset the target after starting the uploader: it keeps sending the sync byte
+until the bootloader answers within its BOOT_WAIT_MS window.
+
+  python3 tools/boot_upload.py /dev/ttyUSB0 app.ihx --run
+"""
+
+import argparse
+import os
+import select
+import sys
+import termios
+import time
+
+# Keep in sync with boot/boot.h
+BOOT_APP_ADDR = 0x8800
+BOOT_INFO_ADDR = 0xA000 - 64
+BOOT_BLOCK_SIZE = 64
+BOOT_BAUD = 115200
+BOOT_BYTE_MS = 100
+
+BOOT_SYNC_BYTE = 0x7F
+BOOT_SOF = 0x5A
+BOOT_ACK = 0x79
+BOOT_NAK = 0x1F
+
+BOOT_CMD_SYNC = 0x01
+BOOT_CMD_WRITE = 0x02
+BOOT_CMD_DONE = 0x03
+BOOT_CMD_RUN = 0x04
+
+RESULTS = ["OK", "INVALID_PARAM", "TIMEOUT", "CRC", "UART", "FLASH",
+           "NO_APP", "ERROR"]
+
+# A line error can also corrupt the length and come back as INVALID_PARAM, so
+# every NAK is retried a few times
+RETRIES = 5
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT as Sys_Crc16 (poly 0x1021, no reflection)."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def frame(cmd, payload=b""):
+    """Build a frame: SOF cmd len payload crcL crcH."""
+    hdr = bytes([cmd, len(payload)])
+    crc = crc16(payload, crc16(hdr))
+    return bytes([BOOT_SOF]) + hdr + payload + bytes([crc & 0xFF, crc >> 8])
+
+
+def load_image(path, base=BOOT_APP_ADDR):
+    """Load an image and return its bytes from base, gaps filled with 0."""
+    with open(path, "rb") as f:
+        raw = f.read()
+
+    ext = os.path.splitext(path)[1].lower()
+    if ext not in (".hex", ".ihx", ".s19", ".s28", ".s37", ".srec", ".mot"):
+        return raw
+
+    mem = {}
+    upper = 0
+    for n, line in enumerate(raw.decode("ascii").splitlines(), 1):
+        line = line.strip()
+        if not line:
+            continue
+        try:
+            if line[0] == ":":
+                rec = bytes.fromhex(line[1:])
+                if sum(rec) & 0xFF:
+                    raise ValueError("checksum")
+                cnt, addr, typ = rec[0], (rec[1] << 8) | rec[2], rec[3]
+                data = rec[4:4 + cnt]
+                if typ == 0:
+                    for i, b in enumerate(data):
+                        mem[upper + addr + i] = b
+                elif typ == 2:
+                    upper = ((data[0] << 8) | data[1]) << 4
+                elif typ == 4:
+                    upper = ((data[0] << 8) | data[1]) << 16
+            elif line[0] == "S":
+                typ = line[1]
+                rec = bytes.fromhex(line[2:])
+                if (sum(rec) & 0xFF) != 0xFF:
+                    raise ValueError("checksum")
+                alen = {"1": 2, "2": 3, "3": 4}.get(typ)
+                if alen:
+                    addr = int.from_bytes(rec[1:1 + alen], "big")
+                    for i, b in enumerate(rec[1 + alen:-1]):
+                        mem[addr + i] = b
+            else:
+                raise ValueError("unknown record")
+        except (ValueError, IndexError) as e:
+            raise SystemExit("%s:%d: bad record (%s)" % (path, n, e))
+
+    if not mem:
+        raise SystemExit("%s: no data" % path)
+    lo, hi = min(mem), max(mem)
+    if lo < base or hi >= BOOT_INFO_ADDR:
+        raise SystemExit("%s: data at 0x%X-0x%X outside 0x%X-0x%X"
+                         % (path, lo, hi, base, BOOT_INFO_ADDR - 1))
+    return bytes(mem.get(a, 0) for a in range(base, hi + 1))
+
+
+class Port:
+    """Raw serial port (or pty) with byte timeouts."""
+
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        attr = termios.tcgetattr(self.fd)
+        attr[0] = 0                                     # iflag
+        attr[1] = 0                                     # oflag
+        attr[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attr[3] = 0                                     # lflag
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is None:
+            raise SystemExit("unsupported baud rate %d" % baud)
+        attr[4] = attr[5] = speed
+        attr[6][termios.VMIN] = 0
+        attr[6][termios.VTIME] = 0
+        termios.tcsetattr(self.fd, termios.TCSANOW, attr)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+
+    def write(self, data):
+        os.write(self.fd, data)
+
+    def read(self, n, timeout):
+        """Read up to n bytes, give up after timeout seconds of silence."""
+        out = b""
+        while len(out) < n:
+            r, _, _ = select.select([self.fd], [], [], timeout)
+            if not r:
+                break
+            try:
+                chunk = os.read(self.fd, n - len(out))
+            except OSError:
+                break
+            if not chunk:
+                break
+            out += chunk
+        return out
+
+    def flush_input(self):
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+
+    def close(self):
+        os.close(self.fd)
+
+
+class Uploader:
+    def __init__(self, port, verbose=False):
+        self.port = port
+        self.verbose = verbose
+
+    def connect(self, wait):
+        """Send sync bytes until the bootloader acknowledges one."""
+        end = time.monotonic() + wait
+        while time.monotonic() < end:
+            self.port.write(bytes([BOOT_SYNC_BYTE]))
+            if BOOT_ACK in self.port.read(1, 0.05):
+                # Let further ACKs for queued sync bytes arrive, then drop them
+                time.sleep(BOOT_BYTE_MS / 1000.0)
+                self.port.flush_input()
+                return
+        raise SystemExit("no answer from the bootloader (reset the target)")
+
+    def command(self, cmd, payload=b"", timeout=1.0):
+        """Send a frame and return the result, resending on line errors."""
+        for attempt in range(RETRIES):
+            self.port.write(frame(cmd, payload))
+            reply = self.port.read(2, timeout)
+            if len(reply) == 2 and reply[0] in (BOOT_ACK, BOOT_NAK):
+                res = reply[1]
+                if reply[0] == BOOT_ACK:
+                    return res
+            else:
+                res = 2
+            if self.verbose:
+                print("cmd %d: %s, retrying" % (cmd, name(res)), file=sys.stderr)
+            # The target drains until the line is idle before replying
+            time.sleep(2 * BOOT_BYTE_MS / 1000.0)
+            self.port.flush_input()
+        return res
+
+    def upload(self, image, run):
+        nblocks = (len(image) + BOOT_BLOCK_SIZE - 1) // BOOT_BLOCK_SIZE
+        if not image or BOOT_APP_ADDR + nblocks * BOOT_BLOCK_SIZE > BOOT_INFO_ADDR:
+            raise SystemExit("image size %d out of range" % len(image))
+        check(self.command(BOOT_CMD_SYNC), "sync")
+
+        t0 = time.monotonic()
+        for i in range(nblocks):
+            blk = image[i * BOOT_BLOCK_SIZE:(i + 1) * BOOT_BLOCK_SIZE]
+            blk = blk.ljust(BOOT_BLOCK_SIZE, b"\0")
+            check(self.command(BOOT_CMD_WRITE, bytes([i]) + blk), "block %d" % i)
+            print("\rwriting %d/%d" % (i + 1, nblocks), end="", file=sys.stderr)
+        print(file=sys.stderr)
+
+        crc = crc16(image)
+        check(self.command(BOOT_CMD_DONE, len(image).to_bytes(2, "little") +
+                           crc.to_bytes(2, "little")), "verify")
+        print("%d bytes, CRC 0x%04X, %.1f s" % (len(image), crc,
+                                               time.monotonic() - t0))
+        if run:
+            check(self.command(BOOT_CMD_RUN), "run")
+
+
+def name(res):
+    return RESULTS[res] if res < len(RESULTS) else "0x%02X" % res
+
+
+def check(res, what):
+    if res != 0:
+        raise SystemExit("%s failed: %s" % (what, name(res)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[2].strip())
+    ap.add_argument("port", help="serial port, e.g. /dev/ttyUSB0")
+    ap.add_argument("image", help="raw binary linked at 0x%X, Intel HEX or "
+                    "S-record file" % BOOT_APP_ADDR)
+    ap.add_argument("-b", "--baud", type=int, default=BOOT_BAUD)
+    ap.add_argument("-w", "--wait", type=float, default=30.0,
+                    help="seconds to wait for the bootloader (default 30)")
+    ap.add_argument("-r", "--run", action="store_true",
+                    help="start the application afterwards")
+    ap.add_argument("-v", "--verbose", action="store_true")
+    args = ap.parse_args()
+
+    image = load_image(args.image)
+    port = Port(args.port, args.baud)
+    try:
+        up = Uploader(port, args.verbose)
+        up.connect(args.wait)
+        up.upload(image, args.run)
+    finally:
+        port.close()
+
+
+if __name__ == "__main__":
+    main()
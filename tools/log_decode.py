@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""
+@file log_decode.py
+@brief Decode the binary log stream (log/log.h) on the host
+
+Reads the stream from a serial port, a capture file or stdin, looks each
+message ID up in the string table from log_strings.py (or directly in the
+firmware's ELF or Intel HEX file) and prints the messages in the format of
+the target's text mode. Bytes outside of records are passed through, so
+other console output stays visible.
+
+  python3 tools/log_decode.py app.elf /dev/ttyUSB0 -b 115200
+  python3 tools/log_decode.py app.log capture.bin
+"""
+
+import argparse
+import bisect
+import os
+import re
+import sys
+import termios
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from log_strings import load_table
+
+# Keep in sync with log/log.h
+LOG_SYNC1 = 0xA5
+LOG_SYNC2 = 0xC3
+LOG_MAX_ARGS = 3
+LEVELS = "DIWE"
+
+CONV = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|l)?([diouxXc%])")
+
+
+def format16(fmt, args):
+    """printf with the target's 16-bit int arguments."""
+    args = list(args)
+
+    def conv(m):
+        flags, width, prec, c = m.groups()
+        if c == "%":
+            return "%"
+        v = args.pop(0) if args else 0
+        if c in "di":
+            v = v - 0x10000 if v & 0x8000 else v
+        elif c == "c":
+            return ("%" + flags.replace("0", "") + width + "s") % chr(v & 0xFF)
+        spec = "%" + flags + width + ("." + prec if prec else "") + ("d" if c in "iu" else c)
+        return spec % v
+
+    return CONV.sub(conv, fmt)
+
+
+class Decoder:
+    def __init__(self, table, out):
+        self.table = table
+        self.addrs = sorted(table)
+        self.out = out
+        self.buf = bytearray()
+
+    def lookup(self, ident):
+        """Format string at ident, also inside a string merged by the linker."""
+        if ident in self.table:
+            return self.table[ident]
+        i = bisect.bisect_right(self.addrs, ident) - 1
+        if i >= 0:
+            base = self.addrs[i]
+            s = self.table[base]
+            if ident - base < len(s):
+                return s[ident - base:]
+        return None
+
+    def message(self, ident, level, args):
+        if ident == 0 and len(args) == 1:
+            text = "%u log entries dropped" % args[0]
+        else:
+            fmt = self.lookup(ident)
+            if fmt is None:
+                text = "<unknown 0x%04X>" % ident + "".join(" 0x%04X" % a for a in args)
+            else:
+                text = format16(fmt, args)
+        self.out.write("[%s] %s\n" % (LEVELS[level], text))
+
+    def feed(self, data):
+        """Decode what is complete, keep the rest for the next call."""
+        b = self.buf
+        b += data
+        i = 0
+        while i < len(b):
+            if b[i] != LOG_SYNC1:
+                self.passthrough(b[i])
+                i += 1
+                continue
+            if i + 1 >= len(b):
+                break
+            if b[i + 1] != LOG_SYNC2:
+                self.passthrough(b[i])
+                i += 1
+                continue
+            if i + 5 > len(b):
+                break
+            info = b[i + 4]
+            n = info >> 4
+            if n > LOG_MAX_ARGS or info & 0x0C:
+                self.passthrough(b[i])
+                i += 1
+                continue
+            if i + 5 + 2 * n > len(b):
+                break
+            ident = b[i + 2] | (b[i + 3] << 8)
+            args = [b[i + 5 + 2 * k] | (b[i + 6 + 2 * k] << 8) for k in range(n)]
+            self.message(ident, info & 0x03, args)
+            i += 5 + 2 * n
+        del b[:i]
+        self.out.flush()
+
+    def passthrough(self, c):
+        if 0x20 <= c < 0x7F or c == 0x0A or c == 0x09:
+            self.out.write(chr(c))
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer.fileno()
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        attr = termios.tcgetattr(fd)
+        attr[0] = attr[1] = attr[3] = 0
+        attr[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is None:
+            raise SystemExit("unsupported baud rate %d" % baud)
+        attr[4] = attr[5] = speed
+        attr[6][termios.VMIN] = 1
+        attr[6][termios.VTIME] = 0
+        termios.tcsetattr(fd, termios.TCSANOW, attr)
+    return fd
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Decode the binary log stream")
+    ap.add_argument("table", help="table from log_strings.py, or the firmware's "
+                    "ELF or Intel HEX file")
+    ap.add_argument("input", nargs="?", default="-",
+                    help="serial port or capture file (default stdin)")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    args = ap.parse_args()
+
+    dec = Decoder(load_table(args.table), sys.stdout)
+    fd = open_input(args.input, args.baud)
+    try:
+        while True:
+            data = os.read(fd, 256)
+            if not data:
+                break
+            dec.feed(data)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
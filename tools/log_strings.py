@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+@file log_strings.py
+@brief Extract the log message table from a firmware image
+
+In binary mode the logger (log/log.h) sends the address of the format string
+as the message ID. This script collects the NUL-terminated strings in the
+loaded sections of an ELF file (or the data of an Intel HEX file) and writes
+one line per string:
+
+  <address in hex> TAB <string with C escapes>
+
+log_decode.py reads this table, or the image itself.
+
+  python3 tools/log_strings.py app.elf > app.log
+"""
+
+import argparse
+import struct
+import sys
+
+MIN_LEN = 2
+
+
+def load_elf(data):
+    """Return [(address, bytes)] for the allocated PROGBITS sections."""
+    if data[:4] != b"\x7fELF":
+        raise ValueError("not an ELF file")
+    is64 = data[4] == 2
+    end = "<" if data[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(end + "Q", data, 0x28)
+        shentsize, shnum = struct.unpack_from(end + "HH", data, 0x3A)
+        fmt = end + "IIQQQQ"
+    else:
+        shoff, = struct.unpack_from(end + "I", data, 0x20)
+        shentsize, shnum = struct.unpack_from(end + "HH", data, 0x2E)
+        fmt = end + "IIIIII"
+
+    out = []
+    for i in range(shnum):
+        _, typ, flags, addr, off, size = struct.unpack_from(fmt, data, shoff + i * shentsize)
+        if typ == 1 and flags & 2 and size:     # SHT_PROGBITS, SHF_ALLOC
+            out.append((addr, data[off:off + size]))
+    return out
+
+
+def load_hex(text):
+    """Return [(address, bytes)] for the contiguous runs of an Intel HEX file."""
+    mem = {}
+    upper = 0
+    for line in text.splitlines():
+        line = line.strip()
+        if not line.startswith(":"):
+            continue
+        rec = bytes.fromhex(line[1:])
+        cnt, addr, typ = rec[0], (rec[1] << 8) | rec[2], rec[3]
+        if typ == 0:
+            for i, b in enumerate(rec[4:4 + cnt]):
+                mem[upper + addr + i] = b
+        elif typ == 2:
+            upper = ((rec[4] << 8) | rec[5]) << 4
+        elif typ == 4:
+            upper = ((rec[4] << 8) | rec[5]) << 16
+
+    out = []
+    for a in sorted(mem):
+        if out and out[-1][0] + len(out[-1][1]) == a:
+            out[-1][1].append(mem[a])
+        else:
+            out.append((a, bytearray([mem[a]])))
+    return [(a, bytes(b)) for a, b in out]
+
+
+def load_image(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] == b"\x7fELF":
+        return load_elf(data)
+    return load_hex(data.decode("ascii"))
+
+
+def printable(b):
+    return 0x20 <= b < 0x7F or b in (0x09, 0x0A, 0x0D)
+
+
+def strings(sections, min_len=MIN_LEN):
+    """Yield (address, string) for every printable NUL-terminated string."""
+    for base, data in sections:
+        start = 0
+        for i, b in enumerate(data):
+            if b == 0:
+                if i - start >= min_len:
+                    yield base + start, data[start:i].decode("ascii")
+                start = i + 1
+            elif not printable(b):
+                start = i + 1
+
+
+def escape(s):
+    return (s.replace("\\", "\\\\").replace("\n", "\\n").replace("\r", "\\r")
+            .replace("\t", "\\t"))
+
+
+def unescape(s):
+    out, i = [], 0
+    while i < len(s):
+        c = s[i]
+        if c == "\\" and i + 1 < len(s):
+            i += 1
+            c = {"n": "\n", "r": "\r", "t": "\t"}.get(s[i], s[i])
+        out.append(c)
+        i += 1
+    return "".join(out)
+
+
+def load_table(path):
+    """Read a table written by this script, or extract it from an image."""
+    with open(path, "rb") as f:
+        head = f.read(4)
+    if head == b"\x7fELF" or head[:1] == b":":
+        return dict(strings(load_image(path)))
+
+    table = {}
+    with open(path) as f:
+        for line in f:
+            addr, _, s = line.rstrip("\n").partition("\t")
+            table[int(addr, 16)] = unescape(s)
+    return table
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Extract log format strings")
+    ap.add_argument("image", help="ELF or Intel HEX file of the firmware")
+    ap.add_argument("-m", "--min-len", type=int, default=MIN_LEN,
+                    help="shortest string to list (default %d)" % MIN_LEN)
+    args = ap.parse_args()
+
+    for addr, s in strings(load_image(args.image), args.min_len):
+        sys.stdout.write("%04x\t%s\n" % (addr, escape(s)))
+
+
+if __name__ == "__main__":
+    main()
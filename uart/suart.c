@@ -0,0 +1,362 @@
+/**
+ * @file suart.c
+ * @brief Software UART implementation for STM8S003F3
+ *
+ * This file contains the implementation of the software UART functions.
+ *
+ * Bit times are kept in 1/256 timer ticks and accumulated, so the rounding
+ * of the bit time never adds up over a frame. TX drives the pin from the
+ * channel 1 compare interrupt at every bit boundary. RX arms on the falling
+ * edge of the start bit, then samples each bit from the channel 2 compare
+ * interrupt at its center; the start bit interrupt stays disabled until the
+ * stop bit has been sampled. Both directions run independently, and the
+ * CPU only spends a short interrupt per bit.
+ *
+ * A bit interrupt delayed past the next bit time would otherwise wait for
+ * the 16-bit counter to wrap (65 ms). TX then stretches the previous bit and
+ * restarts the bit timing at the late edge. RX skips the samples that have
+ * passed, so it stays aligned to the frame and catches the next start bit,
+ * and drops the byte as a framing error; so does a sample taken more than
+ * half a bit late.
+ */
+
+#include "stm8s.h"
+#include "stm8s_itc.h"
+#include "suart.h"
+#include "io.h"
+#include "timer.h"
+#include "system.h"
+#include "interrupt.h"
+#include "spsc.h"
+
+/**
+ * @brief Bit timer frequency in Hz
+ */
+#define SUART_TICK_HZ       1000000UL
+
+/**
+ * @brief Ticks from the start edge to start bit interrupt entry
+ */
+#define SUART_RX_LATENCY    2
+
+/**
+ * @brief Delay before the first TX bit after the transmitter was idle
+ */
+#define SUART_TX_KICK       10
+
+/**
+ * @brief Minimum lead of a compare over the counter, ticks
+ */
+#define SUART_T_MARGIN      5
+
+SPSC_DEFINE(SUART_TxBuf, uint8_t, SUART_TX_SIZE)
+SPSC_DEFINE(SUART_RxBuf, uint8_t, SUART_RX_SIZE)
+
+static SUART_TxBuf_t _txq;
+static SUART_RxBuf_t _rxq;
+
+static uint32_t _bitQ8;               // Bit time, 1/256 ticks (> 16 bits below 3907 baud)
+static volatile uint8_t _txBusy = 0;
+static uint8_t _txBit;                // 0: start bit next, 1-8: data, 9: stop
+static uint8_t _txByte;
+static uint32_t _tTx;                 // Next TX edge, 1/256 ticks
+static uint8_t _rxBit;
+static uint8_t _rxByte;
+static uint8_t _rxBad;                // Sample missed or late in this frame
+static uint32_t _tRx;                 // Next RX sample, 1/256 ticks
+static volatile uint8_t _rxFe = 0, _rxOvr = 0;  // Error counts (ISR)
+static uint8_t _seenFe = 0, _seenOvr = 0;       // Counts already reported
+
+static GPIO_TypeDef *_txPort, *_rxPort;
+static uint8_t _txPin, _rxPin;
+
+/**
+ * @brief Read the bit timer
+ *
+ * @return uint16_t Counter in ticks
+ */
+static uint16_t SUART_Now(void)
+{
+    // Reading CNTRH latches CNTRL
+    uint8_t h = TIM1->CNTRH;
+    return (uint16_t)(((uint16_t)h << 8) | TIM1->CNTRL);
+}
+
+/**
+ * @brief Check if a bit time has passed or is too close to be armed
+ *
+ * @param t Bit time, 1/256 ticks
+ * @return uint8_t 1 if a compare at t would not match before a counter wrap
+ */
+static uint8_t SUART_Passed(uint32_t t)
+{
+    return (int16_t)((uint16_t)(t >> 8) - (uint16_t)(SUART_Now() + SUART_T_MARGIN)) < 0;
+}
+
+/**
+ * @brief Get the port index (0: GPIOA ... 4: GPIOE) of a GPIO port
+ *
+ * @param port GPIO port
+ * @return uint8_t Port index, 0xFF if the port has no external interrupt
+ */
+static uint8_t SUART_PortIndex(GPIO_TypeDef *port)
+{
+    if (port == GPIOA) return 0;
+    if (port == GPIOB) return 1;
+    if (port == GPIOC) return 2;
+    if (port == GPIOD) return 3;
+    if (port == GPIOE) return 4;
+    return 0xFF;
+}
+
+/**
+ * @brief Initialize the pins, TIM1 and the start bit interrupt
+ *
+ * @param baud Baud rate (SUART_BAUD_MIN to SUART_BAUD_MAX)
+ * @return UART_Result Result of the operation
+ */
+UART_Result SUART_Init(uint32_t baud)
+{
+    uint32_t f = Sys_MasterClock();
+    uint8_t p;
+
+    if (baud < SUART_BAUD_MIN || baud > SUART_BAUD_MAX) {
+        return UART_RESULT_INVALID_PARAM;
+    }
+
+    _txPort = _ios[IOP_U2TX].port;
+    _txPin = (uint8_t)_ios[IOP_U2TX].pin;
+    _rxPort = _ios[IOP_U2RX].port;
+    _rxPin = (uint8_t)_ios[IOP_U2RX].pin;
+    p = SUART_PortIndex(_rxPort);
+    if (p == 0xFF) {
+        return UART_RESULT_INVALID_PARAM;
+    }
+
+    IO_Init(IOP_U2TX, IO_MODE_OUTPUT_PP_HIGH);
+    IO_Init(IOP_U2RX, IO_MODE_INPUT_PU);
+
+    _bitQ8 = ((SUART_TICK_HZ << 8) + baud / 2) / baud;
+    SUART_TxBuf_Init(&_txq);
+    SUART_RxBuf_Init(&_rxq);
+    _txBusy = 0;
+    _txBit = 0;
+
+    // Free-running TIM1 at 1 MHz; the prescaler absorbs clock switches
+    if (Timer_Init(TIMER_1, (uint16_t)(f / SUART_TICK_HZ), 0, 1) != TIMER_RESULT_OK) {
+        return UART_RESULT_ERROR;
+    }
+    TIM1_OC1Init(TIM1_OCMODE_TIMING, TIM1_OUTPUTSTATE_DISABLE, TIM1_OUTPUTNSTATE_DISABLE,
+                 0, TIM1_OCPOLARITY_HIGH, TIM1_OCNPOLARITY_HIGH,
+                 TIM1_OCIDLESTATE_RESET, TIM1_OCNIDLESTATE_RESET);
+    TIM1_OC2Init(TIM1_OCMODE_TIMING, TIM1_OUTPUTSTATE_DISABLE, TIM1_OUTPUTNSTATE_DISABLE,
+                 0, TIM1_OCPOLARITY_HIGH, TIM1_OCNPOLARITY_HIGH,
+                 TIM1_OCIDLESTATE_RESET, TIM1_OCNIDLESTATE_RESET);
+    TIM1_OC1PreloadConfig(DISABLE);
+    TIM1_OC2PreloadConfig(DISABLE);
+
+    IRQ_Register(IRQ_TIM1_CC, SUART_Isr);
+    IRQ_Register((IRQ_IDX)(IRQ_EXTI_A + p), SUART_StartIsr);
+    ITC_SetSoftwarePriority(ITC_IRQ_TIM1_CAPCOM, (ITC_PriorityLevel_TypeDef)SUART_PRIORITY);
+    ITC_SetSoftwarePriority((ITC_Irq_TypeDef)(ITC_IRQ_PORTA + p),
+                            (ITC_PriorityLevel_TypeDef)SUART_PRIORITY);
+    EXTI_SetExtIntSensitivity((EXTI_Port_TypeDef)p, EXTI_SENSITIVITY_FALL_ONLY);
+    Timer_Start(TIMER_1, true);
+
+    // Arm the start bit interrupt
+    _rxPort->CR2 |= _rxPin;
+
+    return UART_RESULT_OK;
+}
+
+/**
+ * @brief Queue a byte for transmission, waiting while the buffer is full
+ *
+ * @param ch Byte to send
+ * @return UART_Result Result of the operation
+ */
+UART_Result SUART_Send(uint8_t ch)
+{
+    uint8_t ier;
+
+    while (!SUART_TxBuf_Push(&_txq, &ch));
+
+    // Mask the bit interrupt so the ISR cannot go idle between the push
+    // and the idle check below
+    ier = TIM1->IER;
+    TIM1->IER = (uint8_t)(ier & ~TIM1_IER_CC1IE);
+    if (!_txBusy) {
+        _txBusy = 1;
+        _txBit = 0;
+        _tTx = (uint32_t)(uint16_t)(SUART_Now() + SUART_TX_KICK) << 8;
+        TIM1->CCR1H = (uint8_t)(_tTx >> 16);
+        TIM1->CCR1L = (uint8_t)(_tTx >> 8);
+        TIM1->SR1 = (uint8_t)~TIM1_SR1_CC1IF;
+        ier |= TIM1_IER_CC1IE;
+    }
+    TIM1->IER = ier;
+
+    return UART_RESULT_OK;
+}
+
+/**
+ * @brief Get the number of received bytes waiting in the buffer
+ *
+ * @return int Number of bytes
+ */
+int SUART_RxCount(void)
+{
+    return SUART_RxBuf_Count(&_rxq);
+}
+
+/**
+ * @brief Take a received byte, waiting until one is available
+ *
+ * @param pc Receives the byte
+ * @return UART_Result UART_RESULT_OVERRUN or UART_RESULT_FRAMING on errors
+ */
+UART_Result SUART_Recv(uint8_t *pc)
+{
+    uint8_t fe, ovr;
+
+    while (!SUART_RxBuf_Pop(&_rxq, pc));
+
+    ovr = _rxOvr;
+    fe = _rxFe;
+    if (ovr != _seenOvr) {
+        _seenOvr = ovr;
+        return UART_RESULT_OVERRUN;
+    }
+    if (fe != _seenFe) {
+        _seenFe = fe;
+        return UART_RESULT_FRAMING;
+    }
+    return UART_RESULT_OK;
+}
+
+/**
+ * @brief Transmit bit timing
+ */
+static void SUART_TxBit(void)
+{
+    if (_txBit == 0) {
+        if (!SUART_TxBuf_Pop(&_txq, &_txByte)) {
+            _txBusy = 0;
+            TIM1->IER &= (uint8_t)~TIM1_IER_CC1IE;
+            return;
+        }
+        _txPort->ODR &= (uint8_t)~_txPin;
+    } else if (_txBit <= 8) {
+        if (_txByte & 1)
+            _txPort->ODR |= _txPin;
+        else
+            _txPort->ODR &= (uint8_t)~_txPin;
+        _txByte >>= 1;
+    } else {
+        _txPort->ODR |= _txPin;
+    }
+
+    if (++_txBit == 10)
+        _txBit = 0;
+
+    // Late by more than a bit: time the next edge from this one rather than
+    // wait for a counter wrap
+    _tTx += _bitQ8;
+    if (SUART_Passed(_tTx))
+        _tTx = ((uint32_t)SUART_Now() << 8) + _bitQ8;
+    TIM1->CCR1H = (uint8_t)(_tTx >> 16);
+    TIM1->CCR1L = (uint8_t)(_tTx >> 8);
+}
+
+/**
+ * @brief Arm the compare for the next RX sample
+ *
+ * Samples that have already passed are skipped, keeping the bit count
+ * aligned to the frame; the byte is then bad.
+ *
+ * @return uint8_t 1 if the stop bit has passed as well
+ */
+static uint8_t SUART_RxArm(void)
+{
+    while (SUART_Passed(_tRx)) {
+        _rxBad = 1;
+        if (++_rxBit > 8)
+            return 1;
+        _tRx += _bitQ8;
+    }
+    TIM1->CCR2H = (uint8_t)(_tRx >> 16);
+    TIM1->CCR2L = (uint8_t)(_tRx >> 8);
+    return 0;
+}
+
+/**
+ * @brief Receive bit sampling
+ */
+static void SUART_RxBit(void)
+{
+    uint8_t b = (_rxPort->IDR & _rxPin) ? 1 : 0;
+
+    // More than half a bit late, the sample may be of the next bit
+    if ((uint16_t)(SUART_Now() - (uint16_t)(_tRx >> 8)) > (uint16_t)(_bitQ8 >> 9))
+        _rxBad = 1;
+
+    if (_rxBit < 8) {
+        _rxByte = (uint8_t)((_rxByte >> 1) | (b << 7));
+        ++_rxBit;
+        _tRx += _bitQ8;
+        if (!SUART_RxArm())
+            return;
+        ++_rxFe;
+    } else if (!b || _rxBad) {
+        // Stop bit
+        ++_rxFe;
+    } else if (!SUART_RxBuf_Push(&_rxq, &_rxByte)) {
+        ++_rxOvr;
+    }
+
+    TIM1->IER &= (uint8_t)~TIM1_IER_CC2IE;
+    _rxPort->CR2 |= _rxPin;
+}
+
+/**
+ * @brief TIM1 capture/compare interrupt service routine (bit timing)
+ */
+void SUART_Isr(void)
+{
+    uint8_t sr = (uint8_t)(TIM1->SR1 & TIM1->IER);
+
+    if (sr & TIM1_SR1_CC1IF) {
+        TIM1->SR1 = (uint8_t)~TIM1_SR1_CC1IF;
+        SUART_TxBit();
+    }
+    if (sr & TIM1_SR1_CC2IF) {
+        TIM1->SR1 = (uint8_t)~TIM1_SR1_CC2IF;
+        SUART_RxBit();
+    }
+}
+
+/**
+ * @brief External interrupt service routine (start bit)
+ */
+void SUART_StartIsr(void)
+{
+    uint16_t t = SUART_Now();
+
+    // Other pins of the port share this interrupt
+    if (!(_rxPort->CR2 & _rxPin) || (_rxPort->IDR & _rxPin))
+        return;
+
+    _rxPort->CR2 &= (uint8_t)~_rxPin;
+
+    // First sample in the middle of data bit 0
+    _tRx = ((uint32_t)(uint16_t)(t - SUART_RX_LATENCY) << 8) + _bitQ8 + (_bitQ8 >> 1);
+    _rxBit = 0;
+    _rxBad = 0;
+    if (SUART_RxArm()) {
+        ++_rxFe;
+        _rxPort->CR2 |= _rxPin;
+        return;
+    }
+    TIM1->SR1 = (uint8_t)~TIM1_SR1_CC2IF;
+    TIM1->IER |= TIM1_IER_CC2IE;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file suart.h
+ * @brief Software UART interface for STM8S003F3
+ *
+ * This file contains the declarations of the software UART functions and
+ * definitions. The software UART backs UART_2 of the UART driver; use it
+ * through UART_Init/UART_Send/UART_Recv rather than directly.
+ *
+ * TX and RX are timed by TIM1 compare channels 1 and 2 on a free-running
+ * 1 MHz counter; the start bit is detected by the external interrupt of the
+ * RX pin's port. Frames are 8N1.
+ */
+
+#ifndef __SUART_H
+#define __SUART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "uart.h"   // For UART_Result type
+
+/**
+ * @brief Transmit and receive buffer sizes (powers of two, 2 to 128)
+ */
+#ifndef SUART_TX_SIZE
+#define SUART_TX_SIZE       32
+#endif
+#ifndef SUART_RX_SIZE
+#define SUART_RX_SIZE       32
+#endif
+
+/**
+ * @brief Supported baud rates
+ */
+#define SUART_BAUD_MIN      300
+#define SUART_BAUD_MAX      19200
+
+/**
+ * @brief Interrupt priority of the bit timer and the start bit interrupt
+ */
+#ifndef SUART_PRIORITY
+#define SUART_PRIORITY      3
+#endif
+
+/**
+ * @brief Initialize the pins, TIM1 and the start bit interrupt
+ *
+ * Must be called while interrupts are disabled (external interrupt
+ * sensitivity can only be changed then). Takes over the external interrupt
+ * of the RX pin's port.
+ *
+ * @param baud Baud rate (SUART_BAUD_MIN to SUART_BAUD_MAX)
+ * @return UART_Result Result of the operation
+ */
+UART_Result SUART_Init(uint32_t baud);
+
+/**
+ * @brief Queue a byte for transmission, waiting while the buffer is full
+ *
+ * @param ch Byte to send
+ * @return UART_Result Result of the operation
+ */
+UART_Result SUART_Send(uint8_t ch);
+
+/**
+ * @brief Get the number of received bytes waiting in the buffer
+ *
+ * @return int Number of bytes
+ */
+int SUART_RxCount(void);
+
+/**
+ * @brief Take a received byte, waiting until one is available
+ *
+ * Framing errors and bytes lost to a full buffer since the previous call are
+ * reported with the next byte.
+ *
+ * @param pc Receives the byte
+ * @return UART_Result UART_RESULT_OVERRUN or UART_RESULT_FRAMING on errors
+ */
+UART_Result SUART_Recv(uint8_t *pc);
+
+/**
+ * @brief TIM1 capture/compare interrupt service routine (bit timing)
+ *
+ * Registered with the interrupt module by SUART_Init.
+ */
+void SUART_Isr(void);
+
+/**
+ * @brief External interrupt service routine (start bit)
+ *
+ * Registered with the interrupt module by SUART_Init.
+ */
+void SUART_StartIsr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SUART_H
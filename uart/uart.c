@@ -4,15 +4,50 @@
  *
  * This file contains the implementation of UART functions for initializing,
  * configuring, and performing UART operations on the STM8S003F3 microcontroller.
+ *
+ * Built with UART_HW_ONLY defined, UART_2 is rejected and neither the
+ * software UART nor the timer code it uses is linked in; the bootloader uses
+ * this.
  */
 
 #include <stdio.h>
 #include <stdarg.h>
 #include "stm8s.h"
 #include "uart.h"
+#ifndef UART_HW_ONLY
+#include "suart.h"
+#endif
 #include "io.h"
 #include "system.h"
 
+static uint32_t _baud = 0;
+static UART_IDX _con = CON_UART;
+
+/**
+ * @brief Set the UART1 baud rate registers for a master clock
+ *
+ * @param fMaster Master clock in Hz
+ */
+static void UART_SetBRR(uint32_t fMaster)
+{
+    uint16_t div = (uint16_t)((fMaster + _baud / 2) / _baud);
+
+    // BRR2 must be written before BRR1
+    UART1->BRR2 = (uint8_t)(((div >> 8) & 0xF0) | (div & 0x0F));
+    UART1->BRR1 = (uint8_t)(div >> 4);
+}
+
+/**
+ * @brief Clock change hook, keeps the baud rate across Sys_ClockSet
+ *
+ * @param fMaster New master clock in Hz
+ */
+static void UART_ClockChanged(uint32_t fMaster)
+{
+    if (_baud != 0)
+        UART_SetBRR(fMaster);
+}
+
 /**
  * @brief Initialize UART
  *
@@ -20,11 +55,25 @@
  * @param baud Baud rate for UART communication
  * @return UART_Result Result of the operation
  */
-UART_Result UART_Init(UART_IDX idx, int baud)
+UART_Result UART_Init(UART_IDX idx, uint32_t baud)
 {
+#ifndef UART_HW_ONLY
+    if (idx == UART_2) {
+        return SUART_Init(baud);
+    }
+#endif
     if (idx != UART_1) {
         return UART_RESULT_INVALID_UART;
     }
+    if (baud == 0) {
+        return UART_RESULT_INVALID_PARAM;
+    }
+
+    // UART1_Init derives BRR from the CLK registers; keep it in step with
+    // later clock switches
+    if (Sys_ClockRegister(UART_ClockChanged) != 0) {
+        return UART_RESULT_ERROR;
+    }
 
     // Enable UART clock
     CLK_PeripheralClockConfig(CLK_PERIPHERAL_UART1, ENABLE);
@@ -35,9 +84,10 @@ UART_Result UART_Init(UART_IDX idx, int baud)
     
     // Configure UART
     UART1_DeInit();
-    UART1_Init((int)baud, UART1_WORDLENGTH_8D, UART1_STOPBITS_1, 
+    UART1_Init(baud, UART1_WORDLENGTH_8D, UART1_STOPBITS_1, 
                UART1_PARITY_NO, UART1_SYNCMODE_CLOCK_DISABLE, 
                UART1_MODE_TXRX_ENABLE);
+    _baud = baud;
     
     // Start UART Peripheral
     UART1_Cmd(ENABLE);
@@ -54,6 +104,11 @@ UART_Result UART_Init(UART_IDX idx, int baud)
  */
 UART_Result UART_Send(UART_IDX idx, unsigned char ch)
 {
+#ifndef UART_HW_ONLY
+    if (idx == UART_2) {
+        return SUART_Send(ch);
+    }
+#endif
     if (idx != UART_1) {
         return UART_RESULT_INVALID_UART;
     }
@@ -72,6 +127,11 @@ UART_Result UART_Send(UART_IDX idx, unsigned char ch)
  */
 int UART_ChkRxBuff(UART_IDX idx)
 {
+#ifndef UART_HW_ONLY
+    if (idx == UART_2) {
+        return SUART_RxCount() != 0;
+    }
+#endif
     if (idx != UART_1) {
         return 0;
     }
@@ -82,32 +142,78 @@ int UART_ChkRxBuff(UART_IDX idx)
 /**
  * @brief Receive a single character from UART
  *
+ * The character is consumed and stored even when an error is returned, so
+ * a caller can discard it and go on with the next one.
+ *
  * @param idx UART index (currently only UART_1 is supported)
  * @param pc Pointer to store the received character
  * @return UART_Result Result of the operation
  */
 UART_Result UART_Recv(UART_IDX idx, unsigned char *pc)
 {
-    if (idx != UART_1 || pc == NULL) {
+    uint8_t sr;
+
+    if (pc == NULL) {
         return UART_RESULT_INVALID_PARAM;
     }
+#ifndef UART_HW_ONLY
+    if (idx == UART_2) {
+        return SUART_Recv(pc);
+    }
+#endif
+    if (idx != UART_1) {
+        return UART_RESULT_INVALID_UART;
+    }
 
     while (!UART_ChkRxBuff(idx));
     
-    if (UART1_GetFlagStatus(UART1_FLAG_OR) != RESET)
+    // Reading SR and then DR clears the error flags, so the next byte is
+    // not reported with a stale error
+    sr = UART1->SR;
+    *pc = UART1_ReceiveData8();
+    
+    if (sr & UART1_SR_OR)
         return UART_RESULT_OVERRUN;
-    if (UART1_GetFlagStatus(UART1_FLAG_NF) != RESET)
+    if (sr & UART1_SR_NF)
         return UART_RESULT_NOISE;
-    if (UART1_GetFlagStatus(UART1_FLAG_FE) != RESET)
+    if (sr & UART1_SR_FE)
         return UART_RESULT_FRAMING;
-    if (UART1_GetFlagStatus(UART1_FLAG_PE) != RESET)
+    if (sr & UART1_SR_PE)
         return UART_RESULT_PARITY;
     
-    *pc = UART1_ReceiveData8();
-    
     return UART_RESULT_OK;
 }
 
+/**
+ * @brief Select the UART used by UART_putch, UART_puts and UART_printf
+ *
+ * @param idx UART index
+ * @return UART_Result Result of the operation
+ */
+UART_Result UART_SetConsole(UART_IDX idx)
+{
+#ifdef UART_HW_ONLY
+    if (idx != UART_1) {
+#else
+    if (idx != UART_1 && idx != UART_2) {
+#endif
+        return UART_RESULT_INVALID_UART;
+    }
+
+    _con = idx;
+    return UART_RESULT_OK;
+}
+
+/**
+ * @brief Get the UART selected with UART_SetConsole
+ *
+ * @return UART_IDX Console UART index
+ */
+UART_IDX UART_GetConsole(void)
+{
+    return _con;
+}
+
 /**
  * @brief Send a single character over the console UART
  *
@@ -117,12 +223,12 @@ void UART_putch(unsigned char c)
 {
     if (c == '\n')
     {
-        UART_Send(CON_UART, '\n');
-        UART_Send(CON_UART, '\r');
+        UART_Send(_con, '\n');
+        UART_Send(_con, '\r');
     }
     else
     {
-        UART_Send(CON_UART, c);
+        UART_Send(_con, c);
     }
 }
 
@@ -20,6 +20,8 @@ extern "C" {
  */
 typedef enum {
   UART_1,
+  UART_2,   // Software UART on IOP_U2TX/IOP_U2RX (see suart.h), not
+            // available when uart.c is built with UART_HW_ONLY
   // Add other UART indices if needed
 } UART_IDX;
 
@@ -71,12 +73,32 @@ int UART_ChkRxBuff(UART_IDX idx);
 /**
  * @brief Receive a single character from UART
  *
+ * The character is consumed and stored even when an error is returned, so
+ * a caller can discard it and go on with the next one.
+ *
  * @param idx UART index (currently only UART_1 is supported)
  * @param pc Pointer to store the received character
  * @return UART_Result Result of the operation
  */
 UART_Result UART_Recv(UART_IDX idx, unsigned char *pc);
 
+/**
+ * @brief Select the UART used by UART_putch, UART_puts and UART_printf
+ *
+ * The console is CON_UART until changed.
+ *
+ * @param idx UART index
+ * @return UART_Result Result of the operation
+ */
+UART_Result UART_SetConsole(UART_IDX idx);
+
+/**
+ * @brief Get the UART selected with UART_SetConsole
+ *
+ * @return UART_IDX Console UART index
+ */
+UART_IDX UART_GetConsole(void);
+
 /**
  * @brief Send a single character over the console UART
  *